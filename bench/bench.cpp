@@ -0,0 +1,479 @@
+// Benchmark suite for bitcoin-key-utils.
+//
+// Every benchmark processes a batch of N independent records per timed call, for N from 1
+// up to --max-batch. Benchmarks that hash are repeated once per SHA-256 backend choice (and
+// the RIPEMD-160 kernels once per RIPEMD-160 backend), so backends can be compared. Results
+// are written as JSON or CSV, one row per (benchmark, backend, batch size).
+
+#include "bitcoin_key_utils.h"
+#include "base58.h"
+#include "bech32.h"
+#include "crypto/ripemd160.h"
+#include "crypto/sha256.h"
+#include "util/strencodings.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace BitcoinKeyUtils;
+
+namespace {
+
+enum class Format { Json, Csv };
+
+struct Options {
+    Format format = Format::Json;
+    size_t maxBatch = 1 << 20;
+    double minSeconds = 0.1;
+    std::string filter;
+    std::string outputPath = "-";
+};
+
+// Sizes 1, 16, 256, ... up to and including maxBatch.
+std::vector<size_t> BatchSizes(size_t maxBatch) {
+    std::vector<size_t> sizes;
+    for (size_t n = 1; n < maxBatch; n *= 16) sizes.push_back(n);
+    sizes.push_back(maxBatch);
+    return sizes;
+}
+
+/** Inputs for the largest batch; a batch of N uses the first N records. */
+struct Inputs {
+    std::vector<uint8_t> privateKeys;  // 32 bytes each
+    std::vector<uint8_t> pubKeys;      // 33 bytes each
+    std::vector<uint8_t> hashes;       // 20 bytes each
+    std::vector<uint8_t> sha256;       // 32 bytes each, the RIPEMD-160 input of Hash160
+    std::vector<std::string> wifs;
+    std::vector<std::string> p2pkh;
+    std::vector<std::string> p2wpkh;
+    std::vector<std::string_view> addresses;  // P2PKH and P2WPKH alternating
+    std::vector<std::string_view> wifViews;
+    std::vector<std::string> pubKeyHex;       // the public keys as 66 hex digits
+    std::vector<std::string_view> pubKeyHexViews;
+
+    explicit Inputs(size_t n) : privateKeys(n * Constants::PrivateKeySize), pubKeys(n * Constants::CompressedPubKeySize),
+                                hashes(n * Constants::Hash160Size), sha256(n * CSHA256::OUTPUT_SIZE) {
+        uint64_t x = 0x9e3779b97f4a7c15;
+        auto next = [&] { x ^= x << 13; x ^= x >> 7; x ^= x << 17; return static_cast<uint8_t>(x); };
+        for (auto& b : privateKeys) b = next();
+        for (auto& b : pubKeys) b = next();
+        for (auto& b : sha256) b = next();
+        for (size_t i = 0; i < n; ++i) pubKeys[i * Constants::CompressedPubKeySize] = 0x02 | (i & 1);
+
+        std::vector<BatchStatus> status(n);
+        (void)HashRIPEMD160SHA256Batch(pubKeys, Constants::CompressedPubKeySize, hashes, status);
+        std::vector<char> wifChars(n * Constants::WIFStride), p2pkhChars(n * Constants::P2PKHStride), p2wpkhChars(n * Constants::P2WPKHStride);
+        (void)EncodeWIFBatch(privateKeys, true, wifChars, status);
+        (void)GenerateP2PKHAddressBatch(hashes, p2pkhChars, status);
+        (void)GenerateP2WPKHAddressBatch(hashes, p2wpkhChars, status);
+        wifs.reserve(n);
+        p2pkh.reserve(n);
+        p2wpkh.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            wifs.emplace_back(wifChars.data() + i * Constants::WIFStride, strnlen(wifChars.data() + i * Constants::WIFStride, Constants::WIFStride));
+            p2pkh.emplace_back(p2pkhChars.data() + i * Constants::P2PKHStride, strnlen(p2pkhChars.data() + i * Constants::P2PKHStride, Constants::P2PKHStride));
+            p2wpkh.emplace_back(p2wpkhChars.data() + i * Constants::P2WPKHStride, Constants::P2WPKHStride);
+        }
+        for (size_t i = 0; i < n; ++i) addresses.emplace_back(i % 2 ? p2wpkh[i] : p2pkh[i]);
+        wifViews.assign(wifs.begin(), wifs.end());
+        std::vector<char> hex(n * 2 * Constants::CompressedPubKeySize);
+        (void)Hex::EncodeBatch(pubKeys, Constants::CompressedPubKeySize, hex, 2 * Constants::CompressedPubKeySize);
+        pubKeyHex.reserve(n);
+        for (size_t i = 0; i < n; ++i) pubKeyHex.emplace_back(hex.data() + i * 2 * Constants::CompressedPubKeySize, 2 * Constants::CompressedPubKeySize);
+        pubKeyHexViews.assign(pubKeyHex.begin(), pubKeyHex.end());
+    }
+
+    const uint8_t* PrivateKey(size_t i) const { return privateKeys.data() + i * Constants::PrivateKeySize; }
+    const uint8_t* PubKey(size_t i) const { return pubKeys.data() + i * Constants::CompressedPubKeySize; }
+    const uint8_t* Hash(size_t i) const { return hashes.data() + i * Constants::Hash160Size; }
+};
+
+/** Output buffers for the largest batch, shared by all benchmarks. */
+struct Outputs {
+    std::vector<uint8_t> bytes;
+    std::vector<char> chars;
+    std::vector<BatchStatus> status;
+    std::vector<uint64_t> bitmap;
+    std::vector<DecodedAddress> decoded;
+    std::vector<size_t> indices;
+
+    explicit Outputs(size_t n) : bytes(n * Constants::UncompressedPubKeySize), chars(n * 2 * Constants::CompressedPubKeySize), status(n), bitmap((n + 63) / 64), decoded(n), indices(n) {}
+};
+
+// Results are folded into this so the optimizer cannot drop the work.
+volatile uint64_t g_sink = 0;
+
+void Consume(uint64_t v) { g_sink = g_sink + v; }
+
+enum class Backend { None, Sha256, Ripemd160 };
+
+struct Benchmark {
+    std::string_view name;
+    /** Which backend choice the benchmark is repeated for; None runs it once. */
+    Backend backend;
+    std::function<void(const Inputs&, Outputs&, size_t n)> run;
+};
+
+// Prefixes for the vanity search benchmarks.
+constexpr std::string_view VanityPrefixes[] = {"1Bit", "1Love", "bc1qqqq"};
+
+// Watch list of every other input hash, so half the lookups hit; built on first use.
+const WatchList::Index& BenchWatchList(const Inputs& in) {
+    static const WatchList::Index index = [&] {
+        std::vector<uint8_t> listed;
+        for (size_t i = 0; i < in.hashes.size() / Constants::Hash160Size; i += 2) listed.insert(listed.end(), in.Hash(i), in.Hash(i) + Constants::Hash160Size);
+        const std::string path = (std::filesystem::temp_directory_path() / "bitcoin_key_utils_bench.idx").string();
+        (void)WatchList::Build(listed, path);
+        auto opened = WatchList::Index::Open(path);
+        std::filesystem::remove(path);  // The mapping outlives the name.
+        return std::move(*opened);
+    }();
+    return index;
+}
+
+std::vector<Benchmark> Benchmarks(Parallel::Executor& executor) {
+    static const AddressPrefixRanges vanityRanges = *CompileAddressPrefixes(VanityPrefixes);
+    return {
+        // Public API, one record per call.
+        {"EncodeWIF", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(EncodeWIF({in.PrivateKey(i), in.PrivateKey(i) + 32}, true)->size());
+        }},
+        {"DecodeWIF", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(DecodeWIF(in.wifs[i])->first[0]);
+        }},
+        {"HashRIPEMD160SHA256", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume((*HashRIPEMD160SHA256({in.PubKey(i), in.PubKey(i) + 33}))[0]);
+        }},
+        {"GenerateP2PKHAddress", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(GenerateP2PKHAddress({in.Hash(i), in.Hash(i) + 20})->size());
+        }},
+        {"GenerateP2WPKHAddress", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(GenerateP2WPKHAddress({in.Hash(i), in.Hash(i) + 20})->size());
+        }},
+        {"DecodeAddress", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(DecodeAddress(in.addresses[i])->hash[0]);
+        }},
+        {"DerivePublicKey", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume((*DerivePublicKey({in.PrivateKey(i), in.PrivateKey(i) + 32}, true))[0]);
+        }},
+        {"NoAlloc::EncodeWIF", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(NoAlloc::EncodeWIF(std::span<const uint8_t, 32>(in.PrivateKey(i), 32), true)->size());
+        }},
+        {"NoAlloc::DecodeWIF", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(NoAlloc::DecodeWIF(in.wifs[i])->first[0]);
+        }},
+        {"NoAlloc::HashRIPEMD160SHA256", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume((*NoAlloc::HashRIPEMD160SHA256({in.PubKey(i), 33}))[0]);
+        }},
+        {"NoAlloc::GenerateP2PKHAddress", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(NoAlloc::GenerateP2PKHAddress(std::span<const uint8_t, 20>(in.Hash(i), 20))->size());
+        }},
+        {"NoAlloc::GenerateP2WPKHAddress", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(NoAlloc::GenerateP2WPKHAddress(std::span<const uint8_t, 20>(in.Hash(i), 20))->size());
+        }},
+        {"NoAlloc::DecodeAddress", Backend::Sha256, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(NoAlloc::DecodeAddress(in.addresses[i])->hash[0]);
+        }},
+        {"NoAlloc::DerivePublicKey", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(NoAlloc::DerivePublicKey(std::span<const uint8_t, 32>(in.PrivateKey(i), 32), true)->bytes[0]);
+        }},
+
+        // Public API, whole batch per call.
+        {"EncodeWIFBatch", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*EncodeWIFBatch({in.privateKeys.data(), n * 32}, true, out.chars, out.status));
+        }},
+        {"DecodeWIFBatch", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*DecodeWIFBatch({in.wifViews.data(), n}, {out.bytes.data(), n * 32}, out.bitmap, out.status));
+        }},
+        {"DerivePublicKeyBatch", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*DerivePublicKeyBatch({in.privateKeys.data(), n * 32}, true, {out.bytes.data(), n * 33}, out.status));
+        }},
+        {"HashRIPEMD160SHA256Batch", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*HashRIPEMD160SHA256Batch({in.pubKeys.data(), n * 33}, 33, out.bytes, out.status));
+        }},
+        {"GenerateP2PKHAddressBatch", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*GenerateP2PKHAddressBatch({in.hashes.data(), n * 20}, out.chars, out.status));
+        }},
+        {"GenerateP2WPKHAddressBatch", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*GenerateP2WPKHAddressBatch({in.hashes.data(), n * 20}, out.chars, out.status));
+        }},
+        {"ValidateAddresses", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*ValidateAddresses({in.addresses.data(), n}, out.bitmap, {out.decoded.data(), n}));
+        }},
+        {"FindAddressPrefixMatches", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*FindAddressPrefixMatches(vanityRanges, {in.hashes.data(), n * 20}, out.indices));
+        }},
+        {"FindAddressPrefixMatches/encode", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            // The same search by generating each address and comparing strings.
+            size_t found = 0;
+            for (size_t i = 0; i < n; ++i) {
+                std::span<const uint8_t, 20> hash(in.Hash(i), 20);
+                const auto p2pkh = NoAlloc::GenerateP2PKHAddress(hash);
+                const auto p2wpkh = NoAlloc::GenerateP2WPKHAddress(hash);
+                if (std::any_of(std::begin(VanityPrefixes), std::end(VanityPrefixes), [&](std::string_view p) {
+                        return p2pkh->view().starts_with(p) || p2wpkh->view().starts_with(p);
+                    })) {
+                    out.indices[found++] = i;
+                }
+            }
+            Consume(found);
+        }},
+        {"WatchList::Index::Contains", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            const WatchList::Index& index = BenchWatchList(in);
+            size_t found = 0;
+            for (size_t i = 0; i < n; ++i) found += index.Contains(std::span<const uint8_t, 20>(in.Hash(i), 20));
+            Consume(found);
+        }},
+        {"WatchList::Index::Contains/batch", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*BenchWatchList(in).Contains({in.hashes.data(), n * 20}, out.bitmap));
+        }},
+        {"Parallel::Executor::DeriveAddresses", Backend::Sha256, [&executor](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*executor.DeriveAddresses({.pubKeys = {in.pubKeys.data(), n * 33}, .hashes = {out.bytes.data(), n * 20},
+                                               .p2pkh = {out.chars.data(), n * Constants::P2PKHStride}, .status = out.status}));
+        }},
+        {"Parallel::Executor::DerivePublicKeyBatch", Backend::None, [&executor](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*executor.DerivePublicKeyBatch({in.privateKeys.data(), n * 32}, true, {out.bytes.data(), n * 33}, out.status));
+        }},
+
+        // Primitives.
+        {"EncodeBase58/25", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(EncodeBase58(Span{in.privateKeys.data() + i * 32, 25}, Span{out.chars.data(), 64}));
+        }},
+        {"DecodeBase58/25", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(DecodeBase58(std::string_view{in.p2pkh[i]}, Span{out.bytes.data(), 25}));
+        }},
+        {"EncodeBase58Check/21", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(EncodeBase58Check(Span{in.Hash(i), 21}, Span{out.chars.data(), 64}));
+        }},
+        {"DecodeBase58Check/21", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(DecodeBase58Check(std::string_view{in.p2pkh[i]}, Span{out.bytes.data(), 21}));
+        }},
+        {"bech32::Encode/P2WPKH", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            static const bech32::Encoder encoder{bech32::Encoding::BECH32, "bc"};
+            for (size_t i = 0; i < n; ++i) Consume(encoder.EncodeWitnessProgram(0, Span{in.Hash(i), 20}, Span{out.chars.data(), 90}));
+        }},
+        {"bech32::Decode/P2WPKH", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(bech32::Decode(in.p2wpkh[i]).data.size());
+        }},
+        {"bech32::DecodeWitnessProgram/P2WPKH", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            static const bech32::Encoder encoder{bech32::Encoding::BECH32, "bc"};
+            uint8_t version;
+            for (size_t i = 0; i < n; ++i) Consume(encoder.DecodeWitnessProgram(in.p2wpkh[i], version, Span{out.bytes.data(), 40}));
+        }},
+        {"CSHA256/33", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) CSHA256().Write(in.PubKey(i), 33).Finalize(out.bytes.data());
+            Consume(out.bytes[0]);
+        }},
+        {"SHA256Multi/33", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            SHA256Multi(out.bytes.data(), in.pubKeys.data(), 33, n);
+            Consume(out.bytes[0]);
+        }},
+        {"CSHA256/64+33", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            // A tagged hash of each public key, writing the 64-byte tag prefix every time...
+            for (size_t i = 0; i < n; ++i) CSHA256().Write(in.sha256.data(), 64).Write(in.PubKey(i), 33).Finalize(out.bytes.data());
+            Consume(out.bytes[0]);
+        }},
+        {"CSHA256/midstate+33", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            // ...resuming from a copy of the prefix's midstate...
+            CSHA256 prefix;
+            prefix.Write(in.sha256.data(), 64);
+            for (size_t i = 0; i < n; ++i) CSHA256(prefix).Write(in.PubKey(i), 33).Finalize(out.bytes.data());
+            Consume(out.bytes[0]);
+        }},
+        {"SHA256MultiPrefixed/64+33", Backend::Sha256, [](const Inputs& in, Outputs& out, size_t n) {
+            // ...and hashing the suffixes 8 or 4 at a time.
+            CSHA256 prefix;
+            prefix.Write(in.sha256.data(), 64);
+            SHA256MultiPrefixed(out.bytes.data(), prefix, in.pubKeys.data(), 33, n);
+            Consume(out.bytes[0]);
+        }},
+        {"CRIPEMD160/32", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) CRIPEMD160().Write(in.sha256.data() + i * 32, 32).Finalize(out.bytes.data());
+            Consume(out.bytes[0]);
+        }},
+        {"Hex::Decode/33", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(Hex::Decode(in.pubKeyHex[i], {out.bytes.data(), 33}).has_value());
+        }},
+        {"TryParseHex/33", Backend::None, [](const Inputs& in, Outputs&, size_t n) {
+            // The curated parser the tools used before Hex, for comparison.
+            for (size_t i = 0; i < n; ++i) Consume(TryParseHex<uint8_t>(in.pubKeyHex[i])->size());
+        }},
+        {"Hex::Encode/33", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            for (size_t i = 0; i < n; ++i) Consume(*Hex::Encode({in.PubKey(i), 33}, {out.chars.data(), 66}));
+        }},
+        {"Hex::DecodeBatch/33", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*Hex::DecodeBatch({in.pubKeyHexViews.data(), n}, 33, {out.bytes.data(), n * 33}, out.status));
+        }},
+        {"Hex::EncodeBatch/33", Backend::None, [](const Inputs& in, Outputs& out, size_t n) {
+            Consume(*Hex::EncodeBatch({in.pubKeys.data(), n * 33}, 33, out.chars, 66));
+        }},
+        {"RIPEMD160D32", Backend::Ripemd160, [](const Inputs& in, Outputs& out, size_t n) {
+            RIPEMD160D32(out.bytes.data(), in.sha256.data(), n);
+            Consume(out.bytes[0]);
+        }},
+    };
+}
+
+struct Result {
+    std::string_view benchmark;
+    std::string sha256Backend;
+    std::string ripemd160Backend;
+    size_t batch;
+    uint64_t calls;
+    double nsPerOp;
+    double opsPerSec;
+};
+
+// Repeat run(n) until minSeconds have passed, after one untimed warm-up call.
+Result Measure(const Benchmark& bench, const Inputs& in, Outputs& out, size_t n, double minSeconds) {
+    using Clock = std::chrono::steady_clock;
+    bench.run(in, out, n);
+    uint64_t calls = 0;
+    const auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        bench.run(in, out, n);
+        ++calls;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    const double ops = static_cast<double>(calls) * n;
+    return {bench.name, {}, {}, n, calls, elapsed * 1e9 / ops, ops / elapsed};
+}
+
+std::string JsonEscape(std::string_view s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+
+void WriteResults(FILE* f, Format format, const std::vector<Result>& results) {
+    if (format == Format::Csv) {
+        std::fprintf(f, "benchmark,sha256_backend,ripemd160_backend,batch,calls,ns_per_op,ops_per_sec\n");
+        for (const Result& r : results) {
+            std::fprintf(f, "%.*s,\"%s\",\"%s\",%zu,%llu,%.3f,%.1f\n", (int)r.benchmark.size(), r.benchmark.data(),
+                         r.sha256Backend.c_str(), r.ripemd160Backend.c_str(), r.batch, (unsigned long long)r.calls, r.nsPerOp, r.opsPerSec);
+        }
+        return;
+    }
+    std::fprintf(f, "{\n  \"context\": {\"library\": \"bitcoin-key-utils\", \"compiler\": \"%s\", \"threads\": %u},\n  \"results\": [\n",
+                 JsonEscape(__VERSION__).c_str(), std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fprintf(f, "    {\"benchmark\": \"%s\", \"sha256_backend\": \"%s\", \"ripemd160_backend\": \"%s\", \"batch\": %zu, \"calls\": %llu, \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f}%s\n",
+                     JsonEscape(r.benchmark).c_str(), JsonEscape(r.sha256Backend).c_str(), JsonEscape(r.ripemd160Backend).c_str(),
+                     r.batch, (unsigned long long)r.calls, r.nsPerOp, r.opsPerSec, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+void PrintUsage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --format json|csv     Output format (default: json)\n"
+        "  --max-batch N         Largest batch size; sizes run 1, 16, 256, ... up to N (default: 1048576)\n"
+        "  --min-time SECONDS    Minimum measuring time per result (default: 0.1)\n"
+        "  --filter TEXT         Only run benchmarks whose name contains TEXT\n"
+        "  -o, --output PATH     Output file (default: stdout)\n",
+        argv0);
+}
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) return std::nullopt;
+        const char* value = argv[++i];
+        if (arg == "--format") {
+            if (std::string_view(value) == "json") opt.format = Format::Json;
+            else if (std::string_view(value) == "csv") opt.format = Format::Csv;
+            else return std::nullopt;
+        } else if (arg == "--max-batch") {
+            opt.maxBatch = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+        } else if (arg == "--min-time") {
+            opt.minSeconds = std::strtod(value, nullptr);
+        } else if (arg == "--filter") {
+            opt.filter = value;
+        } else if (arg == "-o" || arg == "--output") {
+            opt.outputPath = value;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return opt;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    auto opt = ParseOptions(argc, argv);
+    if (!opt) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    constexpr sha256_implementation::UseImplementation sha256Choices[] = {
+        sha256_implementation::STANDARD, sha256_implementation::USE_SSE4, sha256_implementation::USE_SSE4_AND_AVX2,
+        sha256_implementation::USE_SSE4_AND_SHANI, sha256_implementation::USE_ALL};
+    constexpr ripemd160_implementation::UseImplementation ripemd160Choices[] = {
+        ripemd160_implementation::STANDARD, ripemd160_implementation::USE_SSE41, ripemd160_implementation::USE_ALL};
+
+    Parallel::Executor executor;
+    const std::vector<Benchmark> benchmarks = Benchmarks(executor);
+    const std::vector<size_t> sizes = BatchSizes(opt->maxBatch);
+    const Inputs in(opt->maxBatch);
+    Outputs out(opt->maxBatch);
+    std::vector<Result> results;
+
+    auto runAll = [&](Backend backend, const std::string& sha256, const std::string& ripemd160) {
+        for (const Benchmark& bench : benchmarks) {
+            if (bench.backend != backend || bench.name.find(opt->filter) == std::string_view::npos) continue;
+            for (size_t n : sizes) {
+                Result r = Measure(bench, in, out, n, opt->minSeconds);
+                r.sha256Backend = sha256;
+                r.ripemd160Backend = ripemd160;
+                std::fprintf(stderr, "%-36.*s %-48s %8zu %12.1f ns/op\n", (int)r.benchmark.size(), r.benchmark.data(),
+                             (backend == Backend::Ripemd160 ? ripemd160 : sha256).c_str(), n, r.nsPerOp);
+                results.push_back(std::move(r));
+            }
+        }
+    };
+
+    // Choices the CPU does not support select the same backends as a smaller choice; run each set once.
+    const std::string ripemd160Best = RIPEMD160AutoDetect();
+    std::set<std::string> seen;
+    for (auto choice : sha256Choices) {
+        const std::string sha256 = SHA256AutoDetect(choice);
+        if (seen.insert(sha256).second) runAll(Backend::Sha256, sha256, ripemd160Best);
+    }
+    const std::string sha256Best = SHA256AutoDetect();
+    seen.clear();
+    for (auto choice : ripemd160Choices) {
+        const std::string ripemd160 = RIPEMD160AutoDetect(choice);
+        if (seen.insert(ripemd160).second) runAll(Backend::Ripemd160, sha256Best, ripemd160);
+    }
+    RIPEMD160AutoDetect();
+    runAll(Backend::None, sha256Best, ripemd160Best);
+
+    FILE* f = opt->outputPath == "-" ? stdout : std::fopen(opt->outputPath.c_str(), "w");
+    if (!f) {
+        std::fprintf(stderr, "Cannot write %s\n", opt->outputPath.c_str());
+        return 2;
+    }
+    WriteResults(f, opt->format, results);
+    if (f != stdout) std::fclose(f);
+    return 0;
+}
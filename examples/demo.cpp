@@ -1,43 +1,29 @@
 #include <iostream>
 #include <vector>
 #include <iomanip>
-#include <sstream>
 #include <string>
 #include "bitcoin_key_utils.h"
 using namespace BitcoinKeyUtils;
 
 std::vector<uint8_t> HexToBytes(const std::string& hex) {
-    if (hex.size() % 2 != 0) {
-        throw std::invalid_argument("Hex string must have even length");
-    }
-    auto hexVal = [](char c) -> int {
-        if (c >= '0' && c <= '9') return c - '0';
-        if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
-        if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
-        throw std::invalid_argument("Invalid hex character");
-    };
-    std::vector<uint8_t> bytes;
-    bytes.reserve(hex.size() / 2);
-    for (size_t i = 0; i < hex.size(); i += 2) {
-        int hi = hexVal(hex[i]);
-        int lo = hexVal(hex[i + 1]);
-        bytes.push_back(static_cast<uint8_t>((hi << 4) | lo));
+    std::vector<uint8_t> bytes(hex.size() / 2);
+    auto decoded = Hex::Decode(hex, bytes);
+    if (!decoded) {
+        throw std::invalid_argument(std::string(ErrorMessage(decoded.error().code)) + " at position " + std::to_string(decoded.error().position));
     }
     return bytes;
 }
 
 std::string BytesToHex(const std::vector<uint8_t>& data) {
-    std::ostringstream oss;
-    for (auto b : data) {
-        oss << std::hex << std::setw(2) << std::setfill('0') << (int)b;
-    }
-    return oss.str();
+    std::string hex(2 * data.size(), '\0');
+    (void)Hex::Encode(data, hex);
+    return hex;
 }
 
 int main(int argc, char* argv[]) {
-    // Default keys
+    // Default key; the public key is derived from it unless given as the second argument.
     std::string privHex = "0C28FCA386C7A227600B2FE50B7CAE11EC86D3BF1FBE471BE89827E19D72AA1D";
-    std::string pubHexCom = "02D0DE0AAEAEFAD02B8BDC8A01A1B8B11C696BD3D66A2C5F10780D95B7DF42645C";
+    std::string pubHexCom;
 
     // Check command-line arguments
     if (argc > 1 && std::string(argv[1]).length() > 0) {
@@ -51,11 +37,19 @@ int main(int argc, char* argv[]) {
     std::vector<uint8_t> privateKey, pubKey;
     try {
         privateKey = HexToBytes(privHex);
-        pubKey = HexToBytes(pubHexCom);
+        if (!pubHexCom.empty()) pubKey = HexToBytes(pubHexCom);
     } catch (const std::invalid_argument& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
+    if (pubHexCom.empty()) {
+        auto derived = DerivePublicKey(privateKey, true);
+        if (!derived) {
+            std::cerr << "Error: " << derived.error().message << std::endl;
+            return 1;
+        }
+        pubKey = *derived;
+    }
 
     // Set output formatting
     std::cout << std::left; // Left-align output
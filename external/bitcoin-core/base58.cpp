@@ -14,28 +14,38 @@
 
 #include <limits>
 
+#if defined(__SSE2__)
+#include "ascii_simd.h"
+#endif
+
 using util::ContainsNoNUL;
 
-/** All alphanumeric characters except for "0", "I", "O", and "l" */
-static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
-static const int8_t mapBase58[256] = {
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1, 0, 1, 2, 3, 4, 5, 6,  7, 8,-1,-1,-1,-1,-1,-1,
-    -1, 9,10,11,12,13,14,15, 16,-1,17,18,19,20,21,-1,
-    22,23,24,25,26,27,28,29, 30,31,32,-1,-1,-1,-1,-1,
-    -1,33,34,35,36,37,38,39, 40,41,42,43,-1,44,45,46,
-    47,48,49,50,51,52,53,54, 55,56,57,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
-};
+static constexpr const char* pszBase58 = BASE58_ALPHABET;
+static constexpr const std::array<int8_t, 256>& mapBase58 = BASE58_DIGITS;
+
+#if defined(__SSE2__)
+using BitcoinKeyUtils::detail::ascii::InRange;
+#endif
+
+size_t FindInvalidBase58Character(std::string_view str)
+{
+    size_t pos = 0;
+#if defined(__SSE2__)
+    // pszBase58 is six byte ranges. Only the block holding the first invalid character
+    // goes through the table below.
+    for (; pos + 16 <= str.size(); pos += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(str.data() + pos));
+        const __m128i digits = InRange(v, '1', '9');
+        const __m128i upper = _mm_or_si128(_mm_or_si128(InRange(v, 'A', 'H'), InRange(v, 'J', 'N')), InRange(v, 'P', 'Z'));
+        const __m128i lower = _mm_or_si128(InRange(v, 'a', 'k'), InRange(v, 'm', 'z'));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(digits, upper), lower)) != 0xffff) break;
+    }
+#endif
+    for (; pos < str.size(); ++pos) {
+        if (mapBase58[(uint8_t)str[pos]] == -1) return pos;
+    }
+    return str.size();
+}
 
 [[nodiscard]] static bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch, int max_ret_len)
 {
@@ -88,6 +98,10 @@ static const int8_t mapBase58[256] = {
 
 std::string EncodeBase58(Span<const unsigned char> input)
 {
+    if (input.size() == 25 || input.size() == 37 || input.size() == 38) {
+        char buf[MaxBase58Length<38>()];
+        return std::string(buf, EncodeBase58(input, Span{buf}));
+    }
     // Skip & count leading zeroes.
     int zeroes = 0;
     int length = 0;
@@ -126,6 +140,51 @@ std::string EncodeBase58(Span<const unsigned char> input)
     return str;
 }
 
+size_t EncodeBase58(Span<const unsigned char> input, Span<char> output)
+{
+    switch (input.size()) {
+    case 25: return EncodeBase58Fixed<25>(input.data(), output);
+    case 37: return EncodeBase58Fixed<37>(input.data(), output);
+    case 38: return EncodeBase58Fixed<38>(input.data(), output);
+    }
+    if (input.size() > MAX_BASE58_BUFFER_INPUT) return 0;
+    // Skip & count leading zeroes.
+    size_t zeroes = 0;
+    int length = 0;
+    while (input.size() > 0 && input[0] == 0) {
+        input = input.subspan(1);
+        zeroes++;
+    }
+    // Big-endian base58 representation, sized for the largest accepted input.
+    unsigned char b58[MAX_BASE58_BUFFER_INPUT * 138 / 100 + 1];
+    const int size = input.size() * 138 / 100 + 1; // log(256) / log(58), rounded up.
+    std::fill(b58, b58 + size, 0);
+    // Process the bytes.
+    for (const unsigned char byte : input) {
+        int carry = byte;
+        int i = 0;
+        // Apply "b58 = b58 * 256 + ch".
+        for (int pos = size - 1; (carry != 0 || i < length) && pos >= 0; pos--, i++) {
+            carry += 256 * b58[pos];
+            b58[pos] = carry % 58;
+            carry /= 58;
+        }
+        assert(carry == 0);
+        length = i;
+    }
+    // Skip leading zeroes in base58 result.
+    int it = size - length;
+    while (it != size && b58[it] == 0)
+        it++;
+    const size_t total = zeroes + (size - it);
+    if (total > output.size()) return 0;
+    // Translate the result into characters.
+    std::fill(output.begin(), output.begin() + zeroes, '1');
+    for (size_t pos = zeroes; it != size; ++pos)
+        output[pos] = pszBase58[b58[it++]];
+    return total;
+}
+
 bool DecodeBase58(const std::string& str, std::vector<unsigned char>& vchRet, int max_ret_len)
 {
     if (!ContainsNoNUL(str)) {
@@ -134,8 +193,56 @@ bool DecodeBase58(const std::string& str, std::vector<unsigned char>& vchRet, in
     return DecodeBase58(str.c_str(), vchRet, max_ret_len);
 }
 
+bool DecodeBase58(std::string_view str, Span<unsigned char> output)
+{
+    switch (output.size()) {
+    case 25: return DecodeBase58Fixed<25>(str, output.data());
+    case 37: return DecodeBase58Fixed<37>(str, output.data());
+    case 38: return DecodeBase58Fixed<38>(str, output.data());
+    }
+    // Skip & count leading '1's, which stand for leading zero bytes.
+    size_t zeroes = 0;
+    while (zeroes < str.size() && str[zeroes] == '1')
+        zeroes++;
+    if (zeroes > output.size()) return false;
+    // The remaining digits must fill the rest of the output exactly, big-endian.
+    unsigned char* b256 = output.data() + zeroes;
+    const int size = output.size() - zeroes;
+    std::fill(output.begin(), output.end(), 0);
+    int length = 0;
+    for (const char c : str.substr(zeroes)) {
+        int carry = mapBase58[(uint8_t)c];
+        if (carry == -1) // Invalid b58 character
+            return false;
+        int i = 0;
+        for (int pos = size - 1; (carry != 0 || i < length) && pos >= 0; pos--, i++) {
+            carry += 58 * b256[pos];
+            b256[pos] = carry % 256;
+            carry /= 256;
+        }
+        if (carry != 0) return false;
+        length = i;
+    }
+    return length == size;
+}
+
+/** Write the 4-byte checksum of input; payloads that pad into one block skip the streaming hasher. */
+static void Base58Checksum(Span<const unsigned char> input, unsigned char* checksum)
+{
+    if (input.size() <= SHA256_SINGLE_BLOCK_MAX_INPUT) {
+        SHA256DChecksum(checksum, input.data(), input.size());
+        return;
+    }
+    uint256 hash = Hash(input);
+    memcpy(checksum, hash.begin(), 4);
+}
+
 std::string EncodeBase58Check(Span<const unsigned char> input)
 {
+    if (input.size() <= SHA256_SINGLE_BLOCK_MAX_INPUT) {
+        char buf[MaxBase58Length<SHA256_SINGLE_BLOCK_MAX_INPUT + 4>()];
+        return std::string(buf, EncodeBase58Check(input, Span{buf}));
+    }
     // add 4-byte hash check to the end
     std::vector<unsigned char> vch(input.begin(), input.end());
     uint256 hash = Hash(vch);
@@ -143,6 +250,16 @@ std::string EncodeBase58Check(Span<const unsigned char> input)
     return EncodeBase58(vch);
 }
 
+size_t EncodeBase58Check(Span<const unsigned char> input, Span<char> output)
+{
+    if (input.size() + 4 > MAX_BASE58_BUFFER_INPUT) return 0;
+    // add 4-byte hash check to the end
+    unsigned char vch[MAX_BASE58_BUFFER_INPUT];
+    std::copy(input.begin(), input.end(), vch);
+    Base58Checksum(input, vch + input.size());
+    return EncodeBase58(Span{vch, input.size() + 4}, output);
+}
+
 [[nodiscard]] static bool DecodeBase58Check(const char* psz, std::vector<unsigned char>& vchRet, int max_ret_len)
 {
     if (!DecodeBase58(psz, vchRet, max_ret_len > std::numeric_limits<int>::max() - 4 ? std::numeric_limits<int>::max() : max_ret_len + 4) ||
@@ -151,8 +268,9 @@ std::string EncodeBase58Check(Span<const unsigned char> input)
         return false;
     }
     // re-calculate the checksum, ensure it matches the included 4-byte checksum
-    uint256 hash = Hash(Span{vchRet}.first(vchRet.size() - 4));
-    if (memcmp(&hash, &vchRet[vchRet.size() - 4], 4) != 0) {
+    unsigned char checksum[4];
+    Base58Checksum(Span{vchRet}.first(vchRet.size() - 4), checksum);
+    if (memcmp(checksum, &vchRet[vchRet.size() - 4], 4) != 0) {
         vchRet.clear();
         return false;
     }
@@ -167,3 +285,16 @@ bool DecodeBase58Check(const std::string& str, std::vector<unsigned char>& vchRe
     }
     return DecodeBase58Check(str.c_str(), vchRet, max_ret);
 }
+
+bool DecodeBase58Check(std::string_view str, Span<unsigned char> output)
+{
+    if (output.size() + 4 > MAX_BASE58_BUFFER_INPUT) return false;
+    unsigned char vch[MAX_BASE58_BUFFER_INPUT];
+    if (!DecodeBase58(str, Span{vch, output.size() + 4})) return false;
+    // re-calculate the checksum, ensure it matches the included 4-byte checksum
+    unsigned char checksum[4];
+    Base58Checksum(Span{vch, output.size()}, checksum);
+    if (memcmp(checksum, vch + output.size(), 4) != 0) return false;
+    std::copy_n(vch, output.size(), output.begin());
+    return true;
+}
@@ -14,9 +14,13 @@
 #ifndef BITCOIN_BASE58_H
 #define BITCOIN_BASE58_H
 
+#include <crypto/sha256.h>
 #include <span.h>
 
+#include <array>
+#include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -24,21 +28,229 @@
  */
 std::string EncodeBase58(Span<const unsigned char> input);
 
+/** Largest input accepted by the buffer-writing Base58 encoders below. */
+constexpr size_t MAX_BASE58_BUFFER_INPUT = 128;
+
+/**
+ * Encode a byte span as base58 into a caller-provided buffer, without allocating.
+ * Return the number of characters written, or 0 if the input exceeds
+ * MAX_BASE58_BUFFER_INPUT or the output buffer is too small.
+ */
+size_t EncodeBase58(Span<const unsigned char> input, Span<char> output);
+
 /**
  * Decode a base58-encoded string (str) into a byte vector (vchRet).
  * return true if decoding is successful.
  */
 [[nodiscard]] bool DecodeBase58(const std::string& str, std::vector<unsigned char>& vchRet, int max_ret_len);
 
+/**
+ * Decode a base58-encoded string into exactly output.size() bytes, without allocating.
+ * Unlike the vector overload, surrounding whitespace is not accepted. Return false if
+ * str is not valid base58 or does not decode to exactly output.size() bytes.
+ */
+[[nodiscard]] bool DecodeBase58(std::string_view str, Span<unsigned char> output);
+
+/** All alphanumeric characters except for "0", "I", "O", and "l" */
+inline constexpr char BASE58_ALPHABET[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+/** Digit value of each byte that is in BASE58_ALPHABET, -1 for every other byte. */
+inline constexpr std::array<int8_t, 256> BASE58_DIGITS = [] {
+    std::array<int8_t, 256> digits{};
+    for (auto& d : digits) d = -1;
+    for (int8_t i = 0; i < 58; ++i) digits[(uint8_t)BASE58_ALPHABET[i]] = i;
+    return digits;
+}();
+
+/** Upper bound on the number of base58 characters encoding N bytes. */
+template <size_t N>
+constexpr size_t MaxBase58Length() { return N * 138 / 100 + 1; } // log(256) / log(58), rounded up.
+
+/** 58^5, the largest power of 58 that fits in a 32-bit limb. */
+inline constexpr uint64_t BASE58_POW5 = 58ull * 58 * 58 * 58 * 58;
+
+/**
+ * Base58 codec for a payload of N bytes, with compile-time loop bounds. The encoder
+ * loads the payload as big-endian 32-bit limbs, peels off base 58^5 groups by repeated
+ * long division, then splits each group into 5 digits. Return the number of characters
+ * written, or 0 if the output buffer is too small. The buffer overloads above use it
+ * for the payload sizes of addresses and WIF keys (checksum included): 25 bytes (P2PKH),
+ * 37 and 38 bytes (WIF uncompressed and compressed). Being constexpr, it also encodes
+ * constants at compile time.
+ */
+template <size_t N>
+constexpr size_t EncodeBase58Fixed(const unsigned char* input, Span<char> output)
+{
+    constexpr size_t LIMBS = (N + 3) / 4;
+    constexpr size_t GROUPS = (MaxBase58Length<N>() + 4) / 5;
+    constexpr size_t PAD = LIMBS * 4 - N;
+
+    uint32_t limbs[LIMBS] = {};
+    for (size_t i = 0; i < N; ++i) {
+        limbs[(PAD + i) / 4] |= uint32_t{input[i]} << (8 * (3 - (PAD + i) % 4));
+    }
+    // Least significant group first; the quotient shrinks towards zero, so skip its leading zero limbs.
+    uint32_t groups[GROUPS] = {};
+    size_t first = 0;
+    for (size_t g = GROUPS; g-- > 0;) {
+        while (first < LIMBS && limbs[first] == 0)
+            first++;
+        uint64_t rem = 0;
+        for (size_t i = first; i < LIMBS; ++i) {
+            const uint64_t cur = (rem << 32) | limbs[i];
+            limbs[i] = cur / BASE58_POW5;
+            rem = cur % BASE58_POW5;
+        }
+        groups[g] = rem;
+    }
+    unsigned char b58[GROUPS * 5] = {};
+    for (size_t g = 0; g < GROUPS; ++g) {
+        uint32_t group = groups[g];
+        for (size_t k = 5; k-- > 0;) {
+            b58[g * 5 + k] = group % 58;
+            group /= 58;
+        }
+    }
+    // Leading zero bytes map to '1's; leading zero digits of the value are dropped.
+    size_t zeroes = 0;
+    while (zeroes < N && input[zeroes] == 0)
+        zeroes++;
+    size_t it = 0;
+    while (it < GROUPS * 5 && b58[it] == 0)
+        it++;
+    const size_t total = zeroes + (GROUPS * 5 - it);
+    if (total > output.size()) return 0;
+    char* out = output.data();
+    for (size_t pos = 0; pos < zeroes; ++pos)
+        out[pos] = '1';
+    for (size_t pos = zeroes; it < GROUPS * 5; ++pos)
+        out[pos] = BASE58_ALPHABET[b58[it++]];
+    return total;
+}
+
+/**
+ * Inverse of EncodeBase58Fixed: fold the digits into big-endian 32-bit limbs five at a
+ * time (one multiply-accumulate by 58^5 per group), rejecting any value that does not
+ * fit in N bytes or whose leading '1's do not match its leading zero bytes.
+ */
+template <size_t N>
+[[nodiscard]] constexpr bool DecodeBase58Fixed(std::string_view str, unsigned char* output)
+{
+    constexpr size_t LIMBS = (N + 3) / 4;
+    constexpr size_t PAD = LIMBS * 4 - N;
+
+    if (str.size() > MaxBase58Length<N>()) return false;
+    uint32_t limbs[LIMBS] = {};
+    // The first group takes the remainder so the others are exactly 5 digits long.
+    size_t pos = 0;
+    size_t group_len = str.size() % 5 == 0 ? 5 : str.size() % 5;
+    while (pos < str.size()) {
+        uint64_t carry = 0;
+        uint64_t mul = 1;
+        for (size_t k = 0; k < group_len; ++k) {
+            const int digit = BASE58_DIGITS[(uint8_t)str[pos + k]];
+            if (digit == -1) return false;
+            carry = carry * 58 + digit;
+            mul *= 58;
+        }
+        for (size_t i = LIMBS; i-- > 0;) {
+            const uint64_t cur = uint64_t{limbs[i]} * mul + carry;
+            limbs[i] = (uint32_t)cur;
+            carry = cur >> 32;
+        }
+        if (carry != 0) return false;
+        pos += group_len;
+        group_len = 5;
+    }
+    if (PAD != 0 && (limbs[0] >> (8 * (4 - PAD))) != 0) return false;
+    for (size_t i = 0; i < N; ++i) {
+        output[i] = limbs[(PAD + i) / 4] >> (8 * (3 - (PAD + i) % 4));
+    }
+    size_t ones = 0;
+    while (ones < str.size() && str[ones] == '1')
+        ones++;
+    size_t zeroes = 0;
+    while (zeroes < N && output[zeroes] == 0)
+        zeroes++;
+    return ones == zeroes;
+}
+
+/**
+ * Return the position of the first character of str that is not in the base58
+ * alphabet, or str.size() if there is none. Where SSE2 is available, 16 characters
+ * are classified per step, so invalid input can be rejected before any decoding.
+ */
+size_t FindInvalidBase58Character(std::string_view str);
+
 /**
  * Encode a byte span into a base58-encoded string, including checksum
  */
 std::string EncodeBase58Check(Span<const unsigned char> input);
 
+/**
+ * Encode a byte span, including checksum, into a caller-provided buffer without
+ * allocating. Return the number of characters written, or 0 on failure.
+ */
+size_t EncodeBase58Check(Span<const unsigned char> input, Span<char> output);
+
 /**
  * Decode a base58-encoded string (str) that includes a checksum into a byte
  * vector (vchRet), return true if decoding is successful
  */
 [[nodiscard]] bool DecodeBase58Check(const std::string& str, std::vector<unsigned char>& vchRet, int max_ret_len);
 
+/**
+ * Decode a base58-encoded string that includes a checksum into exactly output.size()
+ * payload bytes, without allocating. Surrounding whitespace is not accepted.
+ * Return true if decoding is successful.
+ */
+[[nodiscard]] bool DecodeBase58Check(std::string_view str, Span<unsigned char> output);
+
+/** Write the 4-byte Base58Check checksum of len bytes of input: with SHA256DChecksum at run
+ *  time, and with SHA256Constexpr in a constant expression. */
+constexpr void Base58ChecksumFixed(const unsigned char* input, size_t len, unsigned char* checksum)
+{
+    if consteval {
+        const auto hash = SHA256Constexpr(input, len);
+        const auto hash2 = SHA256Constexpr(hash.data(), hash.size());
+        for (int i = 0; i < 4; ++i) checksum[i] = hash2[i];
+    } else {
+        SHA256DChecksum(checksum, input, len);
+    }
+}
+
+/**
+ * Base58Check of a payload of N bytes into a caller-provided buffer. Return the number
+ * of characters written, or 0 if the output buffer is too small. Usable in constant
+ * expressions, so fixed addresses and keys can be encoded at compile time.
+ */
+template <size_t N>
+constexpr size_t EncodeBase58CheckFixed(const unsigned char* input, Span<char> output)
+{
+    static_assert(N <= SHA256_SINGLE_BLOCK_MAX_INPUT, "payload must fit a single SHA-256 block");
+    unsigned char data[N + 4] = {};
+    for (size_t i = 0; i < N; ++i) data[i] = input[i];
+    Base58ChecksumFixed(data, N, data + N);
+    return EncodeBase58Fixed<N + 4>(data, output);
+}
+
+/**
+ * Decode a Base58Check string into exactly N payload bytes. Return true if it decodes to
+ * N + 4 bytes and the checksum matches. Usable in constant expressions.
+ */
+template <size_t N>
+[[nodiscard]] constexpr bool DecodeBase58CheckFixed(std::string_view str, unsigned char* output)
+{
+    static_assert(N <= SHA256_SINGLE_BLOCK_MAX_INPUT, "payload must fit a single SHA-256 block");
+    unsigned char data[N + 4] = {};
+    if (!DecodeBase58Fixed<N + 4>(str, data)) return false;
+    unsigned char checksum[4] = {};
+    Base58ChecksumFixed(data, N, checksum);
+    for (int i = 0; i < 4; ++i) {
+        if (checksum[i] != data[N + i]) return false;
+    }
+    for (size_t i = 0; i < N; ++i) output[i] = data[i];
+    return true;
+}
+
 #endif // BITCOIN_BASE58_H
@@ -11,6 +11,10 @@
 #include <numeric>
 #include <optional>
 
+#if defined(__SSE2__)
+#include "ascii_simd.h"
+#endif
+
 namespace bech32
 {
 
@@ -19,21 +23,6 @@ namespace
 
 typedef std::vector<uint8_t> data;
 
-/** The Bech32 and Bech32m character set for encoding. */
-const char* CHARSET = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
-
-/** The Bech32 and Bech32m character set for decoding. */
-const int8_t CHARSET_REV[128] = {
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-    15, -1, 10, 17, 21, 20, 26, 30,  7,  5, -1, -1, -1, -1, -1, -1,
-    -1, 29, -1, 24, 13, 25,  9,  8, 23, -1, 18, 22, 31, 27, 19, -1,
-     1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1,
-    -1, 29, -1, 24, 13, 25,  9,  8, 23, -1, 18, 22, 31, 27, 19, -1,
-     1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1
-};
-
 /** We work with the finite field GF(1024) defined as a degree 2 extension of the base field GF(32)
  * The defining polynomial of the extension is x^2 + 9x + 23.
  * Let (e) be a root of this defining polynomial. Then (e) is a primitive element of GF(1024),
@@ -118,16 +107,10 @@ constexpr auto tables = GenerateGFTables();
 constexpr const std::array<int16_t, 1023>& GF1024_EXP = tables.first;
 constexpr const std::array<int16_t, 1024>& GF1024_LOG = tables.second;
 
-/* Determine the final constant to use for the specified encoding. */
-uint32_t EncodingConstant(Encoding encoding) {
-    assert(encoding == Encoding::BECH32 || encoding == Encoding::BECH32M);
-    return encoding == Encoding::BECH32 ? 1 : 0x2bc830a3;
-}
-
 /** This function will compute what 6 5-bit values to XOR into the last 6 input values, in order to
  *  make the checksum 0. These 6 values are packed together in a single 30-bit integer. The higher
  *  bits correspond to earlier values. */
-uint32_t PolyMod(const data& v)
+uint32_t PolyMod(Span<const uint8_t> v)
 {
     // The input is interpreted as a list of coefficients of a polynomial over F = GF(32), with an
     // implicit 1 in front. If the input is [v0,v1,v2,v3,v4], that polynomial is v(x) =
@@ -149,7 +132,7 @@ uint32_t PolyMod(const data& v)
     // (a^2 + 1) * (a^4 + a^3 + a) = (a^4 + a^3 + a) * a^2 + (a^4 + a^3 + a) = a^6 + a^5 + a^4 + a
     // = a^3 + 1 (mod a^5 + a^3 + 1) = {9}.
 
-    // During the course of the loop below, `c` contains the bitpacked coefficients of the
+    // While processing the input (see PolyModStep in bech32.h), `c` contains the bitpacked coefficients of the
     // polynomial constructed from just the values of v that were processed so far, mod g(x). In
     // the above example, `c` initially corresponds to 1 mod g(x), and after processing 2 inputs of
     // v, it corresponds to x^2 + v0*x + v1 mod g(x). As 1 mod g(x) = 1, that is the starting value
@@ -174,45 +157,7 @@ uint32_t PolyMod(const data& v)
     // That guarantees it is, in fact, the generator of a primitive BCH code with cycle
     // length 1023 and distance 4. See https://en.wikipedia.org/wiki/BCH_code for more details.
 
-    uint32_t c = 1;
-    for (const auto v_i : v) {
-        // We want to update `c` to correspond to a polynomial with one extra term. If the initial
-        // value of `c` consists of the coefficients of c(x) = f(x) mod g(x), we modify it to
-        // correspond to c'(x) = (f(x) * x + v_i) mod g(x), where v_i is the next input to
-        // process. Simplifying:
-        // c'(x) = (f(x) * x + v_i) mod g(x)
-        //         ((f(x) mod g(x)) * x + v_i) mod g(x)
-        //         (c(x) * x + v_i) mod g(x)
-        // If c(x) = c0*x^5 + c1*x^4 + c2*x^3 + c3*x^2 + c4*x + c5, we want to compute
-        // c'(x) = (c0*x^5 + c1*x^4 + c2*x^3 + c3*x^2 + c4*x + c5) * x + v_i mod g(x)
-        //       = c0*x^6 + c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i mod g(x)
-        //       = c0*(x^6 mod g(x)) + c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i
-        // If we call (x^6 mod g(x)) = k(x), this can be written as
-        // c'(x) = (c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i) + c0*k(x)
-
-        // First, determine the value of c0:
-        uint8_t c0 = c >> 25;
-
-        // Then compute c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i:
-        c = ((c & 0x1ffffff) << 5) ^ v_i;
-
-        // Finally, for each set bit n in c0, conditionally add {2^n}k(x). These constants can be
-        // computed using the following Sage code (continuing the code above):
-        //
-        // for i in [1,2,4,8,16]: # Print out {1,2,4,8,16}*(g(x) mod x^6), packed in hex integers.
-        //     v = 0
-        //     for coef in reversed((F.fetch_int(i)*(G % x**6)).coefficients(sparse=True)):
-        //         v = v*32 + coef.integer_representation()
-        //     print("0x%x" % v)
-        //
-        if (c0 & 1)  c ^= 0x3b6a57b2; //     k(x) = {29}x^5 + {22}x^4 + {20}x^3 + {21}x^2 + {29}x + {18}
-        if (c0 & 2)  c ^= 0x26508e6d; //  {2}k(x) = {19}x^5 +  {5}x^4 +     x^3 +  {3}x^2 + {19}x + {13}
-        if (c0 & 4)  c ^= 0x1ea119fa; //  {4}k(x) = {15}x^5 + {10}x^4 +  {2}x^3 +  {6}x^2 + {15}x + {26}
-        if (c0 & 8)  c ^= 0x3d4233dd; //  {8}k(x) = {30}x^5 + {20}x^4 +  {4}x^3 + {12}x^2 + {30}x + {29}
-        if (c0 & 16) c ^= 0x2a1462b3; // {16}k(x) = {21}x^5 +     x^4 +  {8}x^3 + {24}x^2 + {21}x + {19}
-
-    }
-    return c;
+    return PolyModUpdate(1, v);
 }
 
 /** Syndrome computes the values s_j = R(e^j) for j in [997, 998, 999]. As described above, the
@@ -283,6 +228,15 @@ inline unsigned char LowerCase(unsigned char c)
     return (c >= 'A' && c <= 'Z') ? (c - 'A') + 'a' : c;
 }
 
+/** Whether hrp holds an uppercase character, which would make any encoding with it invalid. */
+bool HasUpperCase(std::string_view hrp)
+{
+    for (const char c : hrp) {
+        if (c >= 'A' && c <= 'Z') return true;
+    }
+    return false;
+}
+
 /** Return indices of invalid characters in a Bech32 string. */
 bool CheckCharacters(const std::string& str, std::vector<int>& errors)
 {
@@ -352,6 +306,10 @@ data CreateChecksum(Encoding encoding, const std::string& hrp, const data& value
     return ret;
 }
 
+#if defined(__SSE2__)
+using BitcoinKeyUtils::detail::ascii::InRange;
+#endif
+
 } // namespace
 
 /** Encode a Bech32 or Bech32m string. */
@@ -359,7 +317,7 @@ std::string Encode(Encoding encoding, const std::string& hrp, const data& values
     // First ensure that the HRP is all lowercase. BIP-173 and BIP350 require an encoder
     // to return a lowercase Bech32/Bech32m string, but if given an uppercase HRP, the
     // result will always be invalid.
-    for (const char& c : hrp) assert(c < 'A' || c > 'Z');
+    for ([[maybe_unused]] const char& c : hrp) assert(c < 'A' || c > 'Z');
 
     std::string ret;
     ret.reserve(hrp.size() + 1 + values.size() + CHECKSUM_SIZE);
@@ -370,6 +328,57 @@ std::string Encode(Encoding encoding, const std::string& hrp, const data& values
     return ret;
 }
 
+size_t Encode(Encoding encoding, std::string_view hrp, Span<const uint8_t> values, Span<char> output) {
+    if (HasUpperCase(hrp)) return 0;
+    return EncodeWithHrpState(encoding, hrp, HrpPolyModState(hrp), values, output);
+}
+
+Encoder::Encoder(Encoding encoding, std::string_view hrp) : m_encoding(encoding), m_hrp(hrp)
+{
+    for (char& c : m_hrp) c = LowerCase(c);
+    assert(encoding == Encoding::BECH32 || encoding == Encoding::BECH32M);
+    m_hrp_state = HrpPolyModState(m_hrp);
+}
+
+size_t Encoder::Encode(Span<const uint8_t> values, Span<char> output) const
+{
+    return EncodeWithHrpState(m_encoding, m_hrp, m_hrp_state, values, output);
+}
+
+size_t Encoder::EncodeWitnessProgram(uint8_t version, Span<const uint8_t> program, Span<char> output) const
+{
+    return bech32::EncodeWitnessProgram(m_encoding, m_hrp, m_hrp_state, version, program, output);
+}
+
+size_t Encoder::DecodeWitnessProgram(std::string_view str, uint8_t& version, Span<uint8_t> program) const
+{
+    return bech32::DecodeWitnessProgram(m_encoding, m_hrp, m_hrp_state, str, version, program);
+}
+
+size_t FindInvalidCharacter(std::string_view str)
+{
+    size_t pos = 0;
+#if defined(__SSE2__)
+    // CHARSET is '0', '2'-'9' and four letter ranges; folding to lowercase maps only
+    // 'A'-'Z' onto 'a'-'z'. Only the block holding the first invalid character goes
+    // through the table below.
+    for (; pos + 16 <= str.size(); pos += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(str.data() + pos));
+        const __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        const __m128i digits = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('0')), InRange(v, '2', '9'));
+        const __m128i letters = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('a')), InRange(folded, 'c', 'h')),
+            _mm_or_si128(InRange(folded, 'j', 'n'), InRange(folded, 'p', 'z')));
+        if (_mm_movemask_epi8(_mm_or_si128(digits, letters)) != 0xffff) break;
+    }
+#endif
+    for (; pos < str.size(); ++pos) {
+        const unsigned char c = str[pos];
+        if (c >= 128 || CHARSET_REV[c] == -1) return pos;
+    }
+    return str.size();
+}
+
 /** Decode a Bech32 or Bech32m string. */
 DecodeResult Decode(const std::string& str, CharLimit limit) {
     std::vector<int> errors;
@@ -14,8 +14,13 @@
 #ifndef BITCOIN_BECH32_H
 #define BITCOIN_BECH32_H
 
+#include <span.h>
+
+#include <array>
+#include <assert.h>
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace bech32
@@ -43,6 +48,236 @@ enum CharLimit : size_t {
  *  assertion error. Encoding must be one of BECH32 or BECH32M. */
 std::string Encode(Encoding encoding, const std::string& hrp, const std::vector<uint8_t>& values);
 
+/** Encode a Bech32 or Bech32m string into a caller-provided buffer, without allocating. Return the
+ *  number of characters written, or 0 if hrp contains uppercase characters, the result would
+ *  exceed CharLimit::BECH32 or the output buffer is too small. */
+size_t Encode(Encoding encoding, std::string_view hrp, Span<const uint8_t> values, Span<char> output);
+
+/** Longest witness program (in bytes) accepted by Encoder::EncodeWitnessProgram, per BIP141. */
+constexpr size_t MAX_WITNESS_PROGRAM_SIZE = 40;
+
+/** Return the position of the first character of str that is not in the Bech32 data
+ *  charset (in either case), or str.size() if there is none. Mixed case is not detected.
+ *  Where SSE2 is available, 16 characters are classified per step. */
+size_t FindInvalidCharacter(std::string_view str);
+
+/** The Bech32 and Bech32m character set for encoding. */
+inline constexpr char CHARSET[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+/** The Bech32 and Bech32m character set for decoding, in either case; -1 for characters outside it. */
+inline constexpr int8_t CHARSET_REV[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    15, -1, 10, 17, 21, 20, 26, 30,  7,  5, -1, -1, -1, -1, -1, -1,
+    -1, 29, -1, 24, 13, 25,  9,  8, 23, -1, 18, 22, 31, 27, 19, -1,
+     1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1,
+    -1, 29, -1, 24, 13, 25,  9,  8, 23, -1, 18, 22, 31, 27, 19, -1,
+     1,  0,  3, 16, 11, 28, 12, 14,  6,  4,  2, -1, -1, -1, -1, -1
+};
+
+/* Determine the final constant to use for the specified encoding. */
+constexpr uint32_t EncodingConstant(Encoding encoding) {
+    assert(encoding == Encoding::BECH32 || encoding == Encoding::BECH32M);
+    return encoding == Encoding::BECH32 ? 1 : 0x2bc830a3;
+}
+
+/** Update `c`, the PolyMod state described in PolyMod (bech32.cpp), with one more input symbol v_i. */
+constexpr uint32_t PolyModStep(uint32_t c, uint8_t v_i)
+{
+    // We want to update `c` to correspond to a polynomial with one extra term. If the initial
+    // value of `c` consists of the coefficients of c(x) = f(x) mod g(x), we modify it to
+    // correspond to c'(x) = (f(x) * x + v_i) mod g(x), where v_i is the next input to
+    // process. Simplifying:
+    // c'(x) = (f(x) * x + v_i) mod g(x)
+    //         ((f(x) mod g(x)) * x + v_i) mod g(x)
+    //         (c(x) * x + v_i) mod g(x)
+    // If c(x) = c0*x^5 + c1*x^4 + c2*x^3 + c3*x^2 + c4*x + c5, we want to compute
+    // c'(x) = (c0*x^5 + c1*x^4 + c2*x^3 + c3*x^2 + c4*x + c5) * x + v_i mod g(x)
+    //       = c0*x^6 + c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i mod g(x)
+    //       = c0*(x^6 mod g(x)) + c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i
+    // If we call (x^6 mod g(x)) = k(x), this can be written as
+    // c'(x) = (c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i) + c0*k(x)
+
+    // First, determine the value of c0:
+    const uint8_t c0 = c >> 25;
+
+    // Then compute c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i:
+    c = ((c & 0x1ffffff) << 5) ^ v_i;
+
+    // Finally, for each set bit n in c0, conditionally add {2^n}k(x). These constants can be
+    // computed using the following Sage code (continuing the code in PolyMod in bech32.cpp):
+    //
+    // for i in [1,2,4,8,16]: # Print out {1,2,4,8,16}*(g(x) mod x^6), packed in hex integers.
+    //     v = 0
+    //     for coef in reversed((F.fetch_int(i)*(G % x**6)).coefficients(sparse=True)):
+    //         v = v*32 + coef.integer_representation()
+    //     print("0x%x" % v)
+    //
+    if (c0 & 1)  c ^= 0x3b6a57b2; //     k(x) = {29}x^5 + {22}x^4 + {20}x^3 + {21}x^2 + {29}x + {18}
+    if (c0 & 2)  c ^= 0x26508e6d; //  {2}k(x) = {19}x^5 +  {5}x^4 +     x^3 +  {3}x^2 + {19}x + {13}
+    if (c0 & 4)  c ^= 0x1ea119fa; //  {4}k(x) = {15}x^5 + {10}x^4 +  {2}x^3 +  {6}x^2 + {15}x + {26}
+    if (c0 & 8)  c ^= 0x3d4233dd; //  {8}k(x) = {30}x^5 + {20}x^4 +  {4}x^3 + {12}x^2 + {30}x + {29}
+    if (c0 & 16) c ^= 0x2a1462b3; // {16}k(x) = {21}x^5 +     x^4 +  {8}x^3 + {24}x^2 + {21}x + {19}
+    return c;
+}
+
+/** PolyModStep applied twice with zero inputs to a state whose only nonzero bits are the top
+ *  two symbols. As PolyModStep is linear, two symbols can then be absorbed at once:
+ *  c' = ((c & 0xfffff) << 10) ^ (v0 << 5) ^ v1 ^ POLYMOD_TABLE2[c >> 20]. */
+constexpr std::array<uint32_t, 1024> GeneratePolyModTable2()
+{
+    std::array<uint32_t, 1024> table{};
+    for (uint32_t hi = 0; hi < 1024; ++hi) {
+        table[hi] = PolyModStep(PolyModStep(hi << 20, 0), 0);
+    }
+    return table;
+}
+inline constexpr std::array<uint32_t, 1024> POLYMOD_TABLE2 = GeneratePolyModTable2();
+
+/** Absorb the symbols of v into the PolyMod state c, two per table lookup. */
+constexpr uint32_t PolyModUpdate(uint32_t c, Span<const uint8_t> v)
+{
+    const uint8_t* p = v.data();
+    size_t i = 0;
+    for (; i + 2 <= v.size(); i += 2) {
+        c = ((c & 0xfffff) << 10) ^ (uint32_t{p[i]} << 5) ^ p[i + 1] ^ POLYMOD_TABLE2[c >> 20];
+    }
+    if (i < v.size()) c = PolyModStep(c, p[i]);
+    return c;
+}
+
+/** PolyMod state after the expanded HRP, the part of the checksum input shared by every string with that HRP. */
+constexpr uint32_t HrpPolyModState(std::string_view hrp)
+{
+    uint32_t c = 1;
+    for (const char ch : hrp) c = PolyModStep(c, ch >> 5);
+    c = PolyModStep(c, 0);
+    for (const char ch : hrp) c = PolyModStep(c, ch & 0x1f);
+    return c;
+}
+
+/** Buffer-writing encoder shared by Encode, Encoder::Encode and EncodeWitnessProgram, given the HRP's PolyMod state. */
+constexpr size_t EncodeWithHrpState(Encoding encoding, std::string_view hrp, uint32_t hrp_state, Span<const uint8_t> values, Span<char> output)
+{
+    const size_t total = hrp.size() + 1 + values.size() + CHECKSUM_SIZE;
+    if (total > CharLimit::BECH32 || total > output.size()) return 0;
+
+    const uint8_t zeroes[CHECKSUM_SIZE] = {};
+    const uint32_t mod = PolyModUpdate(PolyModUpdate(hrp_state, values), zeroes) ^ EncodingConstant(encoding);
+
+    char* out = output.data();
+    size_t pos = 0;
+    for (const char c : hrp) out[pos++] = c;
+    out[pos++] = '1';
+    for (const uint8_t v : values) out[pos++] = CHARSET[v];
+    for (size_t i = 0; i < CHECKSUM_SIZE; ++i) out[pos++] = CHARSET[(mod >> (5 * (5 - i))) & 31];
+    return pos;
+}
+
+/** Same as Encoder::EncodeWitnessProgram, for a lowercase hrp whose HrpPolyModState is hrp_state.
+ *  Usable in constant expressions, so segwit addresses can be built at compile time. */
+constexpr size_t EncodeWitnessProgram(Encoding encoding, std::string_view hrp, uint32_t hrp_state, uint8_t version, Span<const uint8_t> program, Span<char> output)
+{
+    if (version > 16 || program.size() > MAX_WITNESS_PROGRAM_SIZE) return 0;
+    // Witness version followed by the program regrouped from 8-bit into 5-bit values, zero padded.
+    std::array<uint8_t, 1 + (MAX_WITNESS_PROGRAM_SIZE * 8 + 4) / 5> values{};
+    size_t n = 0;
+    values[n++] = version;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (const uint8_t byte : program) {
+        acc = (acc << 8) | byte;
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            values[n++] = (acc >> bits) & 31;
+        }
+    }
+    if (bits) values[n++] = (acc << (5 - bits)) & 31;
+    return EncodeWithHrpState(encoding, hrp, hrp_state, Span{values.data(), n}, output);
+}
+
+/** Same as Encoder::DecodeWitnessProgram, for a lowercase hrp whose HrpPolyModState is hrp_state.
+ *  Usable in constant expressions. */
+constexpr size_t DecodeWitnessProgram(Encoding encoding, std::string_view hrp, uint32_t hrp_state, std::string_view str, uint8_t& version, Span<uint8_t> program)
+{
+    // HRP, separator, version, at least 2 program bytes (4 values) and the checksum.
+    const size_t hrp_size = hrp.size();
+    if (str.size() > CharLimit::BECH32 || str.size() < hrp_size + 6 + CHECKSUM_SIZE) return 0;
+    if (str[hrp_size] != '1') return 0;
+    bool lower = false, upper = false;
+    for (size_t i = 0; i < hrp_size; ++i) {
+        const unsigned char c = str[i];
+        lower |= c >= 'a' && c <= 'z';
+        upper |= c >= 'A' && c <= 'Z';
+        const unsigned char folded = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+        if (folded != (unsigned char)hrp[i]) return 0;
+    }
+    const std::string_view chars = str.substr(hrp_size + 1);
+    std::array<uint8_t, CharLimit::BECH32> values{};
+    for (size_t i = 0; i < chars.size(); ++i) {
+        const unsigned char c = chars[i];
+        if (c >= 128 || CHARSET_REV[c] == -1) return 0;
+        lower |= c >= 'a';
+        upper |= c >= 'A' && c <= 'Z';
+        values[i] = CHARSET_REV[c];
+    }
+    if (lower && upper) return 0;
+    if (PolyModUpdate(hrp_state, Span{values.data(), chars.size()}) != EncodingConstant(encoding)) return 0;
+
+    version = values[0];
+    if (version > 16) return 0;
+    // Regroup the program from 5-bit into 8-bit values; the padding must be under 5 bits and zero.
+    uint8_t* out = program.data();
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t size = 0;
+    for (size_t i = 1; i < chars.size() - CHECKSUM_SIZE; ++i) {
+        acc = ((acc << 5) | values[i]) & 0xfff;
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            if (size == program.size()) return 0;
+            out[size++] = (acc >> bits) & 0xff;
+        }
+    }
+    if (bits >= 5 || (acc & ((1u << bits) - 1)) != 0) return 0;
+    if (size < 2 || size > MAX_WITNESS_PROGRAM_SIZE) return 0;
+    return size;
+}
+
+/** Bech32 or Bech32m encoder for one fixed HRP, folded to lowercase at construction as BIP173
+ *  requires of encoders. The checksum state after the expanded HRP is computed once there too,
+ *  so each Encode or DecodeWitnessProgram only processes the data part. Encoding must be one of
+ *  BECH32 or BECH32M. */
+class Encoder
+{
+public:
+    Encoder(Encoding encoding, std::string_view hrp);
+
+    /** Same as the buffer-writing Encode above, for this encoder's HRP and encoding. */
+    size_t Encode(Span<const uint8_t> values, Span<char> output) const;
+
+    /** Encode a segwit address straight from its witness version and program bytes (20 bytes
+     *  for P2WPKH, 32 for P2WSH/P2TR), without an intermediate 5-bit vector. Return the number
+     *  of characters written, or 0 if the version or program size is out of range or the
+     *  output buffer is too small. */
+    size_t EncodeWitnessProgram(uint8_t version, Span<const uint8_t> program, Span<char> output) const;
+
+    /** Inverse of EncodeWitnessProgram, without allocating. The HRP is matched case-insensitively,
+     *  but the string must not mix case. Return the program size (2 to 40 bytes) written to
+     *  program, or 0 if str is not a valid address for this HRP and encoding, or program is too small. */
+    size_t DecodeWitnessProgram(std::string_view str, uint8_t& version, Span<uint8_t> program) const;
+
+    std::string_view Hrp() const { return m_hrp; }
+
+private:
+    Encoding m_encoding;
+    std::string m_hrp;
+    uint32_t m_hrp_state;
+};
+
 struct DecodeResult
 {
     Encoding encoding;         //!< What encoding was detected in the result; Encoding::INVALID if failed.
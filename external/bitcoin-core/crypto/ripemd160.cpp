@@ -6,8 +6,23 @@
 
 #include <crypto/common.h>
 
+#include <algorithm>
 #include <string.h>
 
+#if !defined(DISABLE_OPTIMIZED_RIPEMD160)
+#include <compat/cpuid.h>
+
+namespace ripemd160_multi_sse41
+{
+void Transform_4way(unsigned char* out, const unsigned char* in);
+}
+
+namespace ripemd160_multi_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+#endif // DISABLE_OPTIMIZED_RIPEMD160
+
 // Internal implementation code.
 namespace
 {
@@ -233,10 +248,129 @@ void Transform(uint32_t* s, const unsigned char* chunk)
     s[4] = t + b1 + c2;
 }
 
+/** Compute the RIPEMD-160 of a single 32-byte message, which pads into one block. */
+void TransformD32(unsigned char* out, const unsigned char* in)
+{
+    unsigned char block[64] = {0};
+    memcpy(block, in, 32);
+    block[32] = 0x80;
+    WriteLE64(block + 56, 32 << 3);
+    uint32_t s[5];
+    Initialize(s);
+    Transform(s, block);
+    for (int i = 0; i < 5; ++i) WriteLE32(out + 4 * i, s[i]);
+}
+
 } // namespace ripemd160
 
+typedef void (*TransformD32Type)(unsigned char*, const unsigned char*);
+
+TransformD32Type TransformD32_4way = nullptr;
+TransformD32Type TransformD32_8way = nullptr;
+
+bool SelfTest()
+{
+    // Some input data to test with: 8 32-byte messages.
+    static const unsigned char data[258] = "-" // Intentionally not aligned
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+        "eiusmod tempor incididunt ut labore et dolore magna aliqua. Et m"
+        "olestie ac feugiat sed lectus vestibulum mattis ullamcorper. Mor"
+        "bi blandit cursus risus at ultrices mi tempus imperdiet nulla. N";
+    // Expected RIPEMD-160 of the first 32-byte message.
+    static const unsigned char result_d32[20] = {
+        0xdd, 0xd9, 0xb3, 0x6b, 0x4e, 0x41, 0x2e, 0x2a, 0x91, 0xa9,
+        0x25, 0x79, 0x6b, 0xcf, 0x24, 0xc5, 0x78, 0x0a, 0xc4, 0xf7
+    };
+
+    unsigned char expected[160];
+    for (int i = 0; i < 8; ++i) {
+        ripemd160::TransformD32(expected + 20 * i, data + 1 + 32 * i);
+    }
+    if (!std::equal(expected, expected + 20, result_d32)) return false;
+
+    // Test TransformD32_4way against the scalar code, if available.
+    if (TransformD32_4way) {
+        unsigned char out[80];
+        TransformD32_4way(out, data + 1);
+        if (!std::equal(out, out + 80, expected)) return false;
+    }
+
+    // Test TransformD32_8way against the scalar code, if available.
+    if (TransformD32_8way) {
+        unsigned char out[160];
+        TransformD32_8way(out, data + 1);
+        if (!std::equal(out, out + 160, expected)) return false;
+    }
+
+    return true;
+}
+
+#if !defined(DISABLE_OPTIMIZED_RIPEMD160)
+#if (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+#endif // DISABLE_OPTIMIZED_RIPEMD160
+
 } // namespace
 
+std::string RIPEMD160AutoDetect(ripemd160_implementation::UseImplementation use_implementation)
+{
+    std::string ret = "standard";
+    TransformD32_4way = nullptr;
+    TransformD32_8way = nullptr;
+
+#if !defined(DISABLE_OPTIMIZED_RIPEMD160)
+#if defined(HAVE_GETCPUID)
+    [[maybe_unused]] bool have_sse4 = false;
+    [[maybe_unused]] bool have_avx2 = false;
+    [[maybe_unused]] bool enabled_avx = false;
+
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    if (use_implementation & ripemd160_implementation::USE_SSE41) {
+        have_sse4 = (ecx >> 19) & 1;
+    }
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        enabled_avx = AVXEnabled();
+    }
+    if (use_implementation & ripemd160_implementation::USE_AVX2) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = ((ebx >> 5) & 1) && enabled_avx;
+    }
+
+#if defined(ENABLE_SSE41)
+    if (have_sse4) {
+        TransformD32_4way = ripemd160_multi_sse41::Transform_4way;
+        ret = "sse41(4way)";
+    }
+#endif
+#if defined(ENABLE_AVX2)
+    if (have_avx2) {
+        TransformD32_8way = ripemd160_multi_avx2::Transform_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+#endif // defined(HAVE_GETCPUID)
+#endif // DISABLE_OPTIMIZED_RIPEMD160
+
+    // Run the self-test in every build, not only under assert: a kernel that disagrees with the
+    // scalar code is never used.
+    if (!SelfTest()) {
+        TransformD32_4way = nullptr;
+        TransformD32_8way = nullptr;
+        ret = "standard";
+    }
+    return ret;
+}
+
 ////// RIPEMD160
 
 CRIPEMD160::CRIPEMD160()
@@ -290,3 +424,29 @@ CRIPEMD160& CRIPEMD160::Reset()
     ripemd160::Initialize(s);
     return *this;
 }
+
+void RIPEMD160D32(unsigned char* out, const unsigned char* in, size_t count)
+{
+    if (TransformD32_8way) {
+        while (count >= 8) {
+            TransformD32_8way(out, in);
+            out += 160;
+            in += 256;
+            count -= 8;
+        }
+    }
+    if (TransformD32_4way) {
+        while (count >= 4) {
+            TransformD32_4way(out, in);
+            out += 80;
+            in += 128;
+            count -= 4;
+        }
+    }
+    while (count) {
+        ripemd160::TransformD32(out, in);
+        out += 20;
+        in += 32;
+        --count;
+    }
+}
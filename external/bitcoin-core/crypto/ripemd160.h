@@ -5,8 +5,10 @@
 #ifndef BITCOIN_CRYPTO_RIPEMD160_H
 #define BITCOIN_CRYPTO_RIPEMD160_H
 
+#include <array>
 #include <cstdlib>
 #include <stdint.h>
+#include <string>
 
 /** A hasher class for RIPEMD-160. */
 class CRIPEMD160
@@ -25,4 +27,108 @@ public:
     CRIPEMD160& Reset();
 };
 
+namespace ripemd160_implementation {
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_SSE41 = 1 << 0,
+    USE_AVX2 = 1 << 1,
+    USE_ALL = USE_SSE41 | USE_AVX2,
+};
+}
+
+/** Autodetect the best available multi-way RIPEMD-160 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string RIPEMD160AutoDetect(ripemd160_implementation::UseImplementation use_implementation = ripemd160_implementation::USE_ALL);
+
+/** Compute multiple RIPEMD-160's of 32-byte blobs (such as the SHA-256 digest inside Hash160).
+ *  output:  pointer to a count*20 byte output buffer
+ *  input:   pointer to a count*32 byte input buffer
+ *  count:   the number of hashes to compute.
+ */
+void RIPEMD160D32(unsigned char* output, const unsigned char* input, size_t count);
+
+namespace ripemd160_constexpr {
+/** Message word and rotation of each of the 80 steps, for the left and the right line. */
+inline constexpr uint8_t R1[80] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+    3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12, 1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+    4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13};
+inline constexpr uint8_t R2[80] = {
+    5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12, 6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+    15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13, 8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+    12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11};
+inline constexpr uint8_t S1[80] = {
+    11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8, 7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+    11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5, 11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+    9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6};
+inline constexpr uint8_t S2[80] = {
+    8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6, 9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+    9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5, 15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+    8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11};
+inline constexpr uint32_t K1[5] = {0, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E};
+inline constexpr uint32_t K2[5] = {0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0};
+
+constexpr uint32_t Rol(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+/** Boolean function of round j (0-4); the right line uses them in reverse order. */
+constexpr uint32_t F(int j, uint32_t x, uint32_t y, uint32_t z)
+{
+    switch (j) {
+    case 0: return x ^ y ^ z;
+    case 1: return (x & y) | (~x & z);
+    case 2: return (x | ~y) ^ z;
+    case 3: return (x & z) | (y & ~z);
+    default: return x ^ (y | ~z);
+    }
+}
+
+/** One compression of a 64-byte chunk into the state s. */
+constexpr void Transform(uint32_t* s, const unsigned char* chunk)
+{
+    uint32_t w[16] = {};
+    for (int i = 0; i < 16; ++i) {
+        w[i] = chunk[4 * i] | uint32_t{chunk[4 * i + 1]} << 8 | uint32_t{chunk[4 * i + 2]} << 16 | uint32_t{chunk[4 * i + 3]} << 24;
+    }
+    uint32_t a1 = s[0], b1 = s[1], c1 = s[2], d1 = s[3], e1 = s[4];
+    uint32_t a2 = a1, b2 = b1, c2 = c1, d2 = d1, e2 = e1;
+    for (int i = 0; i < 80; ++i) {
+        const int j = i / 16;
+        const uint32_t t1 = Rol(a1 + F(j, b1, c1, d1) + w[R1[i]] + K1[j], S1[i]) + e1;
+        a1 = e1; e1 = d1; d1 = Rol(c1, 10); c1 = b1; b1 = t1;
+        const uint32_t t2 = Rol(a2 + F(4 - j, b2, c2, d2) + w[R2[i]] + K2[j], S2[i]) + e2;
+        a2 = e2; e2 = d2; d2 = Rol(c2, 10); c2 = b2; b2 = t2;
+    }
+    const uint32_t t = s[0];
+    s[0] = s[1] + c1 + d2;
+    s[1] = s[2] + d1 + e2;
+    s[2] = s[3] + e1 + a2;
+    s[3] = s[4] + a1 + b2;
+    s[4] = t + b1 + c2;
+}
+} // namespace ripemd160_constexpr
+
+/** Compute the RIPEMD-160 of a message in a constant expression, e.g. the Hash160 of a
+ *  compile-time public key together with SHA256Constexpr. Scalar and slow; at run time,
+ *  use CRIPEMD160 or RIPEMD160D32 instead.
+ */
+constexpr std::array<unsigned char, CRIPEMD160::OUTPUT_SIZE> RIPEMD160Constexpr(const unsigned char* input, size_t len)
+{
+    uint32_t s[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    size_t pos = 0;
+    for (; pos + 64 <= len; pos += 64) ripemd160_constexpr::Transform(s, input + pos);
+    // As in SHA-256, but the bit length is little-endian.
+    unsigned char tail[128] = {};
+    const size_t rest = len - pos;
+    for (size_t i = 0; i < rest; ++i) tail[i] = input[pos + i];
+    tail[rest] = 0x80;
+    const size_t blocks = rest + 9 <= 64 ? 1 : 2;
+    const uint64_t bits = uint64_t{len} * 8;
+    for (int i = 0; i < 8; ++i) tail[blocks * 64 - 8 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    for (size_t b = 0; b < blocks; ++b) ripemd160_constexpr::Transform(s, tail + 64 * b);
+    std::array<unsigned char, CRIPEMD160::OUTPUT_SIZE> hash{};
+    for (int i = 0; i < 20; ++i) hash[i] = static_cast<unsigned char>(s[i / 4] >> (8 * (i % 4)));
+    return hash;
+}
+
 #endif // BITCOIN_CRYPTO_RIPEMD160_H
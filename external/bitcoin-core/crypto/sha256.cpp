@@ -8,7 +8,6 @@
 #include <crypto/common.h>
 
 #include <algorithm>
-#include <cassert>
 #include <cstring>
 
 #if !defined(DISABLE_OPTIMIZED_SHA256)
@@ -60,6 +59,21 @@ namespace sha256d64_arm_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
 }
+
+namespace sha256_multi_x86_shani
+{
+void Transform_4way(uint32_t* s, const unsigned char* const* blocks);
+}
+
+namespace sha256_multi_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* const* blocks);
+}
+
+namespace sha256_multi_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* const* blocks);
+}
 #endif // DISABLE_OPTIMIZED_SHA256
 
 // Internal implementation code.
@@ -439,6 +453,9 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformDChecksumType)(unsigned char*, const unsigned char*, size_t);
+/** One compression per lane; state words are interleaved as s[word * lanes + lane]. */
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -484,6 +501,185 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
+
+/** Copy a message of at most SHA256_MULTI_MAX_INPUT bytes into pad and append the SHA-256
+ *  padding. Returns the number of 64-byte blocks used (1 or 2). */
+size_t PadShortMessage(unsigned char* pad, const unsigned char* msg, size_t len)
+{
+    const size_t blocks = len < 56 ? 1 : 2;
+    memcpy(pad, msg, len);
+    pad[len] = 0x80;
+    memset(pad + len + 1, 0, blocks * 64 - 9 - len);
+    WriteBE64(pad + blocks * 64 - 8, uint64_t{len} << 3);
+    return blocks;
+}
+
+/** Turn a 32-byte digest in pad into the padded single block hashed by the second round of SHA256d. */
+void PadDigest(unsigned char* pad)
+{
+    static const unsigned char padding[32] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    memcpy(pad + 32, padding, 32);
+}
+
+/** Double-SHA256 of a message of at most SHA256_SINGLE_BLOCK_MAX_INPUT bytes, keeping
+ *  only the first 4 output bytes: two single-block compressions, the second over a
+ *  block whose padding is precomputed. */
+template<TransformType tr>
+void TransformDChecksumWrapper(unsigned char* out, const unsigned char* in, size_t len)
+{
+    uint32_t s[8];
+    unsigned char buffer1[64];
+    unsigned char buffer2[64] = {
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    PadShortMessage(buffer1, in, len);
+    sha256::Initialize(s);
+    tr(s, buffer1, 1);
+    for (size_t i = 0; i < 8; ++i) WriteBE32(buffer2 + 4 * i, s[i]);
+    sha256::Initialize(s);
+    tr(s, buffer2, 1);
+    WriteBE32(out, s[0]);
+}
+
+TransformDChecksumType TransformDChecksum = TransformDChecksumWrapper<sha256::Transform>;
+
+/** Hash `lanes` equal-length short messages with one multi-way kernel. */
+template<size_t lanes>
+void TransformMultiLanes(TransformMultiType tr, unsigned char* out, const unsigned char* in, size_t len, bool twice)
+{
+    unsigned char pad[lanes][128];
+    const unsigned char* ptrs[lanes];
+    uint32_t s[8 * lanes];
+    size_t blocks = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        blocks = PadShortMessage(pad[lane], in + lane * len, len);
+    }
+    for (int round = 0; round < (twice ? 2 : 1); ++round) {
+        uint32_t init[8];
+        sha256::Initialize(init);
+        for (size_t i = 0; i < 8; ++i) {
+            std::fill(s + i * lanes, s + (i + 1) * lanes, init[i]);
+        }
+        for (size_t b = 0; b < blocks; ++b) {
+            for (size_t lane = 0; lane < lanes; ++lane) ptrs[lane] = pad[lane] + 64 * b;
+            tr(s, ptrs);
+        }
+        unsigned char* dst[lanes];
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            dst[lane] = round == 0 && twice ? pad[lane] : out + 32 * lane;
+            for (size_t i = 0; i < 8; ++i) WriteBE32(dst[lane] + 4 * i, s[i * lanes + lane]);
+            if (dst[lane] == pad[lane]) PadDigest(pad[lane]);
+        }
+        blocks = 1;
+    }
+}
+
+/** Hash one short message with the single-lane Transform. */
+void TransformShort(unsigned char* out, const unsigned char* in, size_t len, bool twice)
+{
+    unsigned char pad[128];
+    uint32_t s[8];
+    sha256::Initialize(s);
+    Transform(s, pad, PadShortMessage(pad, in, len));
+    if (twice) {
+        for (size_t i = 0; i < 8; ++i) WriteBE32(pad + 4 * i, s[i]);
+        PadDigest(pad);
+        sha256::Initialize(s);
+        Transform(s, pad, 1);
+    }
+    for (size_t i = 0; i < 8; ++i) WriteBE32(out + 4 * i, s[i]);
+}
+
+void SHA256MultiDispatch(unsigned char* out, const unsigned char* in, size_t len, size_t count, bool twice)
+{
+    if (len > SHA256_MULTI_MAX_INPUT) {
+        // Too long for the padded blocks of the lanes: hash each message on its own.
+        for (; count; --count, in += len, out += 32) {
+            CSHA256().Write(in, len).Finalize(out);
+            if (twice) CSHA256().Write(out, 32).Finalize(out);
+        }
+        return;
+    }
+    if (TransformMulti_8way) {
+        while (count >= 8) {
+            TransformMultiLanes<8>(TransformMulti_8way, out, in, len, twice);
+            out += 8 * 32;
+            in += 8 * len;
+            count -= 8;
+        }
+    }
+    if (TransformMulti_4way) {
+        while (count >= 4) {
+            TransformMultiLanes<4>(TransformMulti_4way, out, in, len, twice);
+            out += 4 * 32;
+            in += 4 * len;
+            count -= 4;
+        }
+    }
+    while (count) {
+        TransformShort(out, in, len, twice);
+        out += 32;
+        in += len;
+        --count;
+    }
+}
+
+/** Copy the unfinished block of a prefix and a message of at most SHA256_MULTI_MAX_INPUT bytes
+ *  into pad and append the padding for a message of total bytes in all. Returns the number of
+ *  64-byte blocks used (1 to 3). */
+size_t PadPrefixedMessage(unsigned char* pad, const unsigned char* head, size_t head_len, const unsigned char* msg, size_t len, uint64_t total)
+{
+    const size_t used = head_len + len;
+    const size_t blocks = (used + 72) / 64;
+    memcpy(pad, head, head_len);
+    if (len) memcpy(pad + head_len, msg, len);
+    pad[used] = 0x80;
+    memset(pad + used + 1, 0, blocks * 64 - 9 - used);
+    WriteBE64(pad + blocks * 64 - 8, total << 3);
+    return blocks;
+}
+
+/** Hash `lanes` equal-length messages after a common prefix with one multi-way kernel, every
+ *  lane starting from the prefix's state. */
+template<size_t lanes>
+void TransformPrefixedLanes(TransformMultiType tr, unsigned char* out, const CSHA256::Midstate& prefix, const unsigned char* in, size_t len)
+{
+    unsigned char pad[lanes][192];
+    const unsigned char* ptrs[lanes];
+    uint32_t s[8 * lanes];
+    size_t blocks = 0;
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        blocks = PadPrefixedMessage(pad[lane], prefix.buf, prefix.bytes % 64, in + lane * len, len, prefix.bytes + len);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        std::fill(s + i * lanes, s + (i + 1) * lanes, prefix.s[i]);
+    }
+    for (size_t b = 0; b < blocks; ++b) {
+        for (size_t lane = 0; lane < lanes; ++lane) ptrs[lane] = pad[lane] + 64 * b;
+        tr(s, ptrs);
+    }
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        for (size_t i = 0; i < 8; ++i) WriteBE32(out + 32 * lane + 4 * i, s[i * lanes + lane]);
+    }
+}
+
+/** Hash one message after a common prefix with the single-lane Transform. */
+void TransformPrefixedShort(unsigned char* out, const CSHA256::Midstate& prefix, const unsigned char* in, size_t len)
+{
+    unsigned char pad[192];
+    uint32_t s[8];
+    std::copy(prefix.s, prefix.s + 8, s);
+    Transform(s, pad, PadPrefixedMessage(pad, prefix.buf, prefix.bytes % 64, in, len, prefix.bytes + len));
+    for (size_t i = 0; i < 8; ++i) WriteBE32(out + 4 * i, s[i]);
+}
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -567,6 +763,36 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformDChecksum against the scalar Transform, for message lengths up to a full single block.
+    for (size_t len : {size_t{0}, size_t{21}, size_t{33}, size_t{34}, SHA256_SINGLE_BLOCK_MAX_INPUT}) {
+        unsigned char checksum[4], expected[4];
+        TransformDChecksum(checksum, data + 1, len);
+        TransformDChecksumWrapper<sha256::Transform>(expected, data + 1, len);
+        if (!std::equal(checksum, checksum + 4, expected)) return false;
+    }
+
+    // Test TransformMulti_4way and TransformMulti_8way, if available, against the scalar
+    // Transform: lane i compresses the i'th 64-byte block of the input data.
+    for (size_t lanes : {size_t{4}, size_t{8}}) {
+        TransformMultiType tr = lanes == 4 ? TransformMulti_4way : TransformMulti_8way;
+        if (!tr) continue;
+        uint32_t state[64];
+        const unsigned char* blocks[8];
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            blocks[lane] = data + 1 + 64 * lane;
+            for (size_t i = 0; i < 8; ++i) state[i * lanes + lane] = init[i];
+        }
+        tr(state, blocks);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint32_t expected[8];
+            std::copy(init, init + 8, expected);
+            sha256::Transform(expected, blocks[lane], 1);
+            for (size_t i = 0; i < 8; ++i) {
+                if (state[i * lanes + lane] != expected[i]) return false;
+            }
+        }
+    }
+
     return true;
 }
 
@@ -589,9 +815,12 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
     std::string ret = "standard";
     Transform = sha256::Transform;
     TransformD64 = sha256::TransformD64;
+    TransformDChecksum = TransformDChecksumWrapper<sha256::Transform>;
     TransformD64_2way = nullptr;
     TransformD64_4way = nullptr;
     TransformD64_8way = nullptr;
+    TransformMulti_4way = nullptr;
+    TransformMulti_8way = nullptr;
 
 #if !defined(DISABLE_OPTIMIZED_SHA256)
 #if defined(HAVE_GETCPUID)
@@ -626,8 +855,10 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
     if (have_x86_shani) {
         Transform = sha256_x86_shani::Transform;
         TransformD64 = TransformD64Wrapper<sha256_x86_shani::Transform>;
+        TransformDChecksum = TransformDChecksumWrapper<sha256_x86_shani::Transform>;
         TransformD64_2way = sha256d64_x86_shani::Transform_2way;
-        ret = "x86_shani(1way,2way)";
+        TransformMulti_4way = sha256_multi_x86_shani::Transform_4way;
+        ret = "x86_shani(1way,2way,multi4way)";
         have_sse4 = false; // Disable SSE4/AVX2;
         have_avx2 = false;
     }
@@ -637,18 +868,21 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
 #if defined(__x86_64__) || defined(__amd64__)
         Transform = sha256_sse4::Transform;
         TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
+        TransformDChecksum = TransformDChecksumWrapper<sha256_sse4::Transform>;
         ret = "sse4(1way)";
 #endif
 #if defined(ENABLE_SSE41)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
-        ret += ",sse41(4way)";
+        TransformMulti_4way = sha256_multi_sse41::Transform_4way;
+        ret += ",sse41(4way,multi4way)";
 #endif
     }
 
 #if defined(ENABLE_AVX2)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
-        ret += ",avx2(8way)";
+        TransformMulti_8way = sha256_multi_avx2::Transform_8way;
+        ret += ",avx2(8way,multi8way)";
     }
 #endif
 #endif // defined(HAVE_GETCPUID)
@@ -681,13 +915,26 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
     if (have_arm_shani) {
         Transform = sha256_arm_shani::Transform;
         TransformD64 = TransformD64Wrapper<sha256_arm_shani::Transform>;
+        TransformDChecksum = TransformDChecksumWrapper<sha256_arm_shani::Transform>;
         TransformD64_2way = sha256d64_arm_shani::Transform_2way;
         ret = "arm_shani(1way,2way)";
     }
 #endif
 #endif // DISABLE_OPTIMIZED_SHA256
 
-    assert(SelfTest());
+    // Run the self-test in every build, not only under assert: kernels that disagree with the
+    // scalar code are never used.
+    if (!SelfTest()) {
+        Transform = sha256::Transform;
+        TransformD64 = sha256::TransformD64;
+        TransformDChecksum = TransformDChecksumWrapper<sha256::Transform>;
+        TransformD64_2way = nullptr;
+        TransformD64_4way = nullptr;
+        TransformD64_8way = nullptr;
+        TransformMulti_4way = nullptr;
+        TransformMulti_8way = nullptr;
+        ret = "standard";
+    }
     return ret;
 }
 
@@ -748,6 +995,28 @@ CSHA256& CSHA256::Reset()
     return *this;
 }
 
+CSHA256::CSHA256(const Midstate& midstate)
+{
+    Restore(midstate);
+}
+
+CSHA256::Midstate CSHA256::Save() const
+{
+    Midstate midstate;
+    std::copy(s, s + 8, midstate.s);
+    std::copy(buf, buf + 64, midstate.buf);
+    midstate.bytes = bytes;
+    return midstate;
+}
+
+CSHA256& CSHA256::Restore(const Midstate& midstate)
+{
+    std::copy(midstate.s, midstate.s + 8, s);
+    std::copy(midstate.buf, midstate.buf + 64, buf);
+    bytes = midstate.bytes;
+    return *this;
+}
+
 void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
 {
     if (TransformD64_8way) {
@@ -781,3 +1050,60 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256DChecksum(unsigned char* out, const unsigned char* in, size_t len)
+{
+    if (len > SHA256_SINGLE_BLOCK_MAX_INPUT) {
+        // Too long for a single padded block.
+        unsigned char hash[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(in, len).Finalize(hash);
+        CSHA256().Write(hash, sizeof(hash)).Finalize(hash);
+        memcpy(out, hash, 4);
+        return;
+    }
+    TransformDChecksum(out, in, len);
+}
+
+void SHA256Multi(unsigned char* out, const unsigned char* in, size_t len, size_t count)
+{
+    SHA256MultiDispatch(out, in, len, count, false);
+}
+
+void SHA256DMulti(unsigned char* out, const unsigned char* in, size_t len, size_t count)
+{
+    SHA256MultiDispatch(out, in, len, count, true);
+}
+
+void SHA256MultiPrefixed(unsigned char* out, const CSHA256& prefix, const unsigned char* in, size_t len, size_t count)
+{
+    const CSHA256::Midstate midstate = prefix.Save();
+    if (len > SHA256_MULTI_MAX_INPUT) {
+        // Too long for the padded blocks of the lanes: hash each message on its own.
+        for (size_t i = 0; i < count; ++i) {
+            CSHA256(midstate).Write(in + i * len, len).Finalize(out + 32 * i);
+        }
+        return;
+    }
+    if (TransformMulti_8way) {
+        while (count >= 8) {
+            TransformPrefixedLanes<8>(TransformMulti_8way, out, midstate, in, len);
+            out += 8 * 32;
+            in += 8 * len;
+            count -= 8;
+        }
+    }
+    if (TransformMulti_4way) {
+        while (count >= 4) {
+            TransformPrefixedLanes<4>(TransformMulti_4way, out, midstate, in, len);
+            out += 4 * 32;
+            in += 4 * len;
+            count -= 4;
+        }
+    }
+    while (count) {
+        TransformPrefixedShort(out, midstate, in, len);
+        out += 32;
+        in += len;
+        --count;
+    }
+}
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_CRYPTO_SHA256_H
 #define BITCOIN_CRYPTO_SHA256_H
 
+#include <array>
 #include <cstdlib>
 #include <stdint.h>
 #include <string>
@@ -20,10 +21,22 @@ private:
 public:
     static const size_t OUTPUT_SIZE = 32;
 
+    /** Snapshot of a hasher's state: the compressed blocks, the bytes of the unfinished block and the
+     *  length written so far. Restoring it resumes hashing after a common prefix without compressing
+     *  the prefix again. Copying a CSHA256 clones it the same way. */
+    struct Midstate {
+        uint32_t s[8];
+        unsigned char buf[64];
+        uint64_t bytes;
+    };
+
     CSHA256();
+    explicit CSHA256(const Midstate& midstate);
     CSHA256& Write(const unsigned char* data, size_t len);
     void Finalize(unsigned char hash[OUTPUT_SIZE]);
     CSHA256& Reset();
+    Midstate Save() const;
+    CSHA256& Restore(const Midstate& midstate);
 };
 
 namespace sha256_implementation {
@@ -50,4 +63,103 @@ std::string SHA256AutoDetect(sha256_implementation::UseImplementation use_implem
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Longest message whose padded form fits in a single 64-byte block. */
+static constexpr size_t SHA256_SINGLE_BLOCK_MAX_INPUT = 55;
+
+/** Compute the first 4 bytes of the double-SHA256 of a short message, i.e. its
+ *  Base58Check checksum, with two single-block compressions.
+ *  output:  pointer to a 4 byte output buffer
+ *  input:   pointer to the message
+ *  len:     the length of the message; longer than SHA256_SINGLE_BLOCK_MAX_INPUT, it is
+ *           hashed with CSHA256
+ */
+void SHA256DChecksum(unsigned char* output, const unsigned char* input, size_t len);
+
+/** Longest message SHA256Multi / SHA256DMulti hash in lanes (it must pad into two blocks). */
+static constexpr size_t SHA256_MULTI_MAX_INPUT = 119;
+
+/** Compute the SHA256's of multiple independent messages of the same short length.
+ *  Messages are hashed 8, 4 or 1 at a time depending on the kernels selected by SHA256AutoDetect.
+ *  output:  pointer to a count*32 byte output buffer
+ *  input:   pointer to a count*len byte input buffer, messages back to back
+ *  len:     the length of each message; messages longer than SHA256_MULTI_MAX_INPUT are
+ *           hashed one at a time with CSHA256
+ *  count:   the number of hashes to compute.
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* input, size_t len, size_t count);
+
+/** Same as SHA256Multi, but computes double-SHA256's. */
+void SHA256DMulti(unsigned char* output, const unsigned char* input, size_t len, size_t count);
+
+/** Compute the SHA256's of multiple messages that share a prefix: the data written to prefix,
+ *  followed by each of the inputs. The prefix's whole blocks are not compressed again; only its
+ *  unfinished block and the inputs are, 8, 4 or 1 messages at a time as in SHA256Multi.
+ *  output:  pointer to a count*32 byte output buffer
+ *  prefix:  a hasher holding the prefix; it is left unchanged
+ *  input:   pointer to a count*len byte input buffer, messages back to back
+ *  len:     the length of each input; inputs longer than SHA256_MULTI_MAX_INPUT are hashed
+ *           one at a time with CSHA256
+ *  count:   the number of hashes to compute.
+ */
+void SHA256MultiPrefixed(unsigned char* output, const CSHA256& prefix, const unsigned char* input, size_t len, size_t count);
+
+namespace sha256_constexpr {
+inline constexpr uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+constexpr uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+/** One compression of a 64-byte chunk into the state s. */
+constexpr void Transform(uint32_t* s, const unsigned char* chunk)
+{
+    uint32_t w[64] = {};
+    for (int i = 0; i < 16; ++i) {
+        w[i] = uint32_t{chunk[4 * i]} << 24 | uint32_t{chunk[4 * i + 1]} << 16 | uint32_t{chunk[4 * i + 2]} << 8 | chunk[4 * i + 3];
+    }
+    for (int i = 16; i < 64; ++i) {
+        const uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+        const uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        const uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+} // namespace sha256_constexpr
+
+/** Compute the SHA256 of a message in a constant expression, e.g. a Base58Check checksum of a
+ *  compile-time constant. This is a plain scalar implementation with no CPU dispatch: at run
+ *  time, use CSHA256 or the functions above instead.
+ */
+constexpr std::array<unsigned char, CSHA256::OUTPUT_SIZE> SHA256Constexpr(const unsigned char* input, size_t len)
+{
+    uint32_t s[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    size_t pos = 0;
+    for (; pos + 64 <= len; pos += 64) sha256_constexpr::Transform(s, input + pos);
+    // The tail, the 0x80 terminator and the big-endian bit length pad into one or two blocks.
+    unsigned char tail[128] = {};
+    const size_t rest = len - pos;
+    for (size_t i = 0; i < rest; ++i) tail[i] = input[pos + i];
+    tail[rest] = 0x80;
+    const size_t blocks = rest + 9 <= 64 ? 1 : 2;
+    const uint64_t bits = uint64_t{len} * 8;
+    for (int i = 0; i < 8; ++i) tail[blocks * 64 - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    for (size_t b = 0; b < blocks; ++b) sha256_constexpr::Transform(s, tail + 64 * b);
+    std::array<unsigned char, CSHA256::OUTPUT_SIZE> hash{};
+    for (int i = 0; i < 32; ++i) hash[i] = static_cast<unsigned char>(s[i / 4] >> (24 - 8 * (i % 4)));
+    return hash;
+}
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -129,6 +129,16 @@ public:
         return result;
     }
 
+    /** Compute the SHA256 hashes of all data written to this object followed by each of count
+     *  inputs of len bytes each; see SHA256MultiPrefixed.
+     *
+     * Leaves this object unchanged, so it can be kept as a shared prefix, such as a TaggedHash.
+     */
+    void GetSHA256Multi(unsigned char* output, const unsigned char* input, size_t len, size_t count) const
+    {
+        SHA256MultiPrefixed(output, ctx, input, len, count);
+    }
+
     /**
      * Returns the first 64 bits from the resulting hash.
      */
@@ -214,9 +224,20 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
  *
  * The returned object will have SHA256(tag) written to it twice (= 64 bytes).
  * A tagged hash can be computed by feeding the message into this object, and
- * then calling HashWriter::GetSHA256().
+ * then calling HashWriter::GetSHA256(). The prefix is one whole block, so a
+ * copy of the object resumes from its midstate, and GetSHA256Multi hashes many
+ * messages under the same tag.
+ *
+ * Defined here because hash.cpp is not part of the curated sources.
  */
-HashWriter TaggedHash(const std::string& tag);
+inline HashWriter TaggedHash(const std::string& tag)
+{
+    HashWriter writer{};
+    uint256 taghash;
+    CSHA256().Write((const unsigned char*)tag.data(), tag.size()).Finalize(taghash.begin());
+    writer << taghash << taghash;
+    return writer;
+}
 
 /** Compute the 160-bit RIPEMD-160 hash of an array. */
 inline uint160 RIPEMD160(Span<const unsigned char> data)
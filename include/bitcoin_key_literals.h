@@ -0,0 +1,227 @@
+#pragma once
+
+#include "bitcoin_key_utils.h"
+
+#include "base58.h"
+#include "bech32.h"
+#include "crypto/ripemd160.h"
+#include "crypto/sha256.h"
+
+#include <utility>
+
+/**
+ * Keys, hashes and addresses fixed in the source, encoded or checked while compiling.
+ *
+ * The functions mirror NoAlloc and report the same ErrorCodes, but are constexpr: they run on
+ * the constexpr Base58, Bech32, SHA-256 and RIPEMD-160 code of the curated sources. Wrapping a
+ * call in Require, or using one of the literal operators, turns it into a compile-time
+ * constant, and a typo into a compile error naming the ErrorCode:
+ *
+ *   using namespace BitcoinKeyUtils::Literals;
+ *   constexpr auto change = "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4"_p2wpkh;
+ *   constexpr auto hash = Require(DecodeAddress(change)).hash;
+ *
+ * They also run at run time, where NoAlloc is faster: hashing here has no SIMD dispatch.
+ */
+namespace BitcoinKeyUtils::Literals {
+
+namespace detail {
+
+// Not constexpr: reaching one during constant evaluation is the compile error, and its template
+// argument names the reason.
+template <ErrorCode Code>
+void InvalidLiteral() {}
+
+template <size_t... Codes>
+constexpr void Reject(ErrorCode code, std::index_sequence<Codes...>) {
+    ((static_cast<size_t>(code) == Codes ? InvalidLiteral<static_cast<ErrorCode>(Codes)>() : void()), ...);
+}
+
+// The lowercase HRP of the segwit networks NoAlloc accepts.
+constexpr std::expected<std::string_view, ErrorCode> SegwitHRP(std::string_view hrp) {
+    if (hrp == "bc" || hrp == "BC") return "bc";
+    if (hrp == "tb" || hrp == "TB") return "tb";
+    return std::unexpected(ErrorCode::InvalidHRP);
+}
+
+template <size_t Capacity>
+constexpr InlineString<Capacity> Copy(std::string_view text) {
+    InlineString<Capacity> result;
+    for (size_t i = 0; i < text.size() && i < Capacity; ++i) result.chars[i] = text[i];
+    result.length = static_cast<uint8_t>(text.size() < Capacity ? text.size() : Capacity);
+    return result;
+}
+
+}
+
+/**
+ * @brief Value of a constexpr call, or a compile error naming its ErrorCode.
+ * @param result The result of one of the functions below, or of any constant expression returning std::expected.
+ */
+template <typename T>
+consteval T Require(std::expected<T, ErrorCode> result) {
+    if (!result) detail::Reject(result.error(), std::make_index_sequence<Metrics::ErrorCodeCount>{});
+    return *result;
+}
+
+/** @brief Constexpr NoAlloc::EncodeWIF. */
+constexpr std::expected<WIFString, ErrorCode> EncodeWIF(std::span<const uint8_t, Constants::PrivateKeySize> privateKey, bool compressed) {
+    uint8_t payload[Constants::PrivateKeySize + 2] = {Constants::MainNet};
+    for (size_t i = 0; i < privateKey.size(); ++i) payload[i + 1] = privateKey[i];
+    payload[Constants::PrivateKeySize + 1] = Constants::CompressMagic;
+    WIFString wif;
+    const size_t written = compressed ? EncodeBase58CheckFixed<Constants::PrivateKeySize + 2>(payload, Span{wif.chars})
+                                      : EncodeBase58CheckFixed<Constants::PrivateKeySize + 1>(payload, Span{wif.chars});
+    if (written == 0) {
+        return std::unexpected(ErrorCode::Base58CheckEncodingFailed);
+    }
+    wif.length = static_cast<uint8_t>(written);
+    return wif;
+}
+
+/** @brief Constexpr NoAlloc::DecodeWIF: the private key and whether it is compressed. */
+constexpr std::expected<std::pair<PrivateKey, bool>, ErrorCode> DecodeWIF(std::string_view wifString) {
+    const bool compressed = wifString.size() == Constants::WIFStride;
+    if (!compressed && wifString.size() != Constants::WIFStride - 1) {
+        return std::unexpected(ErrorCode::InvalidWIFLength);
+    }
+    uint8_t payload[Constants::PrivateKeySize + 2] = {};
+    const bool decoded = compressed ? DecodeBase58CheckFixed<Constants::PrivateKeySize + 2>(wifString, payload)
+                                    : DecodeBase58CheckFixed<Constants::PrivateKeySize + 1>(wifString, payload);
+    if (!decoded) {
+        return std::unexpected(ErrorCode::Base58CheckDecodingFailed);
+    }
+    if (payload[0] != Constants::MainNet) {
+        return std::unexpected(ErrorCode::InvalidNetworkPrefix);
+    }
+    if (compressed && payload[Constants::PrivateKeySize + 1] != Constants::CompressMagic) {
+        return std::unexpected(ErrorCode::InvalidCompressionFlag);
+    }
+    std::pair<PrivateKey, bool> result{{}, compressed};
+    for (size_t i = 0; i < result.first.size(); ++i) result.first[i] = payload[i + 1];
+    return result;
+}
+
+/** @brief Constexpr NoAlloc::HashRIPEMD160SHA256. */
+constexpr std::expected<Hash160Digest, ErrorCode> HashRIPEMD160SHA256(std::span<const uint8_t> data) {
+    if (data.empty()) {
+        return std::unexpected(ErrorCode::EmptyData);
+    }
+    const auto sha256 = SHA256Constexpr(data.data(), data.size());
+    const auto ripemd160 = RIPEMD160Constexpr(sha256.data(), sha256.size());
+    Hash160Digest hash;
+    for (size_t i = 0; i < hash.size(); ++i) hash[i] = ripemd160[i];
+    return hash;
+}
+
+/** @brief Constexpr NoAlloc::GenerateP2PKHAddress. */
+constexpr std::expected<P2PKHString, ErrorCode> GenerateP2PKHAddress(std::span<const uint8_t, Constants::Hash160Size> pubKeyHash) {
+    uint8_t payload[Constants::Hash160Size + 1] = {Constants::P2PKHPrefix};
+    for (size_t i = 0; i < pubKeyHash.size(); ++i) payload[i + 1] = pubKeyHash[i];
+    P2PKHString address;
+    const size_t written = EncodeBase58CheckFixed<Constants::Hash160Size + 1>(payload, Span{address.chars});
+    if (written == 0) {
+        return std::unexpected(ErrorCode::Base58CheckEncodingFailed);
+    }
+    address.length = static_cast<uint8_t>(written);
+    return address;
+}
+
+/** @brief Constexpr NoAlloc::GenerateP2WPKHAddress. */
+constexpr std::expected<P2WPKHString, ErrorCode> GenerateP2WPKHAddress(std::span<const uint8_t, Constants::Hash160Size> pubKeyHash, std::string_view hrp = Constants::Bech32MainnetHRP) {
+    const auto hrp_lc = detail::SegwitHRP(hrp);
+    if (!hrp_lc) {
+        return std::unexpected(hrp_lc.error());
+    }
+    P2WPKHString address;
+    const size_t written = bech32::EncodeWitnessProgram(bech32::Encoding::BECH32, *hrp_lc, bech32::HrpPolyModState(*hrp_lc),
+                                                        Constants::WitnessVersion0, Span{pubKeyHash.data(), pubKeyHash.size()}, Span{address.chars});
+    if (written == 0) {
+        return std::unexpected(ErrorCode::Bech32EncodingFailed);
+    }
+    address.length = static_cast<uint8_t>(written);
+    return address;
+}
+
+/** @brief Constexpr NoAlloc::DecodeAddress, with the same checks in the same order. */
+constexpr std::expected<DecodedAddress, ErrorCode> DecodeAddress(std::string_view address, std::string_view hrp = Constants::Bech32MainnetHRP) {
+    const auto hrp_lc = detail::SegwitHRP(hrp);
+    if (!hrp_lc) {
+        return std::unexpected(hrp_lc.error());
+    }
+    DecodedAddress result;
+    if (BitcoinKeyUtils::detail::HasSegwitPrefix(address, *hrp_lc)) {
+        if (address.size() > bech32::CharLimit::BECH32) {
+            return std::unexpected(ErrorCode::InvalidAddressLength);
+        }
+        for (const char c : address.substr(hrp_lc->size() + 1)) {
+            if (static_cast<unsigned char>(c) >= 128 || bech32::CHARSET_REV[static_cast<unsigned char>(c)] == -1) {
+                return std::unexpected(ErrorCode::InvalidAddressCharacter);
+            }
+        }
+        uint8_t version = 0;
+        uint8_t program[bech32::MAX_WITNESS_PROGRAM_SIZE] = {};
+        const size_t size = bech32::DecodeWitnessProgram(bech32::Encoding::BECH32, *hrp_lc, bech32::HrpPolyModState(*hrp_lc), address, version, Span{program});
+        if (size == 0) {
+            return std::unexpected(ErrorCode::Bech32DecodingFailed);
+        }
+        if (version != Constants::WitnessVersion0 || size != Constants::Hash160Size) {
+            return std::unexpected(ErrorCode::InvalidWitnessProgram);
+        }
+        result.type = AddressType::P2WPKH;
+        for (size_t i = 0; i < result.hash.size(); ++i) result.hash[i] = program[i];
+        return result;
+    }
+
+    if (address.empty() || address.size() > Constants::P2PKHStride) {
+        return std::unexpected(ErrorCode::InvalidAddressLength);
+    }
+    for (const char c : address) {
+        if (BASE58_DIGITS[static_cast<unsigned char>(c)] == -1) {
+            return std::unexpected(ErrorCode::InvalidAddressCharacter);
+        }
+    }
+    uint8_t payload[Constants::Hash160Size + 1] = {};
+    if (!DecodeBase58CheckFixed<Constants::Hash160Size + 1>(address, payload)) {
+        return std::unexpected(ErrorCode::Base58CheckDecodingFailed);
+    }
+    if (payload[0] != Constants::P2PKHPrefix) {
+        return std::unexpected(ErrorCode::InvalidNetworkPrefix);
+    }
+    result.type = AddressType::P2PKH;
+    for (size_t i = 0; i < result.hash.size(); ++i) result.hash[i] = payload[i + 1];
+    return result;
+}
+
+/** @brief A mainnet WIF private key checked at compile time, e.g. "5HpHag..."_wif. */
+consteval WIFString operator""_wif(const char* chars, size_t size) {
+    Require(DecodeWIF({chars, size}));
+    return detail::Copy<Constants::WIFStride>({chars, size});
+}
+
+namespace detail {
+
+// DecodeAddress, rejecting an address of the other type as InvalidNetworkPrefix.
+constexpr std::expected<DecodedAddress, ErrorCode> DecodeAddressOf(AddressType type, std::string_view address) {
+    auto decoded = DecodeAddress(address);
+    if (decoded && decoded->type != type) {
+        return std::unexpected(ErrorCode::InvalidNetworkPrefix);
+    }
+    return decoded;
+}
+
+}
+
+/** @brief A mainnet P2PKH address checked at compile time, e.g. "1BgGZ9..."_p2pkh. */
+consteval P2PKHString operator""_p2pkh(const char* chars, size_t size) {
+    Require(detail::DecodeAddressOf(AddressType::P2PKH, {chars, size}));
+    return detail::Copy<Constants::P2PKHStride>({chars, size});
+}
+
+/** @brief A mainnet P2WPKH address checked at compile time, e.g. "bc1qw5..."_p2wpkh. */
+consteval P2WPKHString operator""_p2wpkh(const char* chars, size_t size) {
+    Require(detail::DecodeAddressOf(AddressType::P2WPKH, {chars, size}));
+    return detail::Copy<Constants::P2WPKHStride>({chars, size});
+}
+
+}
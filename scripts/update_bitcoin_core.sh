@@ -14,6 +14,18 @@ mkdir -p "$DEST_DIR"
 
 WORK_DIR="${ROOT_DIR}/.tmp/bitcoin-core-src"
 
+# Local changes to the curated files, one unified diff per file against the
+# pinned upstream revision. They are applied after every sync; code that is
+# ours alone lives in src/ instead.
+PATCH_DIR="${ROOT_DIR}/scripts/bitcoin-core-patches"
+
+# --refresh-patches: rewrite PATCH_DIR from the current tree instead of
+# syncing. Run it with the BTC_TAG / BTC_COMMIT the tree was synced from.
+REFRESH_PATCHES=0
+if [[ "${1:-}" == "--refresh-patches" ]]; then
+  REFRESH_PATCHES=1
+fi
+
 # The exact files project relays on (relative to the Bitcoin Core repo root)
 FILES=(
   # Source files (5 files needed by KeyManager)
@@ -56,6 +68,12 @@ FILES=(
 # --- Helpers -----------------------------------------------------------------
 die() { echo "ERROR: $*" >&2; exit 1; }
 
+# 'src/crypto/sha256.cpp' -> 'crypto/sha256.cpp'; COPYING stays COPYING
+dest_rel() { local f="$1"; echo "${f#src/}"; }
+
+# 'crypto/sha256.cpp' -> PATCH_DIR/crypto_sha256.cpp.patch
+patch_file() { local rel="$1"; echo "${PATCH_DIR}/${rel//\//_}.patch"; }
+
 # --- Fetch source -------------------------------------------------------------
 echo ">> Preparing work dir: ${WORK_DIR}"
 rm -rf "${WORK_DIR}"
@@ -81,6 +99,26 @@ echo ">> Using Bitcoin Core @ ${COMMIT_HASH}"
 
 popd >/dev/null
 
+# --- Refresh the patch set ---------------------------------------------------
+if [[ "${REFRESH_PATCHES}" == 1 ]]; then
+  echo ">> Refreshing ${PATCH_DIR} against ${COMMIT_HASH}"
+  mkdir -p "${PATCH_DIR}"
+  rm -f "${PATCH_DIR}"/*.patch
+  for f in "${FILES[@]}"; do
+    rel="$(dest_rel "${f}")"
+    # diff exits 1 when the files differ, which is the case we keep
+    if ! diff -u --label "a/external/bitcoin-core/${rel}" --label "b/external/bitcoin-core/${rel}" \
+        "${WORK_DIR}/${f}" "${DEST_DIR}/${rel}" > "$(patch_file "${rel}")"; then
+      echo "   patched: ${rel}"
+    else
+      rm -f "$(patch_file "${rel}")"
+    fi
+  done
+  rm -rf "${WORK_DIR}"
+  echo ">> Done. Review and commit ${PATCH_DIR}"
+  exit 0
+fi
+
 # --- Copy curated files -------------------------------------------------------
 echo ">> Updating ${DEST_DIR}"
 # Keep your local CMakeLists.txt; refresh everything else we manage.
@@ -89,18 +127,22 @@ find "${DEST_DIR}" -mindepth 1 -not -name 'CMakeLists.txt' -exec rm -rf {} +
 
 for f in "${FILES[@]}"; do
   src="${WORK_DIR}/${f}"
-  # map 'src/... -> DEST_DIR/...'
-  # COPYING stays at DEST_DIR/COPYING
-  rel="${f#src/}"
-  if [[ "${f}" == "COPYING" ]]; then
-    rel="COPYING"
-  fi
-  out="${DEST_DIR}/${rel}"
+  out="${DEST_DIR}/$(dest_rel "${f}")"
   mkdir -p "$(dirname "${out}")"
   [[ -f "${src}" ]] || die "File not found in repo: ${f}"
   cp "${src}" "${out}"
 done
 
+# --- Apply local patches ------------------------------------------------------
+PATCHED=()
+for p in "${PATCH_DIR}"/*.patch; do
+  [[ -f "${p}" ]] || continue
+  echo ">> Applying $(basename "${p}")"
+  patch -p1 --batch --silent -d "${ROOT_DIR}" < "${p}" \
+    || die "$(basename "${p}") does not apply to ${COMMIT_HASH}; rebase it onto the new revision"
+  PATCHED+=("$(basename "${p}" .patch)")
+done
+
 # --- Record provenance --------------------------------------------------------
 echo "${COMMIT_HASH}" > "${DEST_DIR}/VERSION.txt"
 
@@ -113,6 +155,15 @@ Updated by          : scripts/update_bitcoin_core.sh
 
 Only the files listed in that script are synced here.
 License: see COPYING (MIT).
+
+Local patches : scripts/bitcoin-core-patches/ (applied after every sync)
+$(printf '  %s\n' "${PATCHED[@]}")
+
+The patches add the batch, multi-lane and fixed-length paths the library
+builds on (SHA-256 and RIPEMD-160 multi-buffer dispatch, SHA-256 midstates,
+fixed-size Base58 and Bech32 codecs, HashWriter helpers). Their SIMD kernels
+are not Bitcoin Core code and live in src/. After editing a patched file, run
+'scripts/update_bitcoin_core.sh --refresh-patches' and commit the result.
 EOF
 
 
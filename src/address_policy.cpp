@@ -0,0 +1,299 @@
+#include "bitcoin_key_utils.h"
+#include "batch_internal.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <array>
+
+#include "base58.h"
+#include "bech32.h"
+#include "crypto/ripemd160.h"
+#include "crypto/sha256.h"
+
+namespace BitcoinKeyUtils {
+
+namespace {
+
+// Length of the Base58 encoding of Size bytes: the prefix, then every other byte set to fill.
+template <size_t Size>
+constexpr size_t Base58Length(uint8_t prefix, uint8_t fill) {
+    unsigned char data[Size] = {prefix};
+    for (size_t i = 1; i < Size; ++i) data[i] = fill;
+    char out[MaxBase58Length<Size>()] = {};
+    return EncodeBase58Fixed<Size>(data, Span{out});
+}
+
+// The lengths in the network policies, and the WIF lengths every version byte shares.
+template <typename Network>
+constexpr bool CheckLengths() {
+    constexpr size_t address = Constants::Hash160Size + 5;
+    constexpr size_t wif = Constants::PrivateKeySize + 5;
+    return Base58Length<address>(Network::P2PKHPrefix, 0xff) == Network::P2PKHLength &&
+           Base58Length<address>(Network::P2SHPrefix, 0xff) == Network::P2SHLength &&
+           Base58Length<wif>(Network::WIFPrefix, 0x00) == detail::UncompressedWIFLength && Base58Length<wif>(Network::WIFPrefix, 0xff) == detail::UncompressedWIFLength &&
+           Base58Length<wif + 1>(Network::WIFPrefix, 0x00) == detail::CompressedWIFLength && Base58Length<wif + 1>(Network::WIFPrefix, 0xff) == detail::CompressedWIFLength;
+}
+static_assert(CheckLengths<Policy::Mainnet>() && CheckLengths<Policy::Testnet>() && CheckLengths<Policy::Regtest>());
+static_assert(Policy::MaxAddressLength<Policy::Mainnet, Policy::P2PKH>() == Constants::P2PKHStride);
+static_assert(Policy::MaxAddressLength<Policy::Mainnet, Policy::P2WPKH>() == Constants::P2WPKHStride);
+static_assert(Policy::MaxAddressLength<Policy::Regtest, Policy::P2TR>() == Constants::AddressStride);
+
+// Checksum state of the network's HRP, so encoding and decoding only process the data part.
+template <typename Network>
+constexpr uint32_t HrpState = bech32::HrpPolyModState(Network::HRP);
+
+// BIP-350: witness version 0 is checksummed with Bech32, later versions with Bech32m.
+constexpr bech32::Encoding WitnessEncoding(uint8_t version) {
+    return version == Constants::WitnessVersion0 ? bech32::Encoding::BECH32 : bech32::Encoding::BECH32M;
+}
+
+template <typename Script>
+constexpr bool IsSegwit = Script::type == AddressType::P2WPKH || Script::type == AddressType::P2TR;
+
+// Base58Check of a version byte and a 20-byte hash.
+template <size_t Capacity>
+std::expected<InlineString<Capacity>, ErrorCode> EncodeHashAddress(uint8_t prefix, const uint8_t* hash) {
+    uint8_t payload[Constants::Hash160Size + 1] = {prefix};
+    std::copy_n(hash, Constants::Hash160Size, payload + 1);
+    InlineString<Capacity> address;
+    const size_t written = EncodeBase58CheckFixed<sizeof(payload)>(payload, Span{address.chars});
+    detail::metrics::AddBytesHashed(sizeof(payload));
+    if (written == 0) {
+        return std::unexpected(ErrorCode::Base58CheckEncodingFailed);
+    }
+    address.length = static_cast<uint8_t>(written);
+    return address;
+}
+
+}
+
+namespace Policy {
+
+template <typename Network>
+std::expected<WIFString, ErrorCode> EncodeWIF(std::span<const uint8_t, Constants::PrivateKeySize> privateKey, bool compressed) {
+    // Prefix, key, optional compression flag and checksum are built on the stack and wiped afterwards.
+    std::array<uint8_t, Constants::PrivateKeySize + 6> data;
+    detail::WipeOnExit wipeData{data};
+    data[0] = Network::WIFPrefix;
+    std::copy_n(privateKey.begin(), Constants::PrivateKeySize, data.begin() + 1);
+    const size_t payloadSize = Constants::PrivateKeySize + (compressed ? 2 : 1);
+    data[Constants::PrivateKeySize + 1] = Constants::CompressMagic;
+    SHA256DChecksum(data.data() + payloadSize, data.data(), payloadSize);
+    detail::metrics::AddBytesHashed(payloadSize);
+
+    WIFString wif;
+    const size_t written = compressed ? EncodeBase58Fixed<Constants::PrivateKeySize + 6>(data.data(), Span{wif.chars})
+                                      : EncodeBase58Fixed<Constants::PrivateKeySize + 5>(data.data(), Span{wif.chars});
+    if (written == 0) {
+        return std::unexpected(ErrorCode::Base58CheckEncodingFailed);
+    }
+    wif.length = static_cast<uint8_t>(written);
+    return wif;
+}
+
+template <typename Network>
+std::expected<bool, ErrorCode> DecodeWIF(std::string_view wifString, std::span<uint8_t, Constants::PrivateKeySize> privateKey) {
+    const bool compressed = wifString.size() == detail::CompressedWIFLength;
+    if (!compressed && wifString.size() != detail::UncompressedWIFLength) {
+        return std::unexpected(ErrorCode::InvalidWIFLength);
+    }
+
+    std::array<uint8_t, Constants::PrivateKeySize + 2> payload;
+    detail::WipeOnExit wipePayload{payload};
+    const size_t payloadSize = Constants::PrivateKeySize + (compressed ? 2 : 1);
+    if (!DecodeBase58Check(wifString, Span{payload.data(), payloadSize})) {
+        return std::unexpected(ErrorCode::Base58CheckDecodingFailed);
+    }
+    detail::metrics::AddBytesHashed(payloadSize);
+    if (payload[0] != Network::WIFPrefix) {
+        return std::unexpected(ErrorCode::InvalidNetworkPrefix);
+    }
+    if (compressed && payload[Constants::PrivateKeySize + 1] != Constants::CompressMagic) {
+        return std::unexpected(ErrorCode::InvalidCompressionFlag);
+    }
+    std::copy_n(payload.begin() + 1, Constants::PrivateKeySize, privateKey.begin());
+    return compressed;
+}
+
+template <typename Network, typename Script>
+std::expected<EncodedAddress<Network, Script>, ErrorCode> EncodeAddress(std::span<const uint8_t, Script::ProgramSize> program) {
+    constexpr size_t Capacity = MaxAddressLength<Network, Script>();
+    if constexpr (Script::script == ScriptType::P2PKH) {
+        return EncodeHashAddress<Capacity>(Network::P2PKHPrefix, program.data());
+    } else if constexpr (Script::script == ScriptType::P2SH_P2WPKH) {
+        // The redeem script is the P2WPKH output script: OP_0, then a push of the 20-byte hash.
+        uint8_t script[Constants::Hash160Size + 2] = {0x00, Constants::Hash160Size};
+        std::copy_n(program.begin(), Constants::Hash160Size, script + 2);
+        unsigned char sha256[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(script, sizeof(script)).Finalize(sha256);
+        detail::metrics::AddBytesHashed(sizeof(script));
+        uint8_t scriptHash[Constants::Hash160Size];
+        CRIPEMD160().Write(sha256, sizeof(sha256)).Finalize(scriptHash);
+        return EncodeHashAddress<Capacity>(Network::P2SHPrefix, scriptHash);
+    } else {
+        EncodedAddress<Network, Script> address;
+        const size_t written = bech32::EncodeWitnessProgram(WitnessEncoding(Script::WitnessVersion), Network::HRP, HrpState<Network>,
+                                                            Script::WitnessVersion, Span{program.data(), program.size()}, Span{address.chars});
+        if (written == 0) {
+            return std::unexpected(ErrorCode::Bech32EncodingFailed);
+        }
+        address.length = static_cast<uint8_t>(written);
+        return address;
+    }
+}
+
+template <typename Network>
+std::expected<AddressProgram, ErrorCode> DecodeAddress(std::string_view address) {
+    constexpr std::string_view hrp = Network::HRP;
+    AddressProgram result;
+    if (detail::HasSegwitPrefix(address, hrp)) {
+        if (address.size() > bech32::CharLimit::BECH32) {
+            return std::unexpected(ErrorCode::InvalidAddressLength);
+        }
+        const std::string_view data = address.substr(hrp.size() + 1);
+        if (bech32::FindInvalidCharacter(data) != data.size()) {
+            return std::unexpected(ErrorCode::InvalidAddressCharacter);
+        }
+        // The first data character is the witness version, which decides the checksum constant.
+        const uint8_t version = data.empty() ? 0 : static_cast<uint8_t>(bech32::CHARSET_REV[static_cast<unsigned char>(data[0])]);
+        uint8_t decodedVersion;
+        std::array<uint8_t, bech32::MAX_WITNESS_PROGRAM_SIZE> program;
+        const size_t size = bech32::DecodeWitnessProgram(WitnessEncoding(version), hrp, HrpState<Network>, address, decodedVersion, Span{program});
+        if (size == 0) {
+            return std::unexpected(ErrorCode::Bech32DecodingFailed);
+        }
+        if (decodedVersion == Constants::WitnessVersion0 && size == Constants::Hash160Size) {
+            result.type = AddressType::P2WPKH;
+        } else if (decodedVersion == Constants::WitnessVersion1 && size == Constants::XOnlyPubKeySize) {
+            result.type = AddressType::P2TR;
+        } else {
+            return std::unexpected(ErrorCode::InvalidWitnessProgram);
+        }
+        std::copy_n(program.begin(), size, result.bytes.begin());
+        result.length = static_cast<uint8_t>(size);
+        return result;
+    }
+
+    if (address.empty() || address.size() > std::max(Network::P2PKHLength, Network::P2SHLength)) {
+        return std::unexpected(ErrorCode::InvalidAddressLength);
+    }
+    if (FindInvalidBase58Character(address) != address.size()) {
+        return std::unexpected(ErrorCode::InvalidAddressCharacter);
+    }
+    std::array<uint8_t, Constants::Hash160Size + 1> payload;
+    if (!DecodeBase58Check(address, Span{payload})) {
+        return std::unexpected(ErrorCode::Base58CheckDecodingFailed);
+    }
+    detail::metrics::AddBytesHashed(payload.size());
+    if (payload[0] == Network::P2PKHPrefix) {
+        result.type = AddressType::P2PKH;
+    } else if (payload[0] == Network::P2SHPrefix) {
+        result.type = AddressType::P2SH;
+    } else {
+        return std::unexpected(ErrorCode::InvalidNetworkPrefix);
+    }
+    std::copy_n(payload.begin() + 1, Constants::Hash160Size, result.bytes.begin());
+    result.length = Constants::Hash160Size;
+    return result;
+}
+
+template <typename Network, typename Script>
+std::expected<std::array<uint8_t, Script::ProgramSize>, ErrorCode> DecodeAddress(std::string_view address) {
+    auto decoded = DecodeAddress<Network>(address);
+    if (!decoded) {
+        return std::unexpected(decoded.error());
+    }
+    if (decoded->type != Script::type) {
+        const bool segwit = decoded->type == AddressType::P2WPKH || decoded->type == AddressType::P2TR;
+        return std::unexpected(segwit && IsSegwit<Script> ? ErrorCode::InvalidWitnessProgram : ErrorCode::InvalidNetworkPrefix);
+    }
+    std::array<uint8_t, Script::ProgramSize> program;
+    std::copy_n(decoded->bytes.begin(), Script::ProgramSize, program.begin());
+    return program;
+}
+
+#define BITCOIN_KEY_UTILS_INSTANTIATE_SCRIPT(NETWORK, SCRIPT) \
+    template std::expected<EncodedAddress<NETWORK, SCRIPT>, ErrorCode> EncodeAddress<NETWORK, SCRIPT>(std::span<const uint8_t, SCRIPT::ProgramSize>); \
+    template std::expected<std::array<uint8_t, SCRIPT::ProgramSize>, ErrorCode> DecodeAddress<NETWORK, SCRIPT>(std::string_view);
+
+#define BITCOIN_KEY_UTILS_INSTANTIATE_NETWORK(NETWORK) \
+    template std::expected<WIFString, ErrorCode> EncodeWIF<NETWORK>(std::span<const uint8_t, Constants::PrivateKeySize>, bool); \
+    template std::expected<bool, ErrorCode> DecodeWIF<NETWORK>(std::string_view, std::span<uint8_t, Constants::PrivateKeySize>); \
+    template std::expected<AddressProgram, ErrorCode> DecodeAddress<NETWORK>(std::string_view); \
+    BITCOIN_KEY_UTILS_INSTANTIATE_SCRIPT(NETWORK, P2PKH) \
+    BITCOIN_KEY_UTILS_INSTANTIATE_SCRIPT(NETWORK, P2SH_P2WPKH) \
+    BITCOIN_KEY_UTILS_INSTANTIATE_SCRIPT(NETWORK, P2WPKH) \
+    BITCOIN_KEY_UTILS_INSTANTIATE_SCRIPT(NETWORK, P2TR)
+
+BITCOIN_KEY_UTILS_INSTANTIATE_NETWORK(Mainnet)
+BITCOIN_KEY_UTILS_INSTANTIATE_NETWORK(Testnet)
+BITCOIN_KEY_UTILS_INSTANTIATE_NETWORK(Regtest)
+
+#undef BITCOIN_KEY_UTILS_INSTANTIATE_NETWORK
+#undef BITCOIN_KEY_UTILS_INSTANTIATE_SCRIPT
+
+}
+
+namespace {
+
+// Call body with the policy type of a network chosen at run time.
+template <typename Body>
+auto WithNetwork(Network network, Body&& body) {
+    switch (network) {
+    case Network::Testnet: return body(Policy::Testnet{});
+    case Network::Regtest: return body(Policy::Regtest{});
+    case Network::Mainnet: break;
+    }
+    return body(Policy::Mainnet{});
+}
+
+template <typename Network, typename Script>
+std::expected<AddressString, ErrorCode> EncodeAddressAs(std::span<const uint8_t> program) {
+    if (program.size() != Script::ProgramSize) {
+        return std::unexpected(Script::script == ScriptType::P2TR ? ErrorCode::InvalidPubKeySize : ErrorCode::InvalidPubKeyHashSize);
+    }
+    auto encoded = Policy::EncodeAddress<Network, Script>(program.first<Script::ProgramSize>());
+    if (!encoded) {
+        return std::unexpected(encoded.error());
+    }
+    AddressString address;
+    std::copy_n(encoded->chars.begin(), encoded->length, address.chars.begin());
+    address.length = encoded->length;
+    return address;
+}
+
+}
+
+namespace NoAlloc {
+
+std::expected<WIFString, ErrorCode> EncodeWIF(Network network, std::span<const uint8_t, Constants::PrivateKeySize> privateKey, bool compressed) {
+    auto metered = detail::metrics::Scope(Metrics::Function::EncodeWIF);
+    return metered.Return(WithNetwork(network, [&]<typename N>(N) { return Policy::EncodeWIF<N>(privateKey, compressed); }));
+}
+
+std::expected<bool, ErrorCode> DecodeWIF(Network network, std::string_view wifString, std::span<uint8_t, Constants::PrivateKeySize> privateKey) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeWIF);
+    return metered.Return(WithNetwork(network, [&]<typename N>(N) { return Policy::DecodeWIF<N>(wifString, privateKey); }));
+}
+
+std::expected<AddressString, ErrorCode> EncodeAddress(Network network, ScriptType script, std::span<const uint8_t> program) {
+    auto metered = detail::metrics::Scope(Metrics::Function::EncodeAddress);
+    return metered.Return(WithNetwork(network, [&]<typename N>(N) {
+        switch (script) {
+        case ScriptType::P2SH_P2WPKH: return EncodeAddressAs<N, Policy::P2SH_P2WPKH>(program);
+        case ScriptType::P2WPKH: return EncodeAddressAs<N, Policy::P2WPKH>(program);
+        case ScriptType::P2TR: return EncodeAddressAs<N, Policy::P2TR>(program);
+        case ScriptType::P2PKH: break;
+        }
+        return EncodeAddressAs<N, Policy::P2PKH>(program);
+    }));
+}
+
+std::expected<AddressProgram, ErrorCode> DecodeAddress(Network network, std::string_view address) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeAddress);
+    return metered.Return(WithNetwork(network, [&]<typename N>(N) { return Policy::DecodeAddress<N>(address); }));
+}
+
+}
+
+}
@@ -0,0 +1,224 @@
+#include "bitcoin_key_utils.h"
+#include "batch_internal.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+namespace BitcoinKeyUtils {
+
+namespace {
+
+using Range = AddressPrefixRanges::Range;
+using Words = std::array<uint64_t, 3>;
+
+constexpr std::string_view Base58Alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+constexpr std::string_view Bech32Alphabet = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+// Bytes after the version byte of a P2PKH payload: the hash and the checksum.
+constexpr size_t PayloadBytes = Constants::Hash160Size + 4;
+
+// Unsigned 256-bit integer in little-endian limbs, wide enough for 58^33 and for the 192-bit payload.
+using U256 = std::array<uint64_t, 4>;
+
+U256 MulAdd(const U256& a, uint64_t m, uint64_t add) {
+    U256 r;
+    unsigned __int128 carry = add;
+    for (size_t i = 0; i < r.size(); ++i) {
+        carry += static_cast<unsigned __int128>(a[i]) * m;
+        r[i] = static_cast<uint64_t>(carry);
+        carry >>= 64;
+    }
+    return r;
+}
+
+U256 Power(uint64_t base, size_t exponent) {
+    U256 r{1};
+    while (exponent-- > 0) r = MulAdd(r, base, 0);
+    return r;
+}
+
+// a - 1, for a > 0.
+U256 Decrement(U256 a) {
+    for (uint64_t& limb : a) {
+        if (limb-- != 0) break;
+    }
+    return a;
+}
+
+bool Less(const U256& a, const U256& b) {
+    return std::lexicographical_compare(a.rbegin(), a.rend(), b.rbegin(), b.rend());
+}
+
+// A value below 2^192 as big-endian words.
+Words ToWords(const U256& a) {
+    return {a[2], a[1], a[0]};
+}
+
+std::unexpected<Error> PrefixError(ErrorCode code, std::string_view prefix, std::string_view why) {
+    return std::unexpected(Error{code, "Address prefix \"" + std::string(prefix) + "\" " + std::string(why)});
+}
+
+// A P2PKH address is '1' for the version byte, one more '1' per leading zero byte of the payload
+// value N, then the base58 digits of N. So after its leading '1's the prefix fixes how many zero
+// bytes N starts with, and its remaining digits d put N in [d, d+1) * 58^k for some k.
+std::expected<void, Error> AddP2PKHRanges(std::string_view prefix, std::vector<Range>& ranges) {
+    if (prefix.find_first_not_of(Base58Alphabet) != std::string_view::npos) {
+        return PrefixError(ErrorCode::InvalidAddressCharacter, prefix, "contains a character outside the Base58 alphabet");
+    }
+    const std::string_view rest = prefix.substr(1);
+    const size_t zeros = std::min(rest.find_first_not_of('1'), rest.size());
+    const std::string_view digits = rest.substr(zeros);
+    if (digits.empty() && zeros <= PayloadBytes) {
+        ranges.push_back({ToWords(U256{}), ToWords(Decrement(Power(256, PayloadBytes - zeros)))});
+        return {};
+    }
+    if (zeros >= PayloadBytes || prefix.size() > Constants::P2PKHStride) {
+        return PrefixError(ErrorCode::InvalidAddressPrefix, prefix, "is longer than any P2PKH address");
+    }
+
+    // N starts with exactly `zeros` zero bytes.
+    const U256 lo = Power(256, PayloadBytes - 1 - zeros);
+    const U256 hi = Decrement(Power(256, PayloadBytes - zeros));
+    U256 first{};
+    for (char c : digits) first = MulAdd(first, 58, Base58Alphabet.find(c));
+    U256 end = MulAdd(first, 1, 1);
+    const size_t before = ranges.size();
+    for (; !Less(hi, first); first = MulAdd(first, 58, 0), end = MulAdd(end, 58, 0)) {
+        const U256 a = Less(first, lo) ? lo : first;
+        const U256 b = Less(hi, Decrement(end)) ? hi : Decrement(end);
+        if (!Less(b, a)) ranges.push_back({ToWords(a), ToWords(b)});
+    }
+    if (ranges.size() == before) {
+        return PrefixError(ErrorCode::InvalidAddressPrefix, prefix, "does not start any P2PKH address");
+    }
+    return {};
+}
+
+// A P2WPKH address is the HRP, '1', 'q' for witness version 0, then 32 characters of 5 bits of the
+// hash each, so a prefix of those characters fixes the leading bits of the hash.
+std::expected<void, Error> AddP2WPKHRange(std::string_view prefix, std::string_view head, std::vector<Range>& ranges) {
+    const bool hasLower = std::any_of(prefix.begin(), prefix.end(), [](char c) { return c >= 'a' && c <= 'z'; });
+    const bool hasUpper = std::any_of(prefix.begin(), prefix.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+    if (hasLower && hasUpper) {
+        return PrefixError(ErrorCode::InvalidAddressPrefix, prefix, "mixes upper and lower case");
+    }
+    std::string lower(prefix);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+    const size_t fixed = std::min(head.size(), lower.size());
+    const std::string_view data = std::string_view(lower).substr(fixed);
+    if (std::string_view(lower).substr(0, fixed) != head.substr(0, fixed)) {
+        return PrefixError(ErrorCode::InvalidAddressPrefix, prefix, "is neither a P2PKH nor a P2WPKH address prefix");
+    }
+    if (data.find_first_not_of(Bech32Alphabet) != std::string_view::npos) {
+        return PrefixError(ErrorCode::InvalidAddressCharacter, prefix, "contains a character outside the Bech32 alphabet");
+    }
+    constexpr size_t HashCharacters = Constants::Hash160Size * 8 / 5;
+    if (data.size() > HashCharacters) {
+        return PrefixError(ErrorCode::InvalidAddressPrefix, prefix, "reaches into the P2WPKH checksum");
+    }
+
+    U256 first{};
+    for (char c : data) first = MulAdd(first, 32, Bech32Alphabet.find(c));
+    U256 end = MulAdd(first, 1, 1);
+    // Shift both above the hash bits left open and the checksum.
+    for (size_t bit = 5 * data.size(); bit < PayloadBytes * 8; ++bit) {
+        first = MulAdd(first, 2, 0);
+        end = MulAdd(end, 2, 0);
+    }
+    ranges.push_back({ToWords(first), ToWords(Decrement(end))});
+    return {};
+}
+
+// Sort the ranges and merge the ones that overlap.
+void Merge(std::vector<Range>& ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+    size_t out = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (out > 0 && ranges[i].first <= ranges[out - 1].last) {
+            ranges[out - 1].last = std::max(ranges[out - 1].last, ranges[i].last);
+        } else {
+            ranges[out++] = ranges[i];
+        }
+    }
+    ranges.resize(out);
+}
+
+// The range containing value, if any.
+bool Contains(std::span<const Range> ranges, const Words& value) {
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), value, [](const Range& r, const Words& v) { return r.last < v; });
+    return it != ranges.end() && it->first <= value;
+}
+
+bool MatchesP2PKH(std::span<const Range> ranges, const uint8_t* hash) {
+    if (ranges.empty()) return false;
+    // The hash with the smallest and largest checksum; only a hash that straddles the end of a range
+    // needs its real checksum.
+    Words low = {ReadBE64(hash), ReadBE64(hash + 8), uint64_t{ReadBE32(hash + 16)} << 32};
+    Words high = low;
+    high[2] |= 0xFFFFFFFF;
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), low, [](const Range& r, const Words& v) { return r.last < v; });
+    if (it == ranges.end() || high < it->first) return false;
+    if (it->first <= low && high <= it->last) return true;
+
+    uint8_t payload[Constants::Hash160Size + 1] = {Constants::P2PKHPrefix};
+    std::copy_n(hash, Constants::Hash160Size, payload + 1);
+    uint8_t checksum[4];
+    SHA256DChecksum(checksum, payload, sizeof(payload));
+    detail::metrics::AddBytesHashed(sizeof(payload));
+    low[2] |= ReadBE32(checksum);
+    return Contains(ranges, low);
+}
+
+bool MatchesP2WPKH(std::span<const Range> ranges, const uint8_t* hash) {
+    return !ranges.empty() && Contains(ranges, {ReadBE64(hash), ReadBE64(hash + 8), uint64_t{ReadBE32(hash + 16)} << 32});
+}
+
+}
+
+std::expected<AddressPrefixRanges, Error> CompileAddressPrefixes(std::span<const std::string_view> prefixes, std::string_view hrp) {
+    auto encoder = detail::SegwitV0Encoder(hrp);
+    if (!encoder) {
+        return std::unexpected(encoder.error());
+    }
+    std::string head(hrp);
+    std::transform(head.begin(), head.end(), head.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+    head += "1q";
+
+    AddressPrefixRanges ranges;
+    for (std::string_view prefix : prefixes) {
+        if (prefix.empty()) {
+            return PrefixError(ErrorCode::InvalidAddressPrefix, prefix, "is empty");
+        }
+        auto added = prefix[0] == '1' ? AddP2PKHRanges(prefix, ranges.p2pkh) : AddP2WPKHRange(prefix, head, ranges.p2wpkh);
+        if (!added) {
+            return std::unexpected(added.error());
+        }
+    }
+    Merge(ranges.p2pkh);
+    Merge(ranges.p2wpkh);
+    return ranges;
+}
+
+bool MatchesAddressPrefix(const AddressPrefixRanges& ranges, std::span<const uint8_t, Constants::Hash160Size> pubKeyHash) {
+    return MatchesP2WPKH(ranges.p2wpkh, pubKeyHash.data()) || MatchesP2PKH(ranges.p2pkh, pubKeyHash.data());
+}
+
+std::expected<size_t, Error> FindAddressPrefixMatches(const AddressPrefixRanges& ranges, std::span<const uint8_t> pubKeyHashes, std::span<size_t> matches) {
+    auto count = detail::CheckBatchSizes(pubKeyHashes.size(), Constants::Hash160Size, matches.size(), 1, matches.size());
+    if (!count) {
+        return std::unexpected(count.error());
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < *count; ++i) {
+        const uint8_t* hash = pubKeyHashes.data() + i * Constants::Hash160Size;
+        if (MatchesP2WPKH(ranges.p2wpkh, hash) || MatchesP2PKH(ranges.p2pkh, hash)) {
+            matches[found++] = i;
+        }
+    }
+    return found;
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// SSE2 character-class test shared by the Base58 and Bech32 character scans in
+// external/bitcoin-core. Compiled wherever the baseline x86-64 ISA is available.
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+namespace BitcoinKeyUtils::detail::ascii {
+
+// Lanes of v whose byte lies in [lo, hi], as 0xff bytes.
+inline __m128i InRange(__m128i v, char lo, char hi) {
+    const __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(hi - lo)), offset);
+}
+
+}
+
+#endif
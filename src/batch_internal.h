@@ -0,0 +1,39 @@
+#pragma once
+
+#include "bitcoin_key_utils.h"
+#include "bech32.h"
+
+#include <cstdio>
+#include <span>
+#include <string>
+
+// Helpers shared by the serial batch API and the parallel executor.
+namespace BitcoinKeyUtils::detail {
+
+// Encoded length of every WIF key; for each network's version byte the payload value always spans
+// the same number of digits.
+inline constexpr size_t UncompressedWIFLength = 51;
+inline constexpr size_t CompressedWIFLength = 52;
+
+// Bech32 encoder for a segwit v0 HRP ("bc" or "tb" in either case), or the reason it was rejected.
+std::expected<const bech32::Encoder*, Error> SegwitV0Encoder(std::string_view hrp);
+
+// Validate the flat buffers of a batch call and return the record count.
+std::expected<size_t, Error> CheckBatchSizes(size_t inputSize, size_t recordSize, size_t outSize, size_t outStride, size_t statusSize);
+
+// Zero a buffer that held key material. Unlike std::fill, the stores are kept even when the buffer
+// is never read again.
+void Wipe(void* data, size_t size) noexcept;
+
+// Wipes a stack buffer of key material on every return path.
+struct WipeOnExit {
+    std::span<uint8_t> bytes;
+    ~WipeOnExit() { Wipe(bytes.data(), bytes.size()); }
+};
+
+// Finish a file written at tmpPath and close it. If written, flush and sync it and rename it over
+// path, so readers that have path mapped keep the old contents instead of faulting on a truncated
+// file; otherwise, or if any step fails, remove it. Return false with errno set on failure.
+bool CommitFile(std::FILE* file, bool written, const std::string& tmpPath, const std::string& path);
+
+}
@@ -1,4 +1,12 @@
 #include "bitcoin_key_utils.h"
+#include "batch_internal.h"
+#include "metrics.h"
+#include "secp256k1.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <stdexcept>
 #include "base58.h"
@@ -7,46 +15,339 @@
 #include "crypto/ripemd160.h"
 #include "util/strencodings.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
 namespace BitcoinKeyUtils {
 
-std::expected<std::string, Error> EncodeWIF(const std::vector<uint8_t>& privateKey,bool compressed) {
-    if (privateKey.size() != Constants::PrivateKeySize) {
-        return std::unexpected(Error{ErrorCode::InvalidPrivateKeySize, "Invalid private key size for WIF encoding: " + std::to_string(privateKey.size()) +", expected: " + std::to_string(Constants::PrivateKeySize)});
+namespace {
+
+std::expected<std::string, Error> NormalizeSegwitHRP(std::string_view hrp) {
+    if (hrp.empty() || hrp.length() > 83) {
+        return std::unexpected(Error{ErrorCode::InvalidHRP, "Invalid HRP for Bech32 encoding: empty or too long"});
+    }
+
+    // Reject mixed-case input (decoder MUST reject mixed-case per BIP-173)
+    bool hasLower = std::any_of(hrp.begin(), hrp.end(), [](unsigned char c){ return std::islower(c); });
+    bool hasUpper = std::any_of(hrp.begin(), hrp.end(), [](unsigned char c){ return std::isupper(c); });
+    if (hasLower && hasUpper) {
+        return std::unexpected(Error{ErrorCode::InvalidHRP, "Mixed-case HRP not allowed"});
+    }
+
+    // Normalize to lowercase for encoding (encoders MUST output lowercase)
+    std::string hrp_lc;
+    hrp_lc.reserve(hrp.size());
+    for (unsigned char c : hrp) {
+        if (c < 33 || c > 126) { // printable US-ASCII only
+            return std::unexpected(Error{ErrorCode::InvalidHRP, "HRP contains non-printable ASCII"});
+        }
+        hrp_lc.push_back(static_cast<char>(std::tolower(c)));
+    }
+
+    // If this function is specifically for Segwit v0 addresses, enforce network HRP:
+    if (!(hrp_lc == "bc" || hrp_lc == "tb")) {
+        return std::unexpected(Error{ErrorCode::InvalidHRP, "Segwit v0 HRP must be 'bc' or 'tb'"});
+    }
+
+    return hrp_lc;
+}
+
+// Bech32 encoder for a segwit v0 HRP, or nullptr. The encoders for "bc" and "tb" are built once;
+// these are the only HRPs NormalizeSegwitHRP accepts, so they are matched here without allocating.
+const bech32::Encoder* FindSegwitV0Encoder(std::string_view hrp) {
+    static const bech32::Encoder mainnet{bech32::Encoding::BECH32, "bc"};
+    static const bech32::Encoder testnet{bech32::Encoding::BECH32, "tb"};
+    if (hrp == "bc" || hrp == "BC") return &mainnet;
+    if (hrp == "tb" || hrp == "TB") return &testnet;
+    return nullptr;
+}
+
+}
+
+namespace detail {
+
+std::expected<const bech32::Encoder*, Error> SegwitV0Encoder(std::string_view hrp) {
+    if (const bech32::Encoder* encoder = FindSegwitV0Encoder(hrp)) return encoder;
+
+    auto hrp_lc = NormalizeSegwitHRP(hrp);
+    if (!hrp_lc) {
+        return std::unexpected(hrp_lc.error());
     }
+    return FindSegwitV0Encoder(*hrp_lc);
+}
 
-    std::vector<uint8_t> data;
-    data.push_back(Constants::MainNet);
-    data.insert(data.end(), privateKey.begin(), privateKey.end());
-    if (compressed) {
-        data.push_back(Constants::CompressMagic);
+std::expected<size_t, Error> CheckBatchSizes(size_t inputSize, size_t recordSize, size_t outSize, size_t outStride, size_t statusSize) {
+    if (inputSize % recordSize != 0) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch input size " + std::to_string(inputSize) + " is not a multiple of record size " + std::to_string(recordSize)});
+    }
+    const size_t count = inputSize / recordSize;
+    if (outSize < count * outStride) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch output too small: " + std::to_string(outSize) + ", expected at least: " + std::to_string(count * outStride)});
+    }
+    if (statusSize < count) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch status array too small: " + std::to_string(statusSize) + ", expected at least: " + std::to_string(count)});
     }
+    return count;
+}
+
+void Wipe(void* data, size_t size) noexcept {
+    if (size == 0) return;
+    std::memset(data, 0, size);
+#if defined(__GNUC__) || defined(__clang__)
+    __asm__ __volatile__("" : : "r"(data) : "memory");
+#else
+    volatile uint8_t* bytes = static_cast<volatile uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) bytes[i] = 0;
+#endif
+}
 
-    std::string wifString = EncodeBase58Check(data);
-    if (wifString.empty()) {
-        return std::unexpected(Error{ErrorCode::Base58CheckEncodingFailed, "Base58Check encoding fail !"});
+bool CommitFile(std::FILE* file, bool written, const std::string& tmpPath, const std::string& path) {
+    bool ok = written && std::fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = std::fclose(file) == 0 && ok;
+#if !defined(__unix__) && !defined(__APPLE__)
+    // Elsewhere rename does not replace an existing file.
+    if (ok) std::remove(path.c_str());
+#endif
+    ok = ok && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        const int error = errno;
+        std::remove(tmpPath.c_str());
+        errno = error;
     }
+    return ok;
+}
+
+}
 
-    return wifString;
+namespace {
+
+// Records processed per inner step of the batch loops; a multiple of the widest SHA-256 kernel.
+constexpr size_t BatchTile = 64;
+
+// Base58Check-encode a tile of equal-length payloads into NUL-padded output slots.
+// All checksums of the tile come from one multi-lane SHA256DMulti call.
+size_t EncodeBase58CheckTile(const uint8_t* payloads, size_t len, size_t count, char* out, size_t stride, BatchStatus* status) {
+    unsigned char checksums[BatchTile * CSHA256::OUTPUT_SIZE];
+    SHA256DMulti(checksums, payloads, len, count);
+    detail::metrics::AddBytesHashed(len * count);
+
+    unsigned char record[MAX_BASE58_BUFFER_INPUT];
+    size_t encoded = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::copy_n(payloads + i * len, len, record);
+        std::copy_n(checksums + i * CSHA256::OUTPUT_SIZE, 4, record + len);
+        std::span<char> slot(out + i * stride, stride);
+        const size_t written = EncodeBase58(Span{record, len + 4}, slot);
+        std::fill(slot.begin() + written, slot.end(), '\0');
+        if (written != 0) {
+            status[i] = {true};
+            ++encoded;
+        } else {
+            status[i] = {false, ErrorCode::Base58CheckEncodingFailed};
+        }
+    }
+    detail::Wipe(record, sizeof(record));
+    return encoded;
+}
+
+enum class AddressForm { Base58, Bech32 };
+
+// Recognize the encoding of an address and run the checks that need no decoding: length and alphabet.
+// Bech32 addresses are recognized by the encoder's HRP and separator, in either case.
+std::expected<AddressForm, ErrorCode> ClassifyAddress(std::string_view address, const bech32::Encoder& encoder) {
+    const std::string_view hrp = encoder.Hrp();
+    if (detail::HasSegwitPrefix(address, hrp)) {
+        if (address.size() > bech32::CharLimit::BECH32) {
+            return std::unexpected(ErrorCode::InvalidAddressLength);
+        }
+        const std::string_view data = address.substr(hrp.size() + 1);
+        if (bech32::FindInvalidCharacter(data) != data.size()) {
+            return std::unexpected(ErrorCode::InvalidAddressCharacter);
+        }
+        return AddressForm::Bech32;
+    }
+    if (address.empty() || address.size() > Constants::P2PKHStride) {
+        return std::unexpected(ErrorCode::InvalidAddressLength);
+    }
+    if (FindInvalidBase58Character(address) != address.size()) {
+        return std::unexpected(ErrorCode::InvalidAddressCharacter);
+    }
+    return AddressForm::Base58;
+}
+
+std::expected<DecodedAddress, ErrorCode> DecodeP2WPKHAddress(std::string_view address, const bech32::Encoder& encoder) {
+    uint8_t version;
+    std::array<uint8_t, bech32::MAX_WITNESS_PROGRAM_SIZE> program;
+    const size_t size = encoder.DecodeWitnessProgram(address, version, Span{program});
+    if (size == 0) {
+        return std::unexpected(ErrorCode::Bech32DecodingFailed);
+    }
+    if (version != Constants::WitnessVersion0 || size != Constants::Hash160Size) {
+        return std::unexpected(ErrorCode::InvalidWitnessProgram);
+    }
+    DecodedAddress result{AddressType::P2WPKH};
+    std::copy_n(program.begin(), Constants::Hash160Size, result.hash.begin());
+    return result;
+}
+
+std::expected<DecodedAddress, ErrorCode> DecodeAddressWith(std::string_view address, const bech32::Encoder& encoder) {
+    auto form = ClassifyAddress(address, encoder);
+    if (!form) {
+        return std::unexpected(form.error());
+    }
+    if (*form == AddressForm::Bech32) {
+        return DecodeP2WPKHAddress(address, encoder);
+    }
+
+    std::array<uint8_t, Constants::Hash160Size + 1> payload;
+    if (!DecodeBase58Check(address, Span{payload})) {
+        return std::unexpected(ErrorCode::Base58CheckDecodingFailed);
+    }
+    detail::metrics::AddBytesHashed(payload.size());
+    if (payload[0] != Constants::P2PKHPrefix) {
+        return std::unexpected(ErrorCode::InvalidNetworkPrefix);
+    }
+    DecodedAddress result{AddressType::P2PKH};
+    std::copy_n(payload.begin() + 1, Constants::Hash160Size, result.hash.begin());
+    return result;
+}
+
+// Single-key derivation and Hash160, shared by the allocating and NoAlloc functions, which each count
+// their own call.
+std::expected<PublicKey, ErrorCode> DerivePublicKeyWith(const uint8_t* privateKey, bool compressed) {
+    PublicKey pubKey;
+    bool valid = false;
+    detail::secp256k1::DerivePublicKeys(privateKey, 1, compressed, pubKey.bytes.data(), &valid);
+    if (!valid) {
+        return std::unexpected(ErrorCode::InvalidPrivateKey);
+    }
+    pubKey.length = compressed ? Constants::CompressedPubKeySize : Constants::UncompressedPubKeySize;
+    return pubKey;
+}
+
+Hash160Digest HashNonEmpty(std::span<const uint8_t> data) {
+    unsigned char sha256_result[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data.data(), data.size()).Finalize(sha256_result);
+    detail::metrics::AddBytesHashed(data.size());
+    Hash160Digest hash;
+    CRIPEMD160().Write(sha256_result, CSHA256::OUTPUT_SIZE).Finalize(hash.data());
+    return hash;
+}
+
+struct HashBackendNames {
+    std::string sha256;
+    std::string ripemd160;
+};
+
+// SHA256AutoDetect and RIPEMD160AutoDetect rewrite global function pointers, so they run exactly
+// once, under the function-local static's initialization guard.
+const HashBackendNames& SelectHashBackends() {
+    static const HashBackendNames names{SHA256AutoDetect(), RIPEMD160AutoDetect()};
+    return names;
+}
+
+// Select the backends when the library is loaded. Until then the portable transforms are used,
+// so calls from other static initializers are still correct, only slower.
+[[maybe_unused]] const HashBackendNames& g_hashBackends = SelectHashBackends();
+
+}
+
+std::string_view SHA256Backend() {
+    return SelectHashBackends().sha256;
+}
+
+std::string_view RIPEMD160Backend() {
+    return SelectHashBackends().ripemd160;
+}
+
+std::string_view ErrorMessage(ErrorCode code) {
+    switch (code) {
+    case ErrorCode::InvalidPrivateKeySize: return "Invalid private key size";
+    case ErrorCode::Base58CheckEncodingFailed: return "Base58Check encoding failed";
+    case ErrorCode::Base58CheckDecodingFailed: return "Base58Check decoding failed";
+    case ErrorCode::EmptyData: return "Cannot hash empty data";
+    case ErrorCode::Hash160SizeMismatch: return "Hash160 result size mismatch";
+    case ErrorCode::InvalidPubKeyHashSize: return "Invalid pubKeyHash size";
+    case ErrorCode::InvalidHRP: return "Invalid HRP";
+    case ErrorCode::Bech32BitConversionFailed: return "Failed to convert bits for Bech32 encoding";
+    case ErrorCode::Bech32EncodingFailed: return "Bech32 encoding failed";
+    case ErrorCode::InvalidWIFLength: return "Invalid WIF length";
+    case ErrorCode::InvalidCompressionFlag: return "Invalid compression flag";
+    case ErrorCode::InvalidNetworkPrefix: return "Invalid network prefix";
+    case ErrorCode::InvalidPubKeySize: return "Invalid public key size";
+    case ErrorCode::InvalidPubKeyPrefix: return "Invalid SEC1 public key prefix";
+    case ErrorCode::BatchSizeMismatch: return "Batch buffer sizes do not agree";
+    case ErrorCode::InvalidAddressLength: return "Invalid address length";
+    case ErrorCode::InvalidAddressCharacter: return "Address contains a character outside its alphabet";
+    case ErrorCode::Bech32DecodingFailed: return "Bech32 decoding failed";
+    case ErrorCode::InvalidWitnessProgram: return "Witness version or program size is not P2WPKH";
+    case ErrorCode::InvalidPrivateKey: return "Private key is zero or not below the secp256k1 group order";
+    case ErrorCode::InvalidAddressPrefix: return "No P2PKH or P2WPKH address starts with this prefix";
+    case ErrorCode::WatchListIOFailed: return "Watch list index file could not be read or written";
+    case ErrorCode::InvalidWatchListFormat: return "File is not a valid watch list index";
+    case ErrorCode::SecureMemoryUnavailable: return "Locked memory for key slots could not be mapped";
+    case ErrorCode::KeyArenaExhausted: return "No free run of key slots of the requested length";
+    case ErrorCode::InvalidHexLength: return "Hex string or buffer has the wrong length";
+    case ErrorCode::InvalidHexCharacter: return "Hex string contains a character that is not a hex digit";
+    case ErrorCode::RecordFileIOFailed: return "Record file could not be read or written";
+    case ErrorCode::InvalidRecordFileFormat: return "File is not a valid record file";
+    case ErrorCode::RecordFileChecksumMismatch: return "Record file block does not match its checksum";
+    }
+    return "Unknown error";
+}
+
+std::expected<std::string, Error> EncodeWIF(const std::vector<uint8_t>& privateKey,bool compressed) {
+    auto metered = detail::metrics::Scope(Metrics::Function::EncodeWIF);
+    if (privateKey.size() != Constants::PrivateKeySize) {
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidPrivateKeySize, "Invalid private key size for WIF encoding: " + std::to_string(privateKey.size()) +", expected: " + std::to_string(Constants::PrivateKeySize)}));
+    }
+
+    auto wif = Policy::EncodeWIF<Policy::Mainnet>(std::span<const uint8_t, Constants::PrivateKeySize>(privateKey.data(), Constants::PrivateKeySize), compressed);
+    if (!wif) {
+        return metered.Return(std::unexpected(Error{ErrorCode::Base58CheckEncodingFailed, "Base58Check encoding fail !"}));
+    }
+
+    return metered.Return(wif->str());
 }
 
 std::expected<std::pair<std::vector<uint8_t>, bool>, Error> DecodeWIF(const std::string& wifString) {
-    std::vector<uint8_t> decoded;
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeWIF);
     constexpr int max_ret_len = Constants::PrivateKeySize + 5;
-
-    if (!DecodeBase58Check(wifString.c_str(), decoded, max_ret_len)) {
-        return std::unexpected(Error{ErrorCode::Base58CheckDecodingFailed, "Base58Check decoding failed"});
+    std::array<uint8_t, max_ret_len> buffer;
+    detail::WipeOnExit wipeBuffer{buffer};
+    std::span<const uint8_t> decoded;
+
+    // Well-formed WIF strings are 51 (uncompressed) or 52 (compressed) characters and decode at a
+    // fixed length on the stack. Anything else takes the generic decoder so errors are reported alike.
+    if (wifString.size() == detail::UncompressedWIFLength && DecodeBase58Check(wifString, Span{buffer.data(), Constants::PrivateKeySize + 1})) {
+        decoded = std::span{buffer}.first(Constants::PrivateKeySize + 1);
+    } else if (wifString.size() == detail::CompressedWIFLength && DecodeBase58Check(wifString, Span{buffer.data(), Constants::PrivateKeySize + 2})) {
+        decoded = std::span{buffer}.first(Constants::PrivateKeySize + 2);
+    } else {
+        std::vector<uint8_t> generic;
+        if (!DecodeBase58Check(wifString.c_str(), generic, max_ret_len)) {
+            return metered.Return(std::unexpected(Error{ErrorCode::Base58CheckDecodingFailed, "Base58Check decoding failed"}));
+        }
+        std::copy(generic.begin(), generic.end(), buffer.begin());
+        decoded = std::span{buffer}.first(generic.size());
+        detail::Wipe(generic.data(), generic.size());
     }
+    detail::metrics::AddBytesHashed(decoded.size());
 
     if (decoded.size() < Constants::PrivateKeySize + 1) {
-        return std::unexpected(Error{ErrorCode::InvalidWIFLength, 
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidWIFLength, 
             "Invalid WIF decoded length: " + std::to_string(decoded.size()) + 
-            ", expected at least: " + std::to_string(Constants::PrivateKeySize + 1)});
+            ", expected at least: " + std::to_string(Constants::PrivateKeySize + 1)}));
     }
 
     if (decoded[0] != Constants::MainNet) {
-        return std::unexpected(Error{ErrorCode::InvalidNetworkPrefix, 
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidNetworkPrefix, 
             "Invalid network prefix: " + std::to_string(decoded[0]) + 
-            ", expected: " + std::to_string(Constants::MainNet)});
+            ", expected: " + std::to_string(Constants::MainNet)}));
     }
 
     bool compressed = false;
@@ -55,111 +356,421 @@ std::expected<std::pair<std::vector<uint8_t>, bool>, Error> DecodeWIF(const std:
         if (decoded.back() == Constants::CompressMagic) {
             compressed = true;
         } else {
-            return std::unexpected(Error{ErrorCode::InvalidCompressionFlag, 
-                "Invalid compression flag: " + std::to_string(decoded.back())});
+            return metered.Return(std::unexpected(Error{ErrorCode::InvalidCompressionFlag, 
+                "Invalid compression flag: " + std::to_string(decoded.back())}));
         }
     } else if (decoded.size() != expectedSize) {
-        return std::unexpected(Error{ErrorCode::InvalidWIFLength,"Invalid WIF decoded length: " + std::to_string(decoded.size()) + 
-            ", expected: " + std::to_string(expectedSize) + " or " + std::to_string(expectedSize + 1)});
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidWIFLength,"Invalid WIF decoded length: " + std::to_string(decoded.size()) + 
+            ", expected: " + std::to_string(expectedSize) + " or " + std::to_string(expectedSize + 1)}));
     }
 
     std::vector<uint8_t> privateKey(decoded.begin() + 1, decoded.begin() + 1 + Constants::PrivateKeySize);
-    
-    return std::make_pair(privateKey, compressed);
+
+    return metered.Return(std::make_pair(privateKey, compressed));
 }
 
+std::expected<std::vector<uint8_t>, Error> DerivePublicKey(const std::vector<uint8_t>& privateKey, bool compressed) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DerivePublicKey);
+    if (privateKey.size() != Constants::PrivateKeySize) {
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidPrivateKeySize, "Invalid private key size for public key derivation: " + std::to_string(privateKey.size()) + ", expected: " + std::to_string(Constants::PrivateKeySize)}));
+    }
 
-std::expected<std::vector<uint8_t>, Error> HashRIPEMD160SHA256(const std::vector<uint8_t>& data) {
+    auto pubKey = DerivePublicKeyWith(privateKey.data(), compressed);
+    if (!pubKey) {
+        return metered.Return(std::unexpected(Error{pubKey.error(), std::string(ErrorMessage(pubKey.error()))}));
+    }
+    return metered.Return(std::vector<uint8_t>(pubKey->span().begin(), pubKey->span().end()));
+}
 
+
+std::expected<std::vector<uint8_t>, Error> HashRIPEMD160SHA256(const std::vector<uint8_t>& data) {
+    auto metered = detail::metrics::Scope(Metrics::Function::HashRIPEMD160SHA256);
     if (data.empty()) {
-        return std::unexpected(Error{ErrorCode::EmptyData, "Cannot hash empty data"});
+        return metered.Return(std::unexpected(Error{ErrorCode::EmptyData, "Cannot hash empty data"}));
     }
 
-    CSHA256 sha256;
-    sha256.Write(data.data(), data.size());
-    std::vector<uint8_t> sha256_result(CSHA256::OUTPUT_SIZE);
-    sha256.Finalize(sha256_result.data());
+    const Hash160Digest hash = HashNonEmpty(data);
+    return metered.Return(std::vector<uint8_t>(hash.begin(), hash.end()));
+}
 
-    CRIPEMD160 ripemd160;
-    ripemd160.Write(sha256_result.data(), CSHA256::OUTPUT_SIZE);
-    std::vector<uint8_t> ripemd160_result(CRIPEMD160::OUTPUT_SIZE);
-    ripemd160.Finalize(ripemd160_result.data());
+std::expected<std::string, Error> GenerateP2PKHAddress(const std::vector<uint8_t>& pubKeyHash) {
+    auto metered = detail::metrics::Scope(Metrics::Function::GenerateP2PKHAddress);
+    if (pubKeyHash.size() != Constants::Hash160Size) {
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidPubKeyHashSize,"Invalid pubKeyHash size for P2PKH: " + std::to_string(pubKeyHash.size()) +", expected: " + std::to_string(Constants::Hash160Size)}));
+    }
 
-    if (ripemd160_result.size() != Constants::Hash160Size) {
-        return std::unexpected(Error{ErrorCode::Hash160SizeMismatch, "Hash160 result size mismatch: " + std::to_string(ripemd160_result.size()) +", expected: " + std::to_string(Constants::Hash160Size)});
+    auto address = Policy::EncodeAddress<Policy::Mainnet, Policy::P2PKH>(std::span<const uint8_t, Constants::Hash160Size>(pubKeyHash.data(), Constants::Hash160Size));
+    if (!address) {
+        return metered.Return(std::unexpected(Error{ErrorCode::Base58CheckEncodingFailed,"Base58Check encoding failed for P2PKH address"}));
     }
-    
-    return ripemd160_result;
+    return metered.Return(address->str());
 }
 
-std::expected<std::string, Error> GenerateP2PKHAddress(const std::vector<uint8_t>& pubKeyHash) {
+std::expected<std::string, Error> GenerateP2WPKHAddress(const std::vector<uint8_t>& pubKeyHash, std::string_view hrp) {
+    auto metered = detail::metrics::Scope(Metrics::Function::GenerateP2WPKHAddress);
     if (pubKeyHash.size() != Constants::Hash160Size) {
-        return std::unexpected(Error{ErrorCode::InvalidPubKeyHashSize,"Invalid pubKeyHash size for P2PKH: " + std::to_string(pubKeyHash.size()) +", expected: " + std::to_string(Constants::Hash160Size)});
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidPubKeyHashSize, "Invalid pubKeyHash size: " + std::to_string(pubKeyHash.size()) +", expected: " + std::to_string(Constants::Hash160Size)}));
     }
 
-    std::vector<uint8_t> data;
-    data.push_back(Constants::P2PKHPrefix);
-    data.insert(data.end(), pubKeyHash.begin(), pubKeyHash.end());
-    std::string address = EncodeBase58Check(data);
+    auto encoder = detail::SegwitV0Encoder(hrp);
+    if (!encoder) {
+        return metered.Return(std::unexpected(encoder.error()));
+    }
 
-    if (address.empty()) {
-        return std::unexpected(Error{ErrorCode::Base58CheckEncodingFailed,"Base58Check encoding failed for P2PKH address"});
+    std::array<char, Constants::P2WPKHStride> address;
+    const size_t written = (*encoder)->EncodeWitnessProgram(Constants::WitnessVersion0, Span{pubKeyHash.data(), pubKeyHash.size()}, Span{address});
+    if (written == 0) {
+        return metered.Return(std::unexpected(Error{ErrorCode::Bech32EncodingFailed, "Bech32 encoding failed"}));
     }
-    return address;
+
+    return metered.Return(std::string(address.data(), written));
 }
 
-std::expected<std::string, Error> GenerateP2WPKHAddress(const std::vector<uint8_t>& pubKeyHash, std::string_view hrp) {
-    if (pubKeyHash.size() != Constants::Hash160Size) {
-        return std::unexpected(Error{ErrorCode::InvalidPubKeyHashSize, "Invalid pubKeyHash size: " + std::to_string(pubKeyHash.size()) +", expected: " + std::to_string(Constants::Hash160Size)});
+std::expected<DecodedAddress, Error> DecodeAddress(std::string_view address, std::string_view hrp) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeAddress);
+    auto encoder = detail::SegwitV0Encoder(hrp);
+    if (!encoder) {
+        return metered.Return(std::unexpected(encoder.error()));
     }
 
-    if (hrp.empty() || hrp.length() > 83) {
-        return std::unexpected(Error{ErrorCode::InvalidHRP, "Invalid HRP for Bech32 encoding: empty or too long"});
+    auto decoded = DecodeAddressWith(address, **encoder);
+    if (!decoded) {
+        return metered.Return(std::unexpected(Error{decoded.error(), std::string(ErrorMessage(decoded.error()))}));
     }
+    return metered.Return(*decoded);
+}
 
-      // Reject mixed-case input (decoder MUST reject mixed-case per BIP-173)
-    bool hasLower = std::any_of(hrp.begin(), hrp.end(), [](unsigned char c){ return std::islower(c); });
-    bool hasUpper = std::any_of(hrp.begin(), hrp.end(), [](unsigned char c){ return std::isupper(c); });
-    if (hasLower && hasUpper) {
-        return std::unexpected(Error{ErrorCode::InvalidHRP, "Mixed-case HRP not allowed"});
+std::expected<size_t, Error> EncodeWIFBatch(std::span<const uint8_t> privateKeys, bool compressed, std::span<char> out, std::span<BatchStatus> status) {
+    auto metered = detail::metrics::Scope(Metrics::Function::EncodeWIFBatch, privateKeys.size() / Constants::PrivateKeySize, status);
+    auto count = detail::CheckBatchSizes(privateKeys.size(), Constants::PrivateKeySize, out.size(), Constants::WIFStride, status.size());
+    if (!count) {
+        return metered.Return(std::unexpected(count.error()));
     }
 
-    // Normalize to lowercase for encoding (encoders MUST output lowercase)
-    std::string hrp_lc;
-    hrp_lc.reserve(hrp.size());
-    for (unsigned char c : hrp) {
-        if (c < 33 || c > 126) { // printable US-ASCII only
-            return std::unexpected(Error{ErrorCode::InvalidHRP, "HRP contains non-printable ASCII"});
+    const size_t payloadSize = Constants::PrivateKeySize + (compressed ? 2 : 1);
+    uint8_t payloads[BatchTile * (Constants::PrivateKeySize + 2)];
+    size_t encoded = 0;
+    for (size_t first = 0; first < *count; first += BatchTile) {
+        const size_t n = std::min(BatchTile, *count - first);
+        for (size_t i = 0; i < n; ++i) {
+            uint8_t* payload = payloads + i * payloadSize;
+            payload[0] = Constants::MainNet;
+            std::copy_n(privateKeys.data() + (first + i) * Constants::PrivateKeySize, Constants::PrivateKeySize, payload + 1);
+            if (compressed) {
+                payload[Constants::PrivateKeySize + 1] = Constants::CompressMagic;
+            }
         }
-        hrp_lc.push_back(static_cast<char>(std::tolower(c)));
+        encoded += EncodeBase58CheckTile(payloads, payloadSize, n, out.data() + first * Constants::WIFStride, Constants::WIFStride, status.data() + first);
     }
+    detail::Wipe(payloads, sizeof(payloads));
+    return metered.Return(encoded);
+}
 
-        // If this function is specifically for Segwit v0 addresses, enforce network HRP:
-    if (!(hrp_lc == "bc" || hrp_lc == "tb")) {
-        return std::unexpected(Error{ErrorCode::InvalidHRP, "Segwit v0 HRP must be 'bc' or 'tb'"});
+std::expected<size_t, Error> DecodeWIFBatch(std::span<const std::string_view> wifs, std::span<uint8_t> privateKeys, std::span<uint64_t> compressed, std::span<BatchStatus> status) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeWIFBatch, wifs.size(), status);
+    auto count = detail::CheckBatchSizes(wifs.size(), 1, privateKeys.size(), Constants::PrivateKeySize, status.size());
+    if (!count) {
+        return metered.Return(std::unexpected(count.error()));
+    }
+    const size_t words = (*count + 63) / 64;
+    if (compressed.size() < words) {
+        return metered.Return(std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Compression bitmap too small: " + std::to_string(compressed.size()) + " words, expected at least: " + std::to_string(words)}));
+    }
+
+    // A tile is one bitmap word. Keys are Base58-decoded as they come, grouped by payload length
+    // (without and with the compression flag), and each group is checksummed with one SHA256DMulti call.
+    static_assert(BatchTile == 64);
+    constexpr size_t maxPayloadSize = Constants::PrivateKeySize + 2;
+    uint8_t payloads[2][BatchTile * maxPayloadSize];
+    uint8_t expected[2][BatchTile * 4];
+    size_t pending[2][BatchTile];
+    unsigned char checksums[BatchTile * CSHA256::OUTPUT_SIZE];
+    uint8_t data[maxPayloadSize + 4];
+    size_t decoded = 0;
+    for (size_t first = 0; first < *count; first += BatchTile) {
+        const size_t n = std::min(BatchTile, *count - first);
+        size_t m[2] = {0, 0};
+        for (size_t i = 0; i < n; ++i) {
+            const std::string_view wif = wifs[first + i];
+            std::fill_n(privateKeys.data() + (first + i) * Constants::PrivateKeySize, Constants::PrivateKeySize, 0);
+            const int group = wif.size() == detail::CompressedWIFLength;
+            if (!group && wif.size() != detail::UncompressedWIFLength) {
+                status[first + i] = {false, ErrorCode::InvalidWIFLength};
+                continue;
+            }
+            const size_t payloadSize = Constants::PrivateKeySize + 1 + group;
+            if (!DecodeBase58(wif, Span{data, payloadSize + 4})) {
+                status[first + i] = {false, ErrorCode::Base58CheckDecodingFailed};
+                continue;
+            }
+            std::copy_n(data, payloadSize, payloads[group] + m[group] * payloadSize);
+            std::copy_n(data + payloadSize, 4, expected[group] + m[group] * 4);
+            pending[group][m[group]++] = i;
+        }
+
+        uint64_t bits = 0;
+        for (int group = 0; group < 2; ++group) {
+            const size_t payloadSize = Constants::PrivateKeySize + 1 + group;
+            if (m[group] != 0) {
+                SHA256DMulti(checksums, payloads[group], payloadSize, m[group]);
+                detail::metrics::AddBytesHashed(payloadSize * m[group]);
+            }
+            for (size_t j = 0; j < m[group]; ++j) {
+                const uint8_t* payload = payloads[group] + j * payloadSize;
+                BatchStatus& result = status[first + pending[group][j]];
+                if (std::memcmp(checksums + j * CSHA256::OUTPUT_SIZE, expected[group] + j * 4, 4) != 0) {
+                    result = {false, ErrorCode::Base58CheckDecodingFailed};
+                } else if (payload[0] != Constants::MainNet) {
+                    result = {false, ErrorCode::InvalidNetworkPrefix};
+                } else if (group && payload[Constants::PrivateKeySize + 1] != Constants::CompressMagic) {
+                    result = {false, ErrorCode::InvalidCompressionFlag};
+                } else {
+                    std::copy_n(payload + 1, Constants::PrivateKeySize, privateKeys.data() + (first + pending[group][j]) * Constants::PrivateKeySize);
+                    bits |= static_cast<uint64_t>(group) << pending[group][j];
+                    result = {true};
+                    ++decoded;
+                }
+            }
+        }
+        compressed[first / 64] = bits;
+    }
+    detail::Wipe(payloads, sizeof(payloads));
+    detail::Wipe(checksums, sizeof(checksums));
+    detail::Wipe(data, sizeof(data));
+    return metered.Return(decoded);
+}
+
+std::expected<size_t, Error> DerivePublicKeyBatch(std::span<const uint8_t> privateKeys, bool compressed, std::span<uint8_t> out, std::span<BatchStatus> status) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DerivePublicKeyBatch, privateKeys.size() / Constants::PrivateKeySize, status);
+    const size_t pubKeySize = compressed ? Constants::CompressedPubKeySize : Constants::UncompressedPubKeySize;
+    auto count = detail::CheckBatchSizes(privateKeys.size(), Constants::PrivateKeySize, out.size(), pubKeySize, status.size());
+    if (!count) {
+        return metered.Return(std::unexpected(count.error()));
+    }
+
+    bool valid[detail::secp256k1::DeriveTile];
+    size_t derived = 0;
+    for (size_t first = 0; first < *count; first += detail::secp256k1::DeriveTile) {
+        const size_t n = std::min(detail::secp256k1::DeriveTile, *count - first);
+        detail::secp256k1::DerivePublicKeys(privateKeys.data() + first * Constants::PrivateKeySize, n, compressed, out.data() + first * pubKeySize, valid);
+        for (size_t i = 0; i < n; ++i) {
+            status[first + i] = valid[i] ? BatchStatus{true} : BatchStatus{false, ErrorCode::InvalidPrivateKey};
+            derived += valid[i];
+        }
+    }
+    return metered.Return(derived);
+}
+
+std::expected<size_t, Error> HashRIPEMD160SHA256Batch(std::span<const uint8_t> pubKeys, size_t pubKeySize, std::span<uint8_t> out, std::span<BatchStatus> status) {
+    auto metered = detail::metrics::Scope(Metrics::Function::HashRIPEMD160SHA256Batch, pubKeySize ? pubKeys.size() / pubKeySize : 0, status);
+    if (pubKeySize != Constants::CompressedPubKeySize && pubKeySize != Constants::UncompressedPubKeySize) {
+        return metered.Return(std::unexpected(Error{ErrorCode::InvalidPubKeySize, "Invalid public key size for batch Hash160: " + std::to_string(pubKeySize) + ", expected: 33 or 65"}));
+    }
+    auto count = detail::CheckBatchSizes(pubKeys.size(), pubKeySize, out.size(), Constants::Hash160Size, status.size());
+    if (!count) {
+        return metered.Return(std::unexpected(count.error()));
+    }
+
+    unsigned char sha256_results[BatchTile * CSHA256::OUTPUT_SIZE];
+    size_t hashed = 0;
+    for (size_t first = 0; first < *count; first += BatchTile) {
+        const size_t n = std::min(BatchTile, *count - first);
+        SHA256Multi(sha256_results, pubKeys.data() + first * pubKeySize, pubKeySize, n);
+        detail::metrics::AddBytesHashed(pubKeySize * n);
+        RIPEMD160D32(out.data() + first * Constants::Hash160Size, sha256_results, n);
+        for (size_t i = 0; i < n; ++i) {
+            const uint8_t prefix = pubKeys[(first + i) * pubKeySize];
+            const bool validPrefix = pubKeySize == Constants::CompressedPubKeySize ? (prefix == 0x02 || prefix == 0x03) : prefix == 0x04;
+            uint8_t* hash = out.data() + (first + i) * Constants::Hash160Size;
+            if (!validPrefix) {
+                std::fill_n(hash, Constants::Hash160Size, 0);
+                status[first + i] = {false, ErrorCode::InvalidPubKeyPrefix};
+                continue;
+            }
+            status[first + i] = {true};
+            ++hashed;
+        }
+    }
+    return metered.Return(hashed);
+}
+
+std::expected<size_t, Error> GenerateP2PKHAddressBatch(std::span<const uint8_t> pubKeyHashes, std::span<char> out, std::span<BatchStatus> status) {
+    auto metered = detail::metrics::Scope(Metrics::Function::GenerateP2PKHAddressBatch, pubKeyHashes.size() / Constants::Hash160Size, status);
+    auto count = detail::CheckBatchSizes(pubKeyHashes.size(), Constants::Hash160Size, out.size(), Constants::P2PKHStride, status.size());
+    if (!count) {
+        return metered.Return(std::unexpected(count.error()));
     }
 
-    std::vector<uint8_t> conv_data;
-    bool success = ConvertBits<8, 5, true>([&](int v) { conv_data.push_back(static_cast<uint8_t>(v)); }, pubKeyHash.begin(), pubKeyHash.end());
-    if (!success) {
-        return std::unexpected(Error{ErrorCode::Bech32BitConversionFailed,"Failed to convert bits for Bech32 encoding"});
+    constexpr size_t payloadSize = Constants::Hash160Size + 1;
+    uint8_t payloads[BatchTile * payloadSize];
+    size_t encoded = 0;
+    for (size_t first = 0; first < *count; first += BatchTile) {
+        const size_t n = std::min(BatchTile, *count - first);
+        for (size_t i = 0; i < n; ++i) {
+            payloads[i * payloadSize] = Constants::P2PKHPrefix;
+            std::copy_n(pubKeyHashes.data() + (first + i) * Constants::Hash160Size, Constants::Hash160Size, payloads + i * payloadSize + 1);
+        }
+        encoded += EncodeBase58CheckTile(payloads, payloadSize, n, out.data() + first * Constants::P2PKHStride, Constants::P2PKHStride, status.data() + first);
     }
+    return metered.Return(encoded);
+}
 
-    if (conv_data.size() != 32) { // 160 bits / 5 bits per value = 32 values
-        return std::unexpected(Error{ErrorCode::Bech32BitConversionFailed, "Invalid number of 5-bit values after conversion: " + std::to_string(conv_data.size()) + ", expected: 32"});
+std::expected<size_t, Error> GenerateP2WPKHAddressBatch(std::span<const uint8_t> pubKeyHashes, std::span<char> out, std::span<BatchStatus> status, std::string_view hrp) {
+    auto metered = detail::metrics::Scope(Metrics::Function::GenerateP2WPKHAddressBatch, pubKeyHashes.size() / Constants::Hash160Size, status);
+    auto count = detail::CheckBatchSizes(pubKeyHashes.size(), Constants::Hash160Size, out.size(), Constants::P2WPKHStride, status.size());
+    if (!count) {
+        return metered.Return(std::unexpected(count.error()));
+    }
+    auto encoder = detail::SegwitV0Encoder(hrp);
+    if (!encoder) {
+        return metered.Return(std::unexpected(encoder.error()));
     }
 
-    std::vector<uint8_t> data;
-    data.push_back(Constants::WitnessVersion0); // must be integer 0, not '0'
-    data.insert(data.end(), conv_data.begin(), conv_data.end());
+    size_t encoded = 0;
+    for (size_t i = 0; i < *count; ++i) {
+        const uint8_t* hash = pubKeyHashes.data() + i * Constants::Hash160Size;
+        std::span<char> slot = out.subspan(i * Constants::P2WPKHStride, Constants::P2WPKHStride);
+        const size_t len = (*encoder)->EncodeWitnessProgram(Constants::WitnessVersion0, Span{hash, Constants::Hash160Size}, slot);
+        std::fill(slot.begin() + len, slot.end(), '\0');
+        if (len != 0) {
+            status[i] = {true};
+            ++encoded;
+        } else {
+            status[i] = {false, ErrorCode::Bech32EncodingFailed};
+        }
+    }
+    return metered.Return(encoded);
+}
 
-    std::string address = bech32::Encode(bech32::Encoding::BECH32, hrp_lc, data);
-    if (address.empty()) {
-        return std::unexpected(Error{ErrorCode::Bech32EncodingFailed, "Bech32 encoding failed"});
+std::expected<size_t, Error> ValidateAddresses(std::span<const std::string_view> addresses, std::span<uint64_t> valid, std::span<DecodedAddress> decoded, std::string_view hrp) {
+    auto metered = detail::metrics::Scope(Metrics::Function::ValidateAddresses, addresses.size(), {});
+    const size_t count = addresses.size();
+    const size_t words = (count + 63) / 64;
+    if (valid.size() < words) {
+        return metered.Return(std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Validity bitmap too small: " + std::to_string(valid.size()) + " words, expected at least: " + std::to_string(words)}));
+    }
+    if (!decoded.empty() && decoded.size() < count) {
+        return metered.Return(std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Decoded address array too small: " + std::to_string(decoded.size()) + ", expected at least: " + std::to_string(count)}));
     }
+    auto encoder = detail::SegwitV0Encoder(hrp);
+    if (!encoder) {
+        return metered.Return(std::unexpected(encoder.error()));
+    }
+
+    // A tile is one bitmap word. P2PKH addresses are Base58-decoded as they come; their payloads
+    // are then checksummed together with one multi-lane SHA256DMulti call.
+    static_assert(BatchTile == 64);
+    constexpr size_t payloadSize = Constants::Hash160Size + 1;
+    uint8_t payloads[BatchTile * payloadSize];
+    uint8_t expected[BatchTile * 4];
+    size_t pending[BatchTile];
+    unsigned char checksums[BatchTile * CSHA256::OUTPUT_SIZE];
+    size_t validCount = 0;
+    for (size_t first = 0; first < count; first += BatchTile) {
+        const size_t n = std::min(BatchTile, count - first);
+        uint64_t bits = 0;
+        size_t m = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const std::string_view address = addresses[first + i];
+            DecodedAddress result{};
+            auto form = ClassifyAddress(address, **encoder);
+            if (form && *form == AddressForm::Bech32) {
+                if (auto p2wpkh = DecodeP2WPKHAddress(address, **encoder)) {
+                    bits |= uint64_t{1} << i;
+                    result = *p2wpkh;
+                }
+            } else if (form) {
+                uint8_t data[payloadSize + 4];
+                if (DecodeBase58(address, Span{data})) {
+                    std::copy_n(data, payloadSize, payloads + m * payloadSize);
+                    std::copy_n(data + payloadSize, 4, expected + m * 4);
+                    pending[m++] = i;
+                }
+            }
+            if (!decoded.empty()) {
+                decoded[first + i] = result;
+            }
+        }
 
-    return address;
+        if (m != 0) {
+            SHA256DMulti(checksums, payloads, payloadSize, m);
+            detail::metrics::AddBytesHashed(payloadSize * m);
+        }
+        for (size_t j = 0; j < m; ++j) {
+            const uint8_t* payload = payloads + j * payloadSize;
+            if (std::memcmp(checksums + j * CSHA256::OUTPUT_SIZE, expected + j * 4, 4) != 0 || payload[0] != Constants::P2PKHPrefix) {
+                continue;
+            }
+            bits |= uint64_t{1} << pending[j];
+            if (!decoded.empty()) {
+                DecodedAddress& result = decoded[first + pending[j]];
+                result.type = AddressType::P2PKH;
+                std::copy_n(payload + 1, Constants::Hash160Size, result.hash.begin());
+            }
+        }
+        valid[first / 64] = bits;
+        validCount += std::popcount(bits);
+    }
+    return metered.Return(validCount);
 }
 
-} 
+namespace NoAlloc {
 
+std::expected<WIFString, ErrorCode> EncodeWIF(std::span<const uint8_t, Constants::PrivateKeySize> privateKey, bool compressed) {
+    auto metered = detail::metrics::Scope(Metrics::Function::EncodeWIF);
+    return metered.Return(Policy::EncodeWIF<Policy::Mainnet>(privateKey, compressed));
+}
+
+std::expected<bool, ErrorCode> DecodeWIF(std::string_view wifString, std::span<uint8_t, Constants::PrivateKeySize> privateKey) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeWIF);
+    return metered.Return(Policy::DecodeWIF<Policy::Mainnet>(wifString, privateKey));
+}
+
+std::expected<std::pair<PrivateKey, bool>, ErrorCode> DecodeWIF(std::string_view wifString) {
+    std::pair<PrivateKey, bool> result;
+    auto compressed = DecodeWIF(wifString, result.first);
+    if (!compressed) {
+        return std::unexpected(compressed.error());
+    }
+    result.second = *compressed;
+    return result;
+}
+
+std::expected<PublicKey, ErrorCode> DerivePublicKey(std::span<const uint8_t, Constants::PrivateKeySize> privateKey, bool compressed) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DerivePublicKey);
+    return metered.Return(DerivePublicKeyWith(privateKey.data(), compressed));
+}
+
+std::expected<Hash160Digest, ErrorCode> HashRIPEMD160SHA256(std::span<const uint8_t> data) {
+    auto metered = detail::metrics::Scope(Metrics::Function::HashRIPEMD160SHA256);
+    if (data.empty()) {
+        return metered.Return(std::unexpected(ErrorCode::EmptyData));
+    }
+    return metered.Return(HashNonEmpty(data));
+}
+
+std::expected<P2PKHString, ErrorCode> GenerateP2PKHAddress(std::span<const uint8_t, Constants::Hash160Size> pubKeyHash) {
+    auto metered = detail::metrics::Scope(Metrics::Function::GenerateP2PKHAddress);
+    return metered.Return(Policy::EncodeAddress<Policy::Mainnet, Policy::P2PKH>(pubKeyHash));
+}
+
+std::expected<P2WPKHString, ErrorCode> GenerateP2WPKHAddress(std::span<const uint8_t, Constants::Hash160Size> pubKeyHash, std::string_view hrp) {
+    auto metered = detail::metrics::Scope(Metrics::Function::GenerateP2WPKHAddress);
+    // The two segwit v0 networks' HRPs, in either case; both fit the mainnet stride.
+    if (hrp == "bc" || hrp == "BC") return metered.Return(Policy::EncodeAddress<Policy::Mainnet, Policy::P2WPKH>(pubKeyHash));
+    if (hrp == "tb" || hrp == "TB") return metered.Return(Policy::EncodeAddress<Policy::Testnet, Policy::P2WPKH>(pubKeyHash));
+    return metered.Return(std::unexpected(ErrorCode::InvalidHRP));
+}
+
+std::expected<DecodedAddress, ErrorCode> DecodeAddress(std::string_view address, std::string_view hrp) {
+    auto metered = detail::metrics::Scope(Metrics::Function::DecodeAddress);
+    const bech32::Encoder* encoder = FindSegwitV0Encoder(hrp);
+    if (!encoder) {
+        return metered.Return(std::unexpected(ErrorCode::InvalidHRP));
+    }
+    return metered.Return(DecodeAddressWith(address, *encoder));
+}
+
+}
+
+}
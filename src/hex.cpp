@@ -0,0 +1,157 @@
+#include "bitcoin_key_utils.h"
+
+#include "batch_internal.h"
+#include "hex.h"
+
+#include "crypto/hex_base.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace BitcoinKeyUtils {
+
+namespace {
+
+constexpr char HexDigits[] = "0123456789abcdef";
+
+struct HexKernels {
+    // Block kernels of hex.h, or null where the CPU lacks them. When both are set, the SSE4.1 one
+    // takes the 16-digit block the AVX2 one leaves over.
+    size_t (*decodeWide)(const char*, size_t, uint8_t*) = nullptr;
+    size_t (*encodeWide)(const uint8_t*, size_t, char*) = nullptr;
+    size_t (*decodeNarrow)(const char*, size_t, uint8_t*) = nullptr;
+    size_t (*encodeNarrow)(const uint8_t*, size_t, char*) = nullptr;
+    std::string_view name = "standard";
+};
+
+HexKernels DetectHexKernels() {
+    HexKernels kernels;
+#if defined(ENABLE_SSE41) || defined(ENABLE_AVX2)
+    __builtin_cpu_init();
+#endif
+#ifdef ENABLE_SSE41
+    if (__builtin_cpu_supports("sse4.1")) {
+        kernels.decodeNarrow = detail::hex::DecodeSSE41;
+        kernels.encodeNarrow = detail::hex::EncodeSSE41;
+        kernels.name = "sse41";
+    }
+#endif
+#ifdef ENABLE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.decodeWide = detail::hex::DecodeAVX2;
+        kernels.encodeWide = detail::hex::EncodeAVX2;
+        kernels.name = "avx2";
+    }
+#endif
+    return kernels;
+}
+
+const HexKernels& SelectHexKernels() {
+    static const HexKernels kernels = DetectHexKernels();
+    return kernels;
+}
+
+// Select the kernels when the library is loaded, as with the hash backends.
+[[maybe_unused]] const HexKernels& g_hexKernels = SelectHexKernels();
+
+// Decode 2 * out.size() digits; the length has been checked. Return the index of the first
+// character that is not a hex digit, or hex.size().
+size_t DecodeDigits(std::string_view hex, std::span<uint8_t> out) {
+    const HexKernels& kernels = SelectHexKernels();
+    const char* chars = hex.data();
+    size_t i = 0;
+    if (kernels.decodeWide) i += kernels.decodeWide(chars, hex.size(), out.data());
+    if (kernels.decodeNarrow) i += kernels.decodeNarrow(chars + i, hex.size() - i, out.data() + i / 2);
+    for (; i < hex.size(); i += 2) {
+        const signed char high = HexDigit(chars[i]);
+        if (high < 0) return i;
+        const signed char low = HexDigit(chars[i + 1]);
+        if (low < 0) return i + 1;
+        out[i / 2] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return hex.size();
+}
+
+void EncodeDigits(std::span<const uint8_t> bytes, char* out) {
+    const HexKernels& kernels = SelectHexKernels();
+    size_t i = 0;
+    if (kernels.encodeWide) i += kernels.encodeWide(bytes.data(), bytes.size(), out);
+    if (kernels.encodeNarrow) i += kernels.encodeNarrow(bytes.data() + i, bytes.size() - i, out + 2 * i);
+    for (; i < bytes.size(); ++i) {
+        out[2 * i] = HexDigits[bytes[i] >> 4];
+        out[2 * i + 1] = HexDigits[bytes[i] & 0x0f];
+    }
+}
+
+}
+
+namespace Hex {
+
+std::string_view Backend() {
+    return SelectHexKernels().name;
+}
+
+std::expected<void, DecodeError> Decode(std::string_view hex, std::span<uint8_t> out) {
+    if (hex.size() != 2 * out.size()) {
+        return std::unexpected(DecodeError{ErrorCode::InvalidHexLength, std::min(hex.size(), 2 * out.size())});
+    }
+    const size_t invalid = DecodeDigits(hex, out);
+    if (invalid != hex.size()) {
+        return std::unexpected(DecodeError{ErrorCode::InvalidHexCharacter, invalid});
+    }
+    return {};
+}
+
+std::expected<size_t, ErrorCode> Encode(std::span<const uint8_t> bytes, std::span<char> out) {
+    if (out.size() < 2 * bytes.size()) {
+        return std::unexpected(ErrorCode::InvalidHexLength);
+    }
+    EncodeDigits(bytes, out.data());
+    return 2 * bytes.size();
+}
+
+std::expected<size_t, Error> DecodeBatch(std::span<const std::string_view> records, size_t recordSize, std::span<uint8_t> out, std::span<BatchStatus> status) {
+    if (recordSize == 0) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch record size must not be 0"});
+    }
+    auto count = detail::CheckBatchSizes(records.size() * recordSize, recordSize, out.size(), recordSize, status.size());
+    if (!count) {
+        return std::unexpected(count.error());
+    }
+
+    size_t decoded = 0;
+    for (size_t i = 0; i < *count; ++i) {
+        const std::span<uint8_t> record = out.subspan(i * recordSize, recordSize);
+        auto result = Decode(records[i], record);
+        if (result) {
+            status[i] = {true};
+            ++decoded;
+        } else {
+            std::fill(record.begin(), record.end(), uint8_t{0});
+            status[i] = {false, result.error().code};
+        }
+    }
+    return decoded;
+}
+
+std::expected<size_t, Error> EncodeBatch(std::span<const uint8_t> records, size_t recordSize, std::span<char> out, size_t outStride) {
+    if (recordSize == 0 || outStride < 2 * recordSize) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch output stride " + std::to_string(outStride) + " cannot hold records of " + std::to_string(recordSize) + " bytes"});
+    }
+    // No status array: pass the record count, which always fits.
+    auto count = detail::CheckBatchSizes(records.size(), recordSize, out.size(), outStride, records.size() / recordSize);
+    if (!count) {
+        return std::unexpected(count.error());
+    }
+
+    for (size_t i = 0; i < *count; ++i) {
+        char* slot = out.data() + i * outStride;
+        EncodeDigits(records.subspan(i * recordSize, recordSize), slot);
+        std::memset(slot + 2 * recordSize, 0, outStride - 2 * recordSize);
+    }
+    return *count;
+}
+
+}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SIMD hex kernels, each compiled with its own ISA flags; hex.cpp only calls them once the CPU has
+// been checked. A kernel converts whole blocks and leaves the remainder to the caller.
+namespace BitcoinKeyUtils::detail::hex {
+
+// Decode blocks of 32 (AVX2) or 16 (SSE4.1) digits into digits / 2 bytes, stopping before the first
+// block that holds a character which is not a hex digit. Return the number of digits decoded.
+size_t DecodeAVX2(const char* hex, size_t digits, uint8_t* out);
+size_t DecodeSSE41(const char* hex, size_t digits, uint8_t* out);
+
+// Encode blocks of 32 (AVX2) or 16 (SSE4.1) bytes as lowercase hex. Return the number of bytes encoded.
+size_t EncodeAVX2(const uint8_t* bytes, size_t size, char* out);
+size_t EncodeSSE41(const uint8_t* bytes, size_t size, char* out);
+
+}
@@ -0,0 +1,58 @@
+// Hex decode and encode of 32-character blocks with AVX2; the same steps as hex_sse41.cpp, in both
+// 128-bit lanes at once.
+
+#ifdef ENABLE_AVX2
+
+#include "hex.h"
+
+#include <immintrin.h>
+
+namespace BitcoinKeyUtils::detail::hex {
+
+size_t DecodeAVX2(const char* hex, size_t digits, uint8_t* out) {
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i a = _mm256_set1_epi8('a');
+    const __m256i five = _mm256_set1_epi8(5);
+    const __m256i ten = _mm256_set1_epi8(10);
+    const __m256i lowercase = _mm256_set1_epi8(0x20);
+    const __m256i weights = _mm256_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 32 <= digits; i += 32) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i));
+        const __m256i digit = _mm256_sub_epi8(chars, zero);
+        const __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, nine), digit);
+        const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, lowercase), a);
+        const __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, five), letter);
+        if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isLetter)) != -1) break;
+
+        const __m256i nibbles = _mm256_blendv_epi8(_mm256_add_epi8(letter, ten), digit, isDigit);
+        const __m256i bytes = _mm256_maddubs_epi16(nibbles, weights);
+        // Packing works within lanes, so the 8 bytes of each lane end up in 64-bit words 0 and 2.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(bytes, bytes), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 2), _mm256_castsi256_si128(packed));
+    }
+    return i;
+}
+
+size_t EncodeAVX2(const uint8_t* bytes, size_t size, char* out) {
+    const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                            '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+        const __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(b, 4), mask));
+        const __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(b, mask));
+        // Interleaving works within lanes: the low halves hold bytes 0-7 and 16-23, the high halves 8-15 and 24-31.
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return i;
+}
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+// Hex decode and encode of 16-character blocks with SSE4.1.
+
+#ifdef ENABLE_SSE41
+
+#include "hex.h"
+
+#include <immintrin.h>
+
+namespace BitcoinKeyUtils::detail::hex {
+
+size_t DecodeSSE41(const char* hex, size_t digits, uint8_t* out) {
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i a = _mm_set1_epi8('a');
+    const __m128i five = _mm_set1_epi8(5);
+    const __m128i ten = _mm_set1_epi8(10);
+    const __m128i lowercase = _mm_set1_epi8(0x20);
+    // Multipliers of each pair of nibbles: the first is the high one.
+    const __m128i weights = _mm_set1_epi16(0x0110);
+    size_t i = 0;
+    for (; i + 16 <= digits; i += 16) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i));
+        // A character is a digit if c - '0' is at most 9, and a letter if (c | 0x20) - 'a' is at most
+        // 5, both unsigned; everything else wraps around to a larger value.
+        const __m128i digit = _mm_sub_epi8(chars, zero);
+        const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, nine), digit);
+        const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, lowercase), a);
+        const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, five), letter);
+        if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff) break;
+
+        const __m128i nibbles = _mm_blendv_epi8(_mm_add_epi8(letter, ten), digit, isDigit);
+        const __m128i bytes = _mm_maddubs_epi16(nibbles, weights);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i / 2), _mm_packus_epi16(bytes, bytes));
+    }
+    return i;
+}
+
+size_t EncodeSSE41(const uint8_t* bytes, size_t size, char* out) {
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+        const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(b, 4), mask));
+        const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(b, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+    }
+    return i;
+}
+
+}
+
+#endif
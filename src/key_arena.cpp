@@ -0,0 +1,195 @@
+#include "bitcoin_key_utils.h"
+#include "batch_internal.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define KEY_ARENA_MMAP 1
+#endif
+
+namespace BitcoinKeyUtils {
+
+namespace {
+
+constexpr size_t SlotSize = Constants::PrivateKeySize;
+
+std::unexpected<Error> MemoryError(std::string_view what, size_t bytes) {
+    return std::unexpected(Error{ErrorCode::SecureMemoryUnavailable, std::string(what) + " " + std::to_string(bytes) + " bytes for key slots: " + std::strerror(errno)});
+}
+
+}
+
+struct KeyArena::Pool {
+    uint8_t* data = nullptr;
+    size_t bytes = 0;
+    size_t capacity = 0;
+
+    mutable std::mutex mutex;
+    // One bit per slot, set while the slot is taken. Bits past the capacity are set, so a last word
+    // whose slots are all taken is skipped like any other.
+    std::vector<uint64_t> taken;
+    size_t available = 0;
+
+    ~Pool() {
+#ifdef KEY_ARENA_MMAP
+        if (data) {
+            detail::Wipe(data, bytes);
+            munlock(data, bytes);
+            munmap(data, bytes);
+        }
+#endif
+    }
+
+    // True if no KeySlots is outstanding. One that outlived its pool would release into unmapped pages.
+    bool Idle() const {
+        std::lock_guard lock(mutex);
+        return available == capacity;
+    }
+
+    bool IsTaken(size_t slot) const {
+        return taken[slot / 64] >> (slot % 64) & 1;
+    }
+
+    void Mark(size_t first, size_t count, bool value) {
+        for (size_t slot = first; slot < first + count; ++slot) {
+            const uint64_t bit = uint64_t{1} << (slot % 64);
+            taken[slot / 64] = value ? taken[slot / 64] | bit : taken[slot / 64] & ~bit;
+        }
+    }
+
+    // First fit: the lowest run of count free slots, or capacity if there is none.
+    size_t FindRun(size_t count) const {
+        size_t run = 0;
+        for (size_t slot = 0; slot < capacity; ++slot) {
+            if (run == 0 && slot % 64 == 0 && taken[slot / 64] == ~uint64_t{0}) {
+                slot += 63;
+            } else if (IsTaken(slot)) {
+                run = 0;
+            } else if (++run == count) {
+                return slot + 1 - count;
+            }
+        }
+        return capacity;
+    }
+
+    void Release(size_t first, size_t count) noexcept {
+        detail::Wipe(data + first * SlotSize, count * SlotSize);
+        std::lock_guard lock(mutex);
+        Mark(first, count, false);
+        available += count;
+    }
+};
+
+KeyArena::KeyArena(std::unique_ptr<Pool> pool) : m_pool(std::move(pool)) {}
+KeyArena::KeyArena(KeyArena&& other) noexcept = default;
+
+KeyArena& KeyArena::operator=(KeyArena&& other) noexcept {
+    if (this != &other) {
+        assert(!m_pool || m_pool->Idle());
+        m_pool = std::move(other.m_pool);
+    }
+    return *this;
+}
+
+KeyArena::~KeyArena() {
+    assert(!m_pool || m_pool->Idle());
+}
+
+std::expected<KeyArena, Error> KeyArena::Create(size_t slots) {
+#ifdef KEY_ARENA_MMAP
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (slots > (std::numeric_limits<size_t>::max() - page) / SlotSize) {
+        errno = ENOMEM;
+        return MemoryError("Cannot map", slots * SlotSize);
+    }
+    const size_t bytes = std::max<size_t>(1, (slots * SlotSize + page - 1) / page) * page;
+    void* map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return MemoryError("Cannot map", bytes);
+    }
+    if (mlock(map, bytes) != 0) {
+        auto error = MemoryError("Cannot lock", bytes);
+        munmap(map, bytes);
+        return error;
+    }
+#ifdef MADV_DONTDUMP
+    madvise(map, bytes, MADV_DONTDUMP);
+#endif
+#ifdef MADV_WIPEONFORK
+    madvise(map, bytes, MADV_WIPEONFORK);
+#endif
+
+    auto pool = std::make_unique<Pool>();
+    pool->data = static_cast<uint8_t*>(map);
+    pool->bytes = bytes;
+    pool->capacity = bytes / SlotSize;
+    pool->available = pool->capacity;
+    pool->taken.assign((pool->capacity + 63) / 64, 0);
+    if (pool->capacity % 64 != 0) pool->taken.back() = ~uint64_t{0} << (pool->capacity % 64);
+    return KeyArena(std::move(pool));
+#else
+    (void)slots;
+    return std::unexpected(Error{ErrorCode::SecureMemoryUnavailable, "Locked memory for key slots is not supported on this platform"});
+#endif
+}
+
+size_t KeyArena::Capacity() const noexcept {
+    return m_pool->capacity;
+}
+
+size_t KeyArena::Available() const noexcept {
+    std::lock_guard lock(m_pool->mutex);
+    return m_pool->available;
+}
+
+std::expected<KeySlots, ErrorCode> KeyArena::Acquire(size_t count) {
+    if (count == 0) return KeySlots();
+    std::lock_guard lock(m_pool->mutex);
+    const size_t first = count <= m_pool->available ? m_pool->FindRun(count) : m_pool->capacity;
+    if (first == m_pool->capacity) {
+        return std::unexpected(ErrorCode::KeyArenaExhausted);
+    }
+    m_pool->Mark(first, count, true);
+    m_pool->available -= count;
+    return KeySlots(m_pool.get(), first, count, m_pool->data + first * SlotSize);
+}
+
+KeySlots::KeySlots(KeyArena::Pool* pool, size_t first, size_t count, uint8_t* data) noexcept
+    : m_pool(pool), m_first(first), m_count(count), m_data(data) {}
+
+KeySlots::KeySlots(KeySlots&& other) noexcept
+    : m_pool(std::exchange(other.m_pool, nullptr)), m_first(std::exchange(other.m_first, 0)),
+      m_count(std::exchange(other.m_count, 0)), m_data(std::exchange(other.m_data, nullptr)) {}
+
+KeySlots& KeySlots::operator=(KeySlots&& other) noexcept {
+    if (this != &other) {
+        Release();
+        m_pool = std::exchange(other.m_pool, nullptr);
+        m_first = std::exchange(other.m_first, 0);
+        m_count = std::exchange(other.m_count, 0);
+        m_data = std::exchange(other.m_data, nullptr);
+    }
+    return *this;
+}
+
+KeySlots::~KeySlots() {
+    Release();
+}
+
+void KeySlots::Release() noexcept {
+    if (m_pool) m_pool->Release(m_first, m_count);
+    m_pool = nullptr;
+    m_first = 0;
+    m_count = 0;
+    m_data = nullptr;
+}
+
+}
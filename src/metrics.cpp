@@ -0,0 +1,154 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace BitcoinKeyUtils {
+
+namespace detail::metrics {
+
+namespace {
+
+// Each thread only writes its own counters, with a relaxed load and store rather than a locked
+// read-modify-write; Collect reads them concurrently, which is why they are atomics at all.
+using Counter = std::atomic<uint64_t>;
+
+void Bump(Counter& counter, uint64_t n) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct FunctionCounters {
+    Counter calls{0};
+    Counter records{0};
+    Counter nanoseconds{0};
+    std::array<Counter, Metrics::LatencyBucketCount> latency{};
+};
+
+struct ThreadCounters {
+    std::array<FunctionCounters, Metrics::FunctionCount> functions{};
+    std::array<Counter, Metrics::ErrorCodeCount> errors{};
+    Counter bytesHashed{0};
+};
+
+void AddTo(Metrics::Snapshot& snapshot, const ThreadCounters& counters) {
+    for (size_t f = 0; f < Metrics::FunctionCount; ++f) {
+        const FunctionCounters& from = counters.functions[f];
+        Metrics::FunctionStats& to = snapshot.functions[f];
+        to.calls += from.calls.load(std::memory_order_relaxed);
+        to.records += from.records.load(std::memory_order_relaxed);
+        to.totalNanoseconds += from.nanoseconds.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < Metrics::LatencyBucketCount; ++b) to.latency[b] += from.latency[b].load(std::memory_order_relaxed);
+    }
+    for (size_t e = 0; e < Metrics::ErrorCodeCount; ++e) snapshot.errors[e] += counters.errors[e].load(std::memory_order_relaxed);
+    snapshot.bytesHashed += counters.bytesHashed.load(std::memory_order_relaxed);
+}
+
+// Counters of the live threads, and the merged counters of the threads that have exited.
+struct Registry {
+    std::mutex mutex;
+    std::vector<const ThreadCounters*> live;
+    Metrics::Snapshot retired;
+};
+
+// Never destroyed: threads may exit, and retire their counters, after static destruction has begun.
+Registry& GetRegistry() {
+    static Registry* registry = new Registry;
+    return *registry;
+}
+
+// A thread's counters, registered on its first instrumented call and retired when it exits.
+struct ThreadSlot {
+    ThreadCounters counters;
+
+    ThreadSlot() {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        registry.live.push_back(&counters);
+    }
+
+    ~ThreadSlot() {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        AddTo(registry.retired, counters);
+        std::erase(registry.live, &counters);
+    }
+};
+
+ThreadCounters& Local() {
+    thread_local ThreadSlot slot;
+    return slot.counters;
+}
+
+}
+
+void RecordCall(Metrics::Function function, uint64_t records, uint64_t nanoseconds) noexcept {
+    FunctionCounters& counters = Local().functions[static_cast<size_t>(function)];
+    Bump(counters.calls, 1);
+    Bump(counters.records, records);
+    Bump(counters.nanoseconds, nanoseconds);
+    Bump(counters.latency[Metrics::LatencyBucket(nanoseconds)], 1);
+}
+
+void RecordErrors(ErrorCode code, uint64_t count) noexcept {
+    Bump(Local().errors[static_cast<size_t>(code)], count);
+}
+
+void RecordBytesHashed(uint64_t bytes) noexcept {
+    Bump(Local().bytesHashed, bytes);
+}
+
+}
+
+namespace Metrics {
+
+uint64_t FunctionStats::Quantile(double q) const noexcept {
+    if (calls == 0) return 0;
+    const double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(calls);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < LatencyBucketCount; ++b) {
+        seen += latency[b];
+        if (seen != 0 && static_cast<double>(seen) >= rank) return LatencyBucketLowerBound(b);
+    }
+    return LatencyBucketLowerBound(LatencyBucketCount - 1);
+}
+
+Snapshot Collect() {
+    Snapshot snapshot;
+    if constexpr (detail::metrics::Enabled) {
+        detail::metrics::Registry& registry = detail::metrics::GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        snapshot = registry.retired;
+        for (const detail::metrics::ThreadCounters* counters : registry.live) detail::metrics::AddTo(snapshot, *counters);
+    }
+    snapshot.enabled = detail::metrics::Enabled;
+    snapshot.sha256Backend = SHA256Backend();
+    snapshot.ripemd160Backend = RIPEMD160Backend();
+    return snapshot;
+}
+
+std::string_view FunctionName(Function function) {
+    switch (function) {
+    case Function::EncodeWIF: return "EncodeWIF";
+    case Function::DecodeWIF: return "DecodeWIF";
+    case Function::DerivePublicKey: return "DerivePublicKey";
+    case Function::HashRIPEMD160SHA256: return "HashRIPEMD160SHA256";
+    case Function::GenerateP2PKHAddress: return "GenerateP2PKHAddress";
+    case Function::GenerateP2WPKHAddress: return "GenerateP2WPKHAddress";
+    case Function::DecodeAddress: return "DecodeAddress";
+    case Function::EncodeWIFBatch: return "EncodeWIFBatch";
+    case Function::DecodeWIFBatch: return "DecodeWIFBatch";
+    case Function::DerivePublicKeyBatch: return "DerivePublicKeyBatch";
+    case Function::HashRIPEMD160SHA256Batch: return "HashRIPEMD160SHA256Batch";
+    case Function::GenerateP2PKHAddressBatch: return "GenerateP2PKHAddressBatch";
+    case Function::GenerateP2WPKHAddressBatch: return "GenerateP2WPKHAddressBatch";
+    case Function::ValidateAddresses: return "ValidateAddresses";
+    case Function::EncodeAddress: return "EncodeAddress";
+    }
+    return "Unknown";
+}
+
+}
+
+}
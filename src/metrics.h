@@ -0,0 +1,102 @@
+#pragma once
+
+#include "bitcoin_key_utils.h"
+
+#include <chrono>
+#include <expected>
+#include <span>
+
+// Hot-path hooks of the Metrics API. Without BITCOIN_KEY_UTILS_METRICS every hook is an empty inline
+// function and Scope records nothing, so nothing is left in the compiled code.
+namespace BitcoinKeyUtils::detail::metrics {
+
+#ifdef BITCOIN_KEY_UTILS_METRICS
+inline constexpr bool Enabled = true;
+#else
+inline constexpr bool Enabled = false;
+#endif
+
+// Counters of the calling thread; see metrics.cpp.
+void RecordCall(Metrics::Function function, uint64_t records, uint64_t nanoseconds) noexcept;
+void RecordErrors(ErrorCode code, uint64_t count) noexcept;
+void RecordBytesHashed(uint64_t bytes) noexcept;
+
+inline void AddBytesHashed(uint64_t bytes) noexcept {
+    if constexpr (Enabled) RecordBytesHashed(bytes);
+}
+
+inline ErrorCode CodeOf(ErrorCode code) { return code; }
+inline ErrorCode CodeOf(const Error& error) { return error.code; }
+
+inline uint64_t Since(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+// Counts a single-key or batch call, its records and its latency, from construction to destruction,
+// so every return path is timed. Each value the call returns goes through Return, which notes its
+// error, or for a batch how many records succeeded, and the errors are counted on exit as well.
+class Scope {
+public:
+    // A batch call passes its record count and status; records whose status is not ok are counted by
+    // their code. status may be empty.
+    explicit Scope(Metrics::Function function, size_t records = 1, std::span<const BatchStatus> status = {}) noexcept
+        : m_function(function), m_records(records), m_succeeded(records), m_status(status) {
+        if constexpr (Enabled) m_start = std::chrono::steady_clock::now();
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope() {
+        if constexpr (Enabled) {
+            RecordCall(m_function, m_records, Since(m_start));
+            if (m_failed) {
+                RecordErrors(m_error, 1);
+            } else if (m_succeeded < m_records && m_status.size() >= m_records) {
+                for (size_t i = 0; i < m_records; ++i) {
+                    if (!m_status[i].ok) RecordErrors(m_status[i].code, 1);
+                }
+            }
+        }
+    }
+
+    // Pass through a value about to be returned: a std::expected, a std::unexpected, or a plain value.
+    template <typename T>
+    T Return(T result) {
+        if constexpr (Enabled) Note(result);
+        return result;
+    }
+
+private:
+    template <typename T, typename E>
+    void Note(const std::expected<T, E>& result) {
+        if (result) {
+            Note(*result);
+        } else {
+            m_failed = true;
+            m_error = CodeOf(result.error());
+        }
+    }
+
+    template <typename E>
+    void Note(const std::unexpected<E>& error) {
+        m_failed = true;
+        m_error = CodeOf(error.error());
+    }
+
+    // The count a batch call returns.
+    void Note(size_t succeeded) { m_succeeded = succeeded; }
+
+    template <typename T>
+    void Note(const T&) {}
+
+    Metrics::Function m_function;
+    size_t m_records;
+    size_t m_succeeded;
+    std::span<const BatchStatus> m_status;
+    std::chrono::steady_clock::time_point m_start{};
+    bool m_failed = false;
+    ErrorCode m_error{};
+};
+
+}
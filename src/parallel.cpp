@@ -0,0 +1,320 @@
+#include "bitcoin_key_utils.h"
+#include "batch_internal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace BitcoinKeyUtils::Parallel {
+
+namespace {
+
+// Records per tile when the caller does not choose: about 170 bytes of input and output per
+// record for DeriveAddresses, so a tile stays around 170 KiB, within a typical per-core L2.
+constexpr size_t DefaultTileRecords = 1024;
+// Tiles are a multiple of the widest multi-buffer kernel so only the last tile has a ragged end.
+constexpr size_t TileGranularity = 64;
+constexpr size_t MinScratchBlock = 64 * 1024;
+
+void PinThread([[maybe_unused]] std::thread& thread, [[maybe_unused]] int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // Best effort: a CPU outside the process's allowed set leaves the thread unpinned.
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+// Zero the output slots of records that already failed, and report the first failure of the rest.
+size_t MergeStatus(std::span<BatchStatus> status, std::span<const BatchStatus> stage, std::span<char> slots, size_t stride) {
+    size_t ok = 0;
+    for (size_t i = 0; i < status.size(); ++i) {
+        if (!status[i].ok) {
+            std::fill_n(slots.begin() + i * stride, stride, '\0');
+        } else if (!stage[i].ok) {
+            status[i] = stage[i];
+        } else {
+            ++ok;
+        }
+    }
+    return ok;
+}
+
+}
+
+void ScratchArena::Reset() {
+    // If the last tile spilled into several blocks, replace them with one block large enough for all.
+    if (m_blocks.size() > 1) {
+        const size_t total = std::accumulate(m_sizes.begin(), m_sizes.end(), size_t{0});
+        m_blocks.clear();
+        m_sizes.clear();
+        m_blocks.push_back(std::make_unique<std::byte[]>(total));
+        m_sizes.push_back(total);
+    }
+    m_block = 0;
+    m_used = 0;
+}
+
+void* ScratchArena::Allocate(size_t size, size_t align) {
+    for (; m_block < m_blocks.size(); ++m_block, m_used = 0) {
+        const size_t offset = (m_used + align - 1) / align * align;
+        if (offset + size <= m_sizes[m_block]) {
+            m_used = offset + size;
+            return m_blocks[m_block].get() + offset;
+        }
+    }
+    const size_t blockSize = std::max({size, MinScratchBlock, m_sizes.empty() ? size_t{0} : 2 * m_sizes.back()});
+    m_blocks.push_back(std::make_unique<std::byte[]>(blockSize));
+    m_sizes.push_back(blockSize);
+    m_block = m_blocks.size() - 1;
+    m_used = size;
+    return m_blocks.back().get();
+}
+
+/**
+ * Tile ranges are packed as (next << 32 | end) in one atomic word per worker. The owner takes
+ * tiles from the front and thieves from the back, both with a compare-and-swap on that word.
+ */
+struct Executor::Pool {
+    struct alignas(64) Worker {
+        std::atomic<uint64_t> range{0};
+        ScratchArena scratch;
+    };
+
+    static constexpr size_t NoTile = SIZE_MAX;
+
+    size_t tileRecords = DefaultTileRecords;
+    size_t threadCount = 0;
+    std::unique_ptr<Worker[]> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex runMutex; // one job at a time
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    uint64_t generation = 0;
+    size_t active = 0;
+    bool stopping = false;
+
+    // The current job.
+    TileFn fn = nullptr;
+    void* ctx = nullptr;
+    size_t count = 0;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+
+    size_t TakeOwn(Worker& w) {
+        uint64_t r = w.range.load(std::memory_order_relaxed);
+        while ((r >> 32) < (r & 0xffffffff)) {
+            if (w.range.compare_exchange_weak(r, r + (uint64_t{1} << 32), std::memory_order_acq_rel)) return r >> 32;
+        }
+        return NoTile;
+    }
+
+    size_t Steal(Worker& w) {
+        uint64_t r = w.range.load(std::memory_order_relaxed);
+        while ((r >> 32) < (r & 0xffffffff)) {
+            if (w.range.compare_exchange_weak(r, r - 1, std::memory_order_acq_rel)) return (r & 0xffffffff) - 1;
+        }
+        return NoTile;
+    }
+
+    void RunTile(size_t tile, ScratchArena& scratch) {
+        if (failed.load(std::memory_order_relaxed)) return;
+        const size_t begin = tile * tileRecords;
+        const size_t end = std::min(count, begin + tileRecords);
+        scratch.Reset();
+        try {
+            fn(ctx, begin, end, scratch);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+            failed = true;
+        }
+    }
+
+    void Drain(size_t self) {
+        Worker& own = workers[self];
+        for (size_t tile; (tile = TakeOwn(own)) != NoTile;) RunTile(tile, own.scratch);
+        // Ranges only shrink while a job runs, so one pass over the other workers finds all remaining tiles.
+        for (size_t k = 1; k < threadCount; ++k) {
+            Worker& victim = workers[(self + k) % threadCount];
+            for (size_t tile; (tile = Steal(victim)) != NoTile;) RunTile(tile, own.scratch);
+        }
+    }
+
+    void WorkerLoop(size_t self) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            Drain(self);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--active == 0) done.notify_one();
+            }
+        }
+    }
+};
+
+Executor::Executor(ExecutorOptions options) : m_pool(std::make_unique<Pool>()) {
+    // Hashing on the workers must not race with the one-time backend selection. It runs in the
+    // initializer of a function-local static, which is thread-safe in the same way as std::call_once.
+    (void)SHA256Backend();
+
+    Pool& pool = *m_pool;
+    pool.threadCount = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    if (options.tileRecords) {
+        pool.tileRecords = (options.tileRecords + TileGranularity - 1) / TileGranularity * TileGranularity;
+    }
+    pool.workers = std::make_unique<Pool::Worker[]>(pool.threadCount);
+    pool.threads.reserve(pool.threadCount);
+    for (size_t i = 0; i < pool.threadCount; ++i) {
+        pool.threads.emplace_back([&pool, i] { pool.WorkerLoop(i); });
+        if (!options.cpuAffinity.empty()) {
+            PinThread(pool.threads.back(), options.cpuAffinity[i % options.cpuAffinity.size()]);
+        }
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(m_pool->mutex);
+        m_pool->stopping = true;
+    }
+    m_pool->wake.notify_all();
+    for (auto& thread : m_pool->threads) thread.join();
+}
+
+size_t Executor::ThreadCount() const {
+    return m_pool->threadCount;
+}
+
+void Executor::Run(size_t count, TileFn fn, void* ctx) {
+    Pool& pool = *m_pool;
+    if (count == 0) return;
+    std::lock_guard<std::mutex> runLock(pool.runMutex);
+
+    // A single tile runs on the caller; the workers are idle, so worker 0's scratch is free to borrow.
+    if (count <= pool.tileRecords) {
+        pool.workers[0].scratch.Reset();
+        fn(ctx, 0, count, pool.workers[0].scratch);
+        return;
+    }
+
+    const size_t tiles = (count + pool.tileRecords - 1) / pool.tileRecords;
+    pool.fn = fn;
+    pool.ctx = ctx;
+    pool.count = count;
+    pool.failed = false;
+    // Contiguous initial shares keep each worker streaming through adjacent memory.
+    for (size_t i = 0, first = 0; i < pool.threadCount; ++i) {
+        const size_t share = tiles / pool.threadCount + (i < tiles % pool.threadCount);
+        pool.workers[i].range.store(uint64_t{first} << 32 | (first + share), std::memory_order_relaxed);
+        first += share;
+    }
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.active = pool.threadCount;
+        ++pool.generation;
+        pool.wake.notify_all();
+        pool.done.wait(lock, [&] { return pool.active == 0; });
+        std::swap(error, pool.error);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+std::expected<size_t, Error> Executor::DeriveAddresses(const AddressJob& job) {
+    // A zero-record call validates pubKeySize with the serial API's error.
+    if (auto valid = BitcoinKeyUtils::HashRIPEMD160SHA256Batch(job.pubKeys.first(0), job.pubKeySize, {}, {}); !valid) {
+        return std::unexpected(valid.error());
+    }
+    auto count = detail::CheckBatchSizes(job.pubKeys.size(), job.pubKeySize, job.hashes.size(), job.hashes.empty() ? 0 : Constants::Hash160Size, job.status.size());
+    for (auto [out, stride] : {std::pair{job.p2pkh.size(), Constants::P2PKHStride}, std::pair{job.p2wpkh.size(), Constants::P2WPKHStride}}) {
+        if (count && out != 0) {
+            count = detail::CheckBatchSizes(job.pubKeys.size(), job.pubKeySize, out, stride, job.status.size());
+        }
+    }
+    if (!count) {
+        return std::unexpected(count.error());
+    }
+    if (!job.p2wpkh.empty()) {
+        if (auto encoder = detail::SegwitV0Encoder(job.hrp); !encoder) {
+            return std::unexpected(encoder.error());
+        }
+    }
+
+    std::atomic<size_t> converted{0};
+    ForEachTile(*count, [&](size_t begin, size_t end, ScratchArena& scratch) {
+        const size_t n = end - begin;
+        std::span<BatchStatus> status = job.status.subspan(begin, n);
+        std::span<uint8_t> hashes = job.hashes.empty() ? scratch.Take<uint8_t>(n * Constants::Hash160Size)
+                                                       : job.hashes.subspan(begin * Constants::Hash160Size, n * Constants::Hash160Size);
+        size_t ok = *BitcoinKeyUtils::HashRIPEMD160SHA256Batch(job.pubKeys.subspan(begin * job.pubKeySize, n * job.pubKeySize), job.pubKeySize, hashes, status);
+
+        std::span<BatchStatus> stage = scratch.Take<BatchStatus>(n);
+        if (!job.p2pkh.empty()) {
+            std::span<char> slots = job.p2pkh.subspan(begin * Constants::P2PKHStride, n * Constants::P2PKHStride);
+            (void)BitcoinKeyUtils::GenerateP2PKHAddressBatch(hashes, slots, stage);
+            ok = MergeStatus(status, stage, slots, Constants::P2PKHStride);
+        }
+        if (!job.p2wpkh.empty()) {
+            std::span<char> slots = job.p2wpkh.subspan(begin * Constants::P2WPKHStride, n * Constants::P2WPKHStride);
+            (void)BitcoinKeyUtils::GenerateP2WPKHAddressBatch(hashes, slots, stage, job.hrp);
+            ok = MergeStatus(status, stage, slots, Constants::P2WPKHStride);
+        }
+        converted.fetch_add(ok, std::memory_order_relaxed);
+    });
+    return converted.load();
+}
+
+std::expected<size_t, Error> Executor::EncodeWIFBatch(std::span<const uint8_t> privateKeys, bool compressed, std::span<char> out, std::span<BatchStatus> status) {
+    auto count = detail::CheckBatchSizes(privateKeys.size(), Constants::PrivateKeySize, out.size(), Constants::WIFStride, status.size());
+    if (!count) {
+        return std::unexpected(count.error());
+    }
+
+    std::atomic<size_t> encoded{0};
+    ForEachTile(*count, [&](size_t begin, size_t end, ScratchArena&) {
+        const size_t n = end - begin;
+        auto result = BitcoinKeyUtils::EncodeWIFBatch(privateKeys.subspan(begin * Constants::PrivateKeySize, n * Constants::PrivateKeySize), compressed,
+                                                      out.subspan(begin * Constants::WIFStride, n * Constants::WIFStride), status.subspan(begin, n));
+        encoded.fetch_add(*result, std::memory_order_relaxed);
+    });
+    return encoded.load();
+}
+
+std::expected<size_t, Error> Executor::DerivePublicKeyBatch(std::span<const uint8_t> privateKeys, bool compressed, std::span<uint8_t> out, std::span<BatchStatus> status) {
+    const size_t pubKeySize = compressed ? Constants::CompressedPubKeySize : Constants::UncompressedPubKeySize;
+    auto count = detail::CheckBatchSizes(privateKeys.size(), Constants::PrivateKeySize, out.size(), pubKeySize, status.size());
+    if (!count) {
+        return std::unexpected(count.error());
+    }
+
+    std::atomic<size_t> derived{0};
+    ForEachTile(*count, [&](size_t begin, size_t end, ScratchArena&) {
+        const size_t n = end - begin;
+        auto result = BitcoinKeyUtils::DerivePublicKeyBatch(privateKeys.subspan(begin * Constants::PrivateKeySize, n * Constants::PrivateKeySize), compressed,
+                                                            out.subspan(begin * pubKeySize, n * pubKeySize), status.subspan(begin, n));
+        derived.fetch_add(*result, std::memory_order_relaxed);
+    });
+    return derived.load();
+}
+
+}
@@ -0,0 +1,386 @@
+#include "bitcoin_key_utils.h"
+
+#include "batch_internal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RECORD_FILE_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace BitcoinKeyUtils::RecordFile {
+
+namespace {
+
+// File layout; integers are little-endian and blocks and columns start on 64-byte boundaries.
+//   header     magic, version, key slot size, records per block, record count, block count, the
+//              size of a full block, the offset of the checksums and the file size
+//   blocks     blockCount blocks of blockRecords records, the last one possibly shorter; each is
+//              its hash, public key, address type and key slot columns
+//   checksums  the SHA-256 of each block, padding included
+// As in the watch list index, every size and offset follows from the record count and the
+// options, so opening checks the header against the layout computed for them. The writer leaves
+// the header zero until Finish, so an unfinished file has a bad magic.
+constexpr char Magic[8] = {'B', 'K', 'U', 'R', 'E', 'C', 'F', 'L'};
+constexpr uint32_t Version = 1;
+constexpr size_t HeaderSize = 64;
+constexpr uint64_t SectionAlign = 64;
+constexpr size_t ChecksumSize = CSHA256::OUTPUT_SIZE;
+
+constexpr size_t MaxKeySlotSize = 1024;
+constexpr size_t MaxBlockRecords = size_t{1} << 20;
+
+constexpr size_t HashSize = Constants::Hash160Size;
+constexpr size_t PubKeySize = Constants::CompressedPubKeySize;
+
+uint64_t AlignUp(uint64_t n) {
+    return (n + SectionAlign - 1) / SectionAlign * SectionAlign;
+}
+
+// Column offsets within a block of n records, and the block's size.
+struct BlockLayout {
+    uint64_t records = 0;
+    uint64_t pubKeys = 0;
+    uint64_t addressTypes = 0;
+    uint64_t keySlots = 0;
+    uint64_t size = 0;
+
+    BlockLayout(uint64_t n, uint64_t keySlotSize) : records(n) {
+        pubKeys = AlignUp(n * HashSize);
+        addressTypes = AlignUp(pubKeys + n * PubKeySize);
+        keySlots = AlignUp(addressTypes + n);
+        size = AlignUp(keySlots + n * keySlotSize);
+    }
+};
+
+struct FileLayout {
+    uint64_t count = 0;
+    uint64_t keySlotSize = 0;
+    uint64_t blockRecords = 0;
+    uint64_t blockCount = 0;
+    uint64_t blockStride = 0;
+    uint64_t checksumOffset = 0;
+    uint64_t fileSize = 0;
+
+    uint64_t BlockOffset(uint64_t i) const { return HeaderSize + i * blockStride; }
+    uint64_t BlockSize(uint64_t i) const { return std::min(blockRecords, count - i * blockRecords); }
+};
+
+FileLayout MakeLayout(uint64_t count, uint64_t keySlotSize, uint64_t blockRecords) {
+    FileLayout layout;
+    layout.count = count;
+    layout.keySlotSize = keySlotSize;
+    layout.blockRecords = blockRecords;
+    layout.blockCount = (count + blockRecords - 1) / blockRecords;
+    layout.blockStride = BlockLayout(blockRecords, keySlotSize).size;
+    layout.checksumOffset = HeaderSize;
+    if (layout.blockCount) {
+        const uint64_t last = layout.blockCount - 1;
+        layout.checksumOffset = layout.BlockOffset(last) + BlockLayout(layout.BlockSize(last), keySlotSize).size;
+    }
+    layout.fileSize = layout.checksumOffset + layout.blockCount * ChecksumSize;
+    return layout;
+}
+
+void WriteHeader(uint8_t* header, const FileLayout& layout) {
+    std::memcpy(header, Magic, sizeof(Magic));
+    WriteLE32(header + 8, Version);
+    WriteLE32(header + 12, static_cast<uint32_t>(layout.keySlotSize));
+    WriteLE32(header + 16, static_cast<uint32_t>(layout.blockRecords));
+    WriteLE32(header + 20, 0);
+    WriteLE64(header + 24, layout.count);
+    WriteLE64(header + 32, layout.blockCount);
+    WriteLE64(header + 40, layout.blockStride);
+    WriteLE64(header + 48, layout.checksumOffset);
+    WriteLE64(header + 56, layout.fileSize);
+}
+
+std::unexpected<Error> IOError(std::string_view what, const std::string& path) {
+    return std::unexpected(Error{ErrorCode::RecordFileIOFailed, std::string(what) + " " + path + ": " + std::strerror(errno)});
+}
+
+std::unexpected<Error> FormatError(const std::string& path, std::string_view why) {
+    return std::unexpected(Error{ErrorCode::InvalidRecordFileFormat, "Not a record file: " + path + ": " + std::string(why)});
+}
+
+std::expected<void, Error> CheckOptions(const Options& options) {
+    if (options.keySlotSize > MaxKeySlotSize || options.blockRecords == 0 || options.blockRecords > MaxBlockRecords) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Record file options out of range: key slot size " + std::to_string(options.keySlotSize) +
+                                                                       ", block records " + std::to_string(options.blockRecords)});
+    }
+    return {};
+}
+
+}
+
+struct Writer::State {
+    // Records go to tmpPath, which Finish renames over path.
+    std::FILE* file = nullptr;
+    std::string path;
+    std::string tmpPath;
+    Options options;
+    BlockLayout full;
+    // One full block, columns at their final offsets; the padding between them stays zero.
+    std::vector<uint8_t> block;
+    size_t buffered = 0;
+    uint64_t count = 0;
+    std::vector<uint8_t> checksums;
+
+    State(std::FILE* f, std::string p, Options o)
+        : file(f), path(std::move(p)), tmpPath(path + ".tmp"), options(o), full(o.blockRecords, o.keySlotSize), block(full.size) {}
+
+    ~State() {
+        // An unfinished file is dropped; path keeps whatever it held before.
+        if (file) detail::CommitFile(file, false, tmpPath, path);
+        detail::Wipe(block.data(), block.size());
+    }
+
+    std::expected<void, Error> Flush() {
+        if (buffered == 0) return {};
+        std::span<const uint8_t> data = block;
+        // A short block, which only Finish writes, is compacted into its own layout.
+        std::vector<uint8_t> compact;
+        if (buffered < options.blockRecords) {
+            const BlockLayout layout(buffered, options.keySlotSize);
+            compact.assign(layout.size, 0);
+            std::memcpy(compact.data(), block.data(), buffered * HashSize);
+            std::memcpy(compact.data() + layout.pubKeys, block.data() + full.pubKeys, buffered * PubKeySize);
+            std::memcpy(compact.data() + layout.addressTypes, block.data() + full.addressTypes, buffered);
+            if (options.keySlotSize) std::memcpy(compact.data() + layout.keySlots, block.data() + full.keySlots, buffered * options.keySlotSize);
+            data = compact;
+        }
+
+        const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        uint8_t checksum[ChecksumSize];
+        if (ok) CSHA256().Write(data.data(), data.size()).Finalize(checksum);
+        detail::Wipe(compact.data(), compact.size());
+        if (!ok) {
+            return IOError("Cannot write record file", path);
+        }
+        // Only a block that was written gets a checksum, so the table stays in step with the blocks.
+        checksums.insert(checksums.end(), std::begin(checksum), std::end(checksum));
+        count += buffered;
+        buffered = 0;
+        return {};
+    }
+};
+
+Writer::Writer(std::unique_ptr<State> state) : m_state(std::move(state)) {}
+Writer::Writer(Writer&& other) noexcept = default;
+Writer& Writer::operator=(Writer&& other) noexcept = default;
+Writer::~Writer() = default;
+
+std::expected<Writer, Error> Writer::Create(const std::string& path, Options options) {
+    if (auto checked = CheckOptions(options); !checked) {
+        return std::unexpected(checked.error());
+    }
+    const std::string tmpPath = path + ".tmp";
+    std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return IOError("Cannot create record file", tmpPath);
+    }
+    auto state = std::make_unique<State>(file, path, options);
+    const uint8_t header[HeaderSize] = {};
+    if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        return IOError("Cannot write record file", path);
+    }
+    return Writer(std::move(state));
+}
+
+std::expected<void, Error> Writer::Append(const Columns& records) {
+    State& s = *m_state;
+    if (!s.file) {
+        return std::unexpected(Error{ErrorCode::RecordFileIOFailed, "Record file already finished: " + s.path});
+    }
+    const size_t n = records.size();
+    if (records.hashes.size() != n * HashSize || records.pubKeys.size() != n * PubKeySize || records.keySlots.size() != n * s.options.keySlotSize) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Record columns disagree: " + std::to_string(n) + " address types, " +
+                                                                       std::to_string(records.hashes.size()) + " hash bytes, " + std::to_string(records.pubKeys.size()) +
+                                                                       " public key bytes, " + std::to_string(records.keySlots.size()) + " key slot bytes"});
+    }
+
+    const size_t slot = s.options.keySlotSize;
+    for (size_t done = 0; done < n;) {
+        const size_t k = std::min(n - done, s.options.blockRecords - s.buffered);
+        uint8_t* block = s.block.data();
+        std::memcpy(block + s.buffered * HashSize, records.hashes.data() + done * HashSize, k * HashSize);
+        std::memcpy(block + s.full.pubKeys + s.buffered * PubKeySize, records.pubKeys.data() + done * PubKeySize, k * PubKeySize);
+        std::memcpy(block + s.full.addressTypes + s.buffered, records.addressTypes.data() + done, k);
+        if (slot) std::memcpy(block + s.full.keySlots + s.buffered * slot, records.keySlots.data() + done * slot, k * slot);
+        s.buffered += k;
+        done += k;
+        if (s.buffered == s.options.blockRecords) {
+            if (auto flushed = s.Flush(); !flushed) {
+                return flushed;
+            }
+        }
+    }
+    return {};
+}
+
+std::expected<size_t, Error> Writer::Finish() {
+    State& s = *m_state;
+    if (!s.file) {
+        return std::unexpected(Error{ErrorCode::RecordFileIOFailed, "Record file already finished: " + s.path});
+    }
+    if (auto flushed = s.Flush(); !flushed) {
+        return std::unexpected(flushed.error());
+    }
+
+    const FileLayout layout = MakeLayout(s.count, s.options.keySlotSize, s.options.blockRecords);
+    uint8_t header[HeaderSize];
+    WriteHeader(header, layout);
+    const bool written = (s.checksums.empty() || std::fwrite(s.checksums.data(), 1, s.checksums.size(), s.file) == s.checksums.size()) &&
+                         std::fseek(s.file, 0, SEEK_SET) == 0 &&
+                         std::fwrite(header, 1, sizeof(header), s.file) == sizeof(header);
+    const bool ok = detail::CommitFile(s.file, written, s.tmpPath, s.path);
+    s.file = nullptr;
+    if (!ok) {
+        return IOError("Cannot write record file", s.path);
+    }
+    return s.count;
+}
+
+struct Reader::Mapping {
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+#ifdef RECORD_FILE_MMAP
+    ~Mapping() {
+        if (base) munmap(const_cast<uint8_t*>(base), size);
+    }
+#else
+    std::vector<uint8_t> storage;
+#endif
+
+    FileLayout layout;
+
+    BlockLayout BlockColumns(size_t i) const {
+        return BlockLayout(layout.BlockSize(i), layout.keySlotSize);
+    }
+
+    bool Matches(size_t i) const {
+        uint8_t checksum[ChecksumSize];
+        CSHA256().Write(base + layout.BlockOffset(i), BlockColumns(i).size).Finalize(checksum);
+        return std::memcmp(checksum, base + layout.checksumOffset + i * ChecksumSize, ChecksumSize) == 0;
+    }
+};
+
+Reader::Reader(std::unique_ptr<Mapping> mapping) : m_mapping(std::move(mapping)) {}
+Reader::Reader(Reader&& other) noexcept = default;
+Reader& Reader::operator=(Reader&& other) noexcept = default;
+Reader::~Reader() = default;
+
+std::expected<Reader, Error> Reader::Open(const std::string& path, bool verifyChecksums) {
+    auto mapping = std::make_unique<Mapping>();
+#ifdef RECORD_FILE_MMAP
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return IOError("Cannot open record file", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return IOError("Cannot stat record file", path);
+    }
+    mapping->size = static_cast<size_t>(st.st_size);
+    if (mapping->size >= HeaderSize) {
+        void* map = mmap(nullptr, mapping->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return IOError("Cannot map record file", path);
+        }
+        mapping->base = static_cast<const uint8_t*>(map);
+        // Records are usually consumed block after block.
+        madvise(map, mapping->size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return IOError("Cannot open record file", path);
+    }
+    mapping->storage.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    mapping->base = mapping->storage.data();
+    mapping->size = mapping->storage.size();
+#endif
+
+    const uint8_t* header = mapping->base;
+    if (mapping->size < HeaderSize || std::memcmp(header, Magic, sizeof(Magic)) != 0) {
+        return FormatError(path, "bad magic");
+    }
+    if (ReadLE32(header + 8) != Version) {
+        return FormatError(path, "unsupported version " + std::to_string(ReadLE32(header + 8)));
+    }
+    const Options options{ReadLE32(header + 12), ReadLE32(header + 16)};
+    if (!CheckOptions(options)) {
+        return FormatError(path, "key slot size or block records out of range");
+    }
+    const uint64_t count = ReadLE64(header + 24);
+    if (count > mapping->size / (HashSize + PubKeySize + 1)) {
+        return FormatError(path, "record count exceeds the file size");
+    }
+    const FileLayout layout = MakeLayout(count, options.keySlotSize, options.blockRecords);
+    if (ReadLE32(header + 20) != 0 || ReadLE64(header + 32) != layout.blockCount || ReadLE64(header + 40) != layout.blockStride ||
+        ReadLE64(header + 48) != layout.checksumOffset || ReadLE64(header + 56) != layout.fileSize) {
+        return FormatError(path, "header does not match the layout for its record count");
+    }
+    if (mapping->size < layout.fileSize) {
+        return FormatError(path, "truncated");
+    }
+    mapping->layout = layout;
+
+    Reader reader(std::move(mapping));
+    for (size_t i = 0; verifyChecksums && i < layout.blockCount; ++i) {
+        if (auto verified = reader.VerifyBlock(i); !verified) {
+            return std::unexpected(Error{verified.error().code, verified.error().message + ": " + path});
+        }
+    }
+    return reader;
+}
+
+size_t Reader::Size() const noexcept {
+    return m_mapping->layout.count;
+}
+
+size_t Reader::BlockCount() const noexcept {
+    return m_mapping->layout.blockCount;
+}
+
+Options Reader::FileOptions() const noexcept {
+    return {m_mapping->layout.keySlotSize, m_mapping->layout.blockRecords};
+}
+
+Columns Reader::Block(size_t i) const noexcept {
+    const Mapping& m = *m_mapping;
+    const BlockLayout columns = m.BlockColumns(i);
+    const uint8_t* block = m.base + m.layout.BlockOffset(i);
+    const size_t n = columns.records;
+    return {{block, n * HashSize},
+            {block + columns.pubKeys, n * PubKeySize},
+            {block + columns.addressTypes, n},
+            {block + columns.keySlots, n * m.layout.keySlotSize}};
+}
+
+std::expected<void, Error> Reader::VerifyBlock(size_t i) const {
+    if (i >= m_mapping->layout.blockCount) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Record file block " + std::to_string(i) + " out of range: " + std::to_string(m_mapping->layout.blockCount) + " blocks"});
+    }
+    if (!m_mapping->Matches(i)) {
+        return std::unexpected(Error{ErrorCode::RecordFileChecksumMismatch, "Record file block " + std::to_string(i) + " does not match its checksum"});
+    }
+    return {};
+}
+
+}
@@ -0,0 +1,150 @@
+// Multi-buffer RIPEMD-160 of 8 independent 32-byte messages (e.g. the
+// SHA-256 digests hashed by Hash160), one message per 32-bit SIMD lane.
+// A 32-byte message always pads into a single block, so the padding words
+// are constants.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/common.h>
+
+#include <stdint.h>
+#include <immintrin.h>
+#include <utility>
+
+namespace ripemd160_multi_avx2 {
+namespace {
+
+/** Message word selection and rotation amounts for the left and right lines, 5 rounds of 16 steps. */
+constexpr int RL[80] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+    3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+    1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+    4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13};
+constexpr int RR[80] = {
+    5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+    6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+    15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+    8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+    12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11};
+constexpr int SL[80] = {
+    11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+    7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+    11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+    11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+    9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6};
+constexpr int SR[80] = {
+    8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+    9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+    9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+    15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+    8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11};
+constexpr uint32_t KL[5] = {0, 0x5A827999ul, 0x6ED9EBA1ul, 0x8F1BBCDCul, 0xA953FD4Eul};
+constexpr uint32_t KR[5] = {0x50A28BE6ul, 0x5C4DD124ul, 0x6D703EF3ul, 0x7A6D76E9ul, 0};
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline AndNot(__m256i x, __m256i y) { return _mm256_andnot_si256(x, y); } // ~x & y
+__m256i inline Not(__m256i x) { return Xor(x, _mm256_set1_epi32(-1)); }
+template <int n>
+__m256i inline Rol(__m256i x) { return Or(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+template <int round>
+__m256i inline F(__m256i x, __m256i y, __m256i z)
+{
+    if constexpr (round == 0) return Xor(Xor(x, y), z);
+    if constexpr (round == 1) return Or(And(x, y), AndNot(x, z));
+    if constexpr (round == 2) return Xor(Or(x, Not(y)), z);
+    if constexpr (round == 3) return Or(And(x, z), AndNot(z, y));
+    if constexpr (round == 4) return Xor(x, Or(y, Not(z)));
+}
+
+/** One step of the left or right line. The right line applies the boolean functions in reverse order. */
+template <bool right, int j>
+void inline Step(__m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i& e, const __m256i* w)
+{
+    constexpr int round = j / 16;
+    constexpr int r = right ? RR[j] : RL[j];
+    constexpr int s = right ? SR[j] : SL[j];
+    constexpr uint32_t k = right ? KR[round] : KL[round];
+    const __m256i f = F<right ? 4 - round : round>(b, c, d);
+    const __m256i t = Add(Rol<s>(Add(Add(a, f), Add(w[r], _mm256_set1_epi32(k)))), e);
+    a = e;
+    e = d;
+    d = Rol<10>(c);
+    c = b;
+    b = t;
+}
+
+/** Run all 80 steps of one line. */
+template <bool right, int... j>
+void inline Line(__m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i& e, const __m256i* w, std::integer_sequence<int, j...>)
+{
+    (Step<right, j>(a, b, c, d, e, w), ...);
+}
+
+/** Load the 8 little-endian words of each lane and transpose them into 8 word vectors. */
+void inline Load8(__m256i* w, const unsigned char* in)
+{
+    __m256i r[8];
+    for (int lane = 0; lane < 8; ++lane) r[lane] = _mm256_loadu_si256((const __m256i*)(in + 32 * lane));
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    w[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    w[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    w[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    w[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    w[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    w[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    w[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    w[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+} // namespace
+
+void Transform_8way(unsigned char* out, const unsigned char* in)
+{
+    // Words 8..15 are the padding of a 32-byte message: 0x80, zeroes, then the 256-bit length.
+    __m256i w[16];
+    Load8(w, in);
+    w[8] = _mm256_set1_epi32(0x80);
+    for (int i = 9; i < 16; ++i) w[i] = _mm256_setzero_si256();
+    w[14] = _mm256_set1_epi32(256);
+
+    const __m256i h0 = _mm256_set1_epi32(0x67452301ul), h1 = _mm256_set1_epi32(0xEFCDAB89ul), h2 = _mm256_set1_epi32(0x98BADCFEul);
+    const __m256i h3 = _mm256_set1_epi32(0x10325476ul), h4 = _mm256_set1_epi32(0xC3D2E1F0ul);
+    __m256i a1 = h0, b1 = h1, c1 = h2, d1 = h3, e1 = h4;
+    __m256i a2 = h0, b2 = h1, c2 = h2, d2 = h3, e2 = h4;
+    Line<false>(a1, b1, c1, d1, e1, w, std::make_integer_sequence<int, 80>{});
+    Line<true>(a2, b2, c2, d2, e2, w, std::make_integer_sequence<int, 80>{});
+
+    alignas(32) uint32_t res[5][8];
+    _mm256_store_si256((__m256i*)res[0], Add(Add(h1, c1), d2));
+    _mm256_store_si256((__m256i*)res[1], Add(Add(h2, d1), e2));
+    _mm256_store_si256((__m256i*)res[2], Add(Add(h3, e1), a2));
+    _mm256_store_si256((__m256i*)res[3], Add(Add(h4, a1), b2));
+    _mm256_store_si256((__m256i*)res[4], Add(Add(h0, b1), c2));
+    for (int lane = 0; lane < 8; ++lane) {
+        for (int i = 0; i < 5; ++i) WriteLE32(out + 20 * lane + 4 * i, res[i][lane]);
+    }
+}
+
+} // namespace ripemd160_multi_avx2
+
+#endif
@@ -0,0 +1,137 @@
+// Multi-buffer RIPEMD-160 of 4 independent 32-byte messages (e.g. the
+// SHA-256 digests hashed by Hash160), one message per 32-bit SIMD lane.
+// A 32-byte message always pads into a single block, so the padding words
+// are constants.
+
+#ifdef ENABLE_SSE41
+
+#include <crypto/common.h>
+
+#include <stdint.h>
+#include <immintrin.h>
+#include <utility>
+
+namespace ripemd160_multi_sse41 {
+namespace {
+
+/** Message word selection and rotation amounts for the left and right lines, 5 rounds of 16 steps. */
+constexpr int RL[80] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+    3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+    1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+    4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13};
+constexpr int RR[80] = {
+    5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+    6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+    15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+    8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+    12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11};
+constexpr int SL[80] = {
+    11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+    7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+    11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+    11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+    9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6};
+constexpr int SR[80] = {
+    8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+    9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+    9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+    15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+    8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11};
+constexpr uint32_t KL[5] = {0, 0x5A827999ul, 0x6ED9EBA1ul, 0x8F1BBCDCul, 0xA953FD4Eul};
+constexpr uint32_t KR[5] = {0x50A28BE6ul, 0x5C4DD124ul, 0x6D703EF3ul, 0x7A6D76E9ul, 0};
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline AndNot(__m128i x, __m128i y) { return _mm_andnot_si128(x, y); } // ~x & y
+__m128i inline Not(__m128i x) { return Xor(x, _mm_set1_epi32(-1)); }
+template <int n>
+__m128i inline Rol(__m128i x) { return Or(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+
+template <int round>
+__m128i inline F(__m128i x, __m128i y, __m128i z)
+{
+    if constexpr (round == 0) return Xor(Xor(x, y), z);
+    if constexpr (round == 1) return Or(And(x, y), AndNot(x, z));
+    if constexpr (round == 2) return Xor(Or(x, Not(y)), z);
+    if constexpr (round == 3) return Or(And(x, z), AndNot(z, y));
+    if constexpr (round == 4) return Xor(x, Or(y, Not(z)));
+}
+
+/** One step of the left or right line. The right line applies the boolean functions in reverse order. */
+template <bool right, int j>
+void inline Step(__m128i& a, __m128i& b, __m128i& c, __m128i& d, __m128i& e, const __m128i* w)
+{
+    constexpr int round = j / 16;
+    constexpr int r = right ? RR[j] : RL[j];
+    constexpr int s = right ? SR[j] : SL[j];
+    constexpr uint32_t k = right ? KR[round] : KL[round];
+    const __m128i f = F<right ? 4 - round : round>(b, c, d);
+    const __m128i t = Add(Rol<s>(Add(Add(a, f), Add(w[r], _mm_set1_epi32(k)))), e);
+    a = e;
+    e = d;
+    d = Rol<10>(c);
+    c = b;
+    b = t;
+}
+
+/** Run all 80 steps of one line. */
+template <bool right, int... j>
+void inline Line(__m128i& a, __m128i& b, __m128i& c, __m128i& d, __m128i& e, const __m128i* w, std::integer_sequence<int, j...>)
+{
+    (Step<right, j>(a, b, c, d, e, w), ...);
+}
+
+/** Load 4 little-endian words from each lane and transpose them into 4 word vectors. */
+void inline Load4(__m128i* w, const unsigned char* in, int offset)
+{
+    const __m128i l0 = _mm_loadu_si128((const __m128i*)(in + 0 * 32 + offset));
+    const __m128i l1 = _mm_loadu_si128((const __m128i*)(in + 1 * 32 + offset));
+    const __m128i l2 = _mm_loadu_si128((const __m128i*)(in + 2 * 32 + offset));
+    const __m128i l3 = _mm_loadu_si128((const __m128i*)(in + 3 * 32 + offset));
+    const __m128i t0 = _mm_unpacklo_epi32(l0, l1);
+    const __m128i t1 = _mm_unpackhi_epi32(l0, l1);
+    const __m128i t2 = _mm_unpacklo_epi32(l2, l3);
+    const __m128i t3 = _mm_unpackhi_epi32(l2, l3);
+    w[0] = _mm_unpacklo_epi64(t0, t2);
+    w[1] = _mm_unpackhi_epi64(t0, t2);
+    w[2] = _mm_unpacklo_epi64(t1, t3);
+    w[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+} // namespace
+
+void Transform_4way(unsigned char* out, const unsigned char* in)
+{
+    // Words 8..15 are the padding of a 32-byte message: 0x80, zeroes, then the 256-bit length.
+    __m128i w[16];
+    Load4(w + 0, in, 0);
+    Load4(w + 4, in, 16);
+    w[8] = _mm_set1_epi32(0x80);
+    for (int i = 9; i < 16; ++i) w[i] = _mm_setzero_si128();
+    w[14] = _mm_set1_epi32(256);
+
+    const __m128i h0 = _mm_set1_epi32(0x67452301ul), h1 = _mm_set1_epi32(0xEFCDAB89ul), h2 = _mm_set1_epi32(0x98BADCFEul);
+    const __m128i h3 = _mm_set1_epi32(0x10325476ul), h4 = _mm_set1_epi32(0xC3D2E1F0ul);
+    __m128i a1 = h0, b1 = h1, c1 = h2, d1 = h3, e1 = h4;
+    __m128i a2 = h0, b2 = h1, c2 = h2, d2 = h3, e2 = h4;
+    Line<false>(a1, b1, c1, d1, e1, w, std::make_integer_sequence<int, 80>{});
+    Line<true>(a2, b2, c2, d2, e2, w, std::make_integer_sequence<int, 80>{});
+
+    alignas(16) uint32_t res[5][4];
+    _mm_store_si128((__m128i*)res[0], Add(Add(h1, c1), d2));
+    _mm_store_si128((__m128i*)res[1], Add(Add(h2, d1), e2));
+    _mm_store_si128((__m128i*)res[2], Add(Add(h3, e1), a2));
+    _mm_store_si128((__m128i*)res[3], Add(Add(h4, a1), b2));
+    _mm_store_si128((__m128i*)res[4], Add(Add(h0, b1), c2));
+    for (int lane = 0; lane < 4; ++lane) {
+        for (int i = 0; i < 5; ++i) WriteLE32(out + 20 * lane + 4 * i, res[i][lane]);
+    }
+}
+
+} // namespace ripemd160_multi_sse41
+
+#endif
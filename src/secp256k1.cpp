@@ -0,0 +1,422 @@
+#include "secp256k1.h"
+
+#include "batch_internal.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace BitcoinKeyUtils::detail::secp256k1 {
+
+namespace {
+
+using u128 = unsigned __int128;
+
+// Field element mod p = 2^256 - 2^32 - 977 as four little-endian 64-bit limbs. Arithmetic keeps
+// values below 2^256 but not necessarily below p; Normalize makes them canonical.
+struct Fe {
+    uint64_t n[4];
+};
+
+// 2^256 mod p: a carry out of the top limb is folded back in as a multiple of this.
+constexpr uint64_t R = 0x1000003D1;
+
+constexpr Fe One = {{1, 0, 0, 0}};
+
+// Add carry * 2^256 to r, for carry < 2^34.
+inline void Fold(Fe& r, uint64_t carry) {
+    u128 c = u128{carry} * R;
+    for (int i = 0; i < 4; ++i) {
+        c += r.n[i];
+        r.n[i] = static_cast<uint64_t>(c);
+        c >>= 64;
+    }
+    // If that carried out again, r is now below carry * R and adding R once more cannot.
+    c = u128{static_cast<uint64_t>(c)} * R;
+    for (int i = 0; i < 4; ++i) {
+        c += r.n[i];
+        r.n[i] = static_cast<uint64_t>(c);
+        c >>= 64;
+    }
+}
+
+// Subtract borrow * R from r and return the new borrow; a borrow stands for 2^256, i.e. R too little.
+inline uint64_t Unfold(Fe& r, uint64_t borrow) {
+    u128 d = u128{r.n[0]} - borrow * R;
+    r.n[0] = static_cast<uint64_t>(d);
+    for (int i = 1; i < 4; ++i) {
+        d = u128{r.n[i]} - static_cast<uint64_t>(d >> 64 & 1);
+        r.n[i] = static_cast<uint64_t>(d);
+    }
+    return static_cast<uint64_t>(d >> 64 & 1);
+}
+
+inline Fe Add(const Fe& a, const Fe& b) {
+    Fe r;
+    u128 c = 0;
+    for (int i = 0; i < 4; ++i) {
+        c += u128{a.n[i]} + b.n[i];
+        r.n[i] = static_cast<uint64_t>(c);
+        c >>= 64;
+    }
+    Fold(r, static_cast<uint64_t>(c));
+    return r;
+}
+
+inline Fe Sub(const Fe& a, const Fe& b) {
+    Fe r;
+    uint64_t borrow = 0;
+    for (int i = 0; i < 4; ++i) {
+        const u128 d = u128{a.n[i]} - b.n[i] - borrow;
+        r.n[i] = static_cast<uint64_t>(d);
+        borrow = static_cast<uint64_t>(d >> 64 & 1);
+    }
+    Unfold(r, Unfold(r, borrow));
+    return r;
+}
+
+// Reduce a 512-bit product t below 2^256: its upper half times 2^256 is congruent to it times R.
+inline Fe Reduce(const uint64_t* t) {
+    Fe r;
+    u128 c = 0;
+    for (int i = 0; i < 4; ++i) {
+        c += u128{t[4 + i]} * R + t[i];
+        r.n[i] = static_cast<uint64_t>(c);
+        c >>= 64;
+    }
+    Fold(r, static_cast<uint64_t>(c));
+    return r;
+}
+
+// Column sums of a product accumulate in three words (c0, c1, c2), so each column's carries are
+// resolved once rather than after every limb product.
+struct Accumulator {
+    uint64_t c0 = 0, c1 = 0, c2 = 0;
+
+    inline void MulAdd(uint64_t a, uint64_t b) {
+        const u128 t = u128{a} * b;
+        const uint64_t lo = static_cast<uint64_t>(t);
+        uint64_t hi = static_cast<uint64_t>(t >> 64);
+        c0 += lo;
+        hi += c0 < lo;
+        c1 += hi;
+        c2 += c1 < hi;
+    }
+
+    // Adds 2ab, for the cross terms of a square.
+    inline void MulAdd2(uint64_t a, uint64_t b) {
+        MulAdd(a, b);
+        MulAdd(a, b);
+    }
+
+    inline uint64_t Extract() {
+        const uint64_t r = c0;
+        c0 = c1;
+        c1 = c2;
+        c2 = 0;
+        return r;
+    }
+};
+
+inline Fe Mul(const Fe& a, const Fe& b) {
+    uint64_t t[8];
+    Accumulator acc;
+    acc.MulAdd(a.n[0], b.n[0]);
+    t[0] = acc.Extract();
+    acc.MulAdd(a.n[0], b.n[1]);
+    acc.MulAdd(a.n[1], b.n[0]);
+    t[1] = acc.Extract();
+    acc.MulAdd(a.n[0], b.n[2]);
+    acc.MulAdd(a.n[1], b.n[1]);
+    acc.MulAdd(a.n[2], b.n[0]);
+    t[2] = acc.Extract();
+    acc.MulAdd(a.n[0], b.n[3]);
+    acc.MulAdd(a.n[1], b.n[2]);
+    acc.MulAdd(a.n[2], b.n[1]);
+    acc.MulAdd(a.n[3], b.n[0]);
+    t[3] = acc.Extract();
+    acc.MulAdd(a.n[1], b.n[3]);
+    acc.MulAdd(a.n[2], b.n[2]);
+    acc.MulAdd(a.n[3], b.n[1]);
+    t[4] = acc.Extract();
+    acc.MulAdd(a.n[2], b.n[3]);
+    acc.MulAdd(a.n[3], b.n[2]);
+    t[5] = acc.Extract();
+    acc.MulAdd(a.n[3], b.n[3]);
+    t[6] = acc.Extract();
+    t[7] = acc.c0;
+    return Reduce(t);
+}
+
+inline Fe Sqr(const Fe& a) {
+    uint64_t t[8];
+    Accumulator acc;
+    acc.MulAdd(a.n[0], a.n[0]);
+    t[0] = acc.Extract();
+    acc.MulAdd2(a.n[0], a.n[1]);
+    t[1] = acc.Extract();
+    acc.MulAdd2(a.n[0], a.n[2]);
+    acc.MulAdd(a.n[1], a.n[1]);
+    t[2] = acc.Extract();
+    acc.MulAdd2(a.n[0], a.n[3]);
+    acc.MulAdd2(a.n[1], a.n[2]);
+    t[3] = acc.Extract();
+    acc.MulAdd2(a.n[1], a.n[3]);
+    acc.MulAdd(a.n[2], a.n[2]);
+    t[4] = acc.Extract();
+    acc.MulAdd2(a.n[2], a.n[3]);
+    t[5] = acc.Extract();
+    acc.MulAdd(a.n[3], a.n[3]);
+    t[6] = acc.Extract();
+    t[7] = acc.c0;
+    return Reduce(t);
+}
+
+inline Fe SqrN(Fe a, int n) {
+    while (n-- > 0) a = Sqr(a);
+    return a;
+}
+
+// a^(p-2) = 1/a, using libsecp256k1's addition chain for p-2: x_k is a^(2^k - 1), a run of k ones.
+Fe Inv(const Fe& a) {
+    const Fe x2 = Mul(Sqr(a), a);
+    const Fe x3 = Mul(Sqr(x2), a);
+    const Fe x6 = Mul(SqrN(x3, 3), x3);
+    const Fe x9 = Mul(SqrN(x6, 3), x3);
+    const Fe x11 = Mul(SqrN(x9, 2), x2);
+    const Fe x22 = Mul(SqrN(x11, 11), x11);
+    const Fe x44 = Mul(SqrN(x22, 22), x22);
+    const Fe x88 = Mul(SqrN(x44, 44), x44);
+    const Fe x176 = Mul(SqrN(x88, 88), x88);
+    const Fe x220 = Mul(SqrN(x176, 44), x44);
+    const Fe x223 = Mul(SqrN(x220, 3), x3);
+    // The low 33 bits of p-2 are 0, 22 ones, then 0000101101.
+    Fe t = Mul(SqrN(x223, 23), x22);
+    t = Mul(SqrN(t, 5), a);
+    t = Mul(SqrN(t, 3), x2);
+    return Mul(SqrN(t, 2), a);
+}
+
+// The canonical representative: a is below 2^256 < 2p, and a >= p exactly when a + R carries out.
+inline Fe Normalize(const Fe& a) {
+    Fe s, r;
+    u128 c = R;
+    for (int i = 0; i < 4; ++i) {
+        c += a.n[i];
+        s.n[i] = static_cast<uint64_t>(c);
+        c >>= 64;
+    }
+    const uint64_t mask = 0 - static_cast<uint64_t>(c);
+    for (int i = 0; i < 4; ++i) r.n[i] = (s.n[i] & mask) | (a.n[i] & ~mask);
+    return r;
+}
+
+inline void StoreBigEndian(const Fe& a, uint8_t* out) {
+    for (int i = 0; i < 32; ++i) out[i] = static_cast<uint8_t>(a.n[3 - i / 8] >> (56 - 8 * (i % 8)));
+}
+
+struct Affine {
+    Fe x, y;
+};
+
+struct Jacobian {
+    Fe x, y, z;  // (x / z^2, y / z^3)
+};
+
+// r = mask ? a : r, for a mask of all ones or all zeroes.
+template <typename T>
+inline void CMov(T& r, const T& a, uint64_t mask) {
+    static_assert(sizeof(T) % sizeof(uint64_t) == 0);
+    auto* dst = reinterpret_cast<uint64_t*>(&r);
+    const auto* src = reinterpret_cast<const uint64_t*>(&a);
+    for (size_t i = 0; i < sizeof(T) / sizeof(uint64_t); ++i) dst[i] = (src[i] & mask) | (dst[i] & ~mask);
+}
+
+// a + b with b affine (madd-2007-bl). The formula is incomplete: a must not be infinity, b or -b.
+inline Jacobian AddMixed(const Jacobian& a, const Affine& b) {
+    const Fe z1z1 = Sqr(a.z);
+    const Fe u2 = Mul(b.x, z1z1);
+    const Fe s2 = Mul(Mul(b.y, a.z), z1z1);
+    const Fe h = Sub(u2, a.x);
+    const Fe hh = Sqr(h);
+    const Fe hh2 = Add(hh, hh);
+    const Fe i = Add(hh2, hh2);
+    const Fe j = Mul(h, i);
+    const Fe s = Sub(s2, a.y);
+    const Fe r = Add(s, s);
+    const Fe v = Mul(a.x, i);
+    Jacobian out;
+    out.x = Sub(Sub(Sqr(r), j), Add(v, v));
+    const Fe y1j = Mul(a.y, j);
+    out.y = Sub(Mul(r, Sub(v, out.x)), Add(y1j, y1j));
+    const Fe zh = Mul(a.z, h);
+    out.z = Add(zh, zh);
+    return out;
+}
+
+// 2a (dbl-2009-l, for a curve with a = 0).
+Jacobian Double(const Jacobian& a) {
+    const Fe xx = Sqr(a.x);
+    const Fe yy = Sqr(a.y);
+    const Fe yyyy = Sqr(yy);
+    const Fe d1 = Sub(Sub(Sqr(Add(a.x, yy)), xx), yyyy);
+    const Fe d = Add(d1, d1);
+    const Fe e = Add(Add(xx, xx), xx);
+    Jacobian out;
+    out.x = Sub(Sqr(e), Add(d, d));
+    const Fe y2 = Add(yyyy, yyyy);
+    const Fe y4 = Add(y2, y2);
+    out.y = Sub(Mul(e, Sub(d, out.x)), Add(y4, y4));
+    const Fe yz = Mul(a.y, a.z);
+    out.z = Add(yz, yz);
+    return out;
+}
+
+// Montgomery's trick: the z coordinates of all n points are inverted with one field inversion and
+// 3(n-1) multiplications. prefix holds n elements of scratch.
+void ToAffine(const Jacobian* in, Affine* out, size_t n, Fe* prefix) {
+    prefix[0] = in[0].z;
+    for (size_t i = 1; i < n; ++i) prefix[i] = Mul(prefix[i - 1], in[i].z);
+    Fe inv = Inv(prefix[n - 1]);
+    for (size_t i = n; i-- > 0;) {
+        Fe zinv = inv;
+        if (i > 0) {
+            zinv = Mul(inv, prefix[i - 1]);
+            inv = Mul(inv, in[i].z);
+        }
+        const Fe zinv2 = Sqr(zinv);
+        out[i].x = Mul(in[i].x, zinv2);
+        out[i].y = Mul(in[i].y, Mul(zinv2, zinv));
+    }
+}
+
+constexpr Affine G = {
+    {{0x59F2815B16F81798, 0x029BFCDB2DCE28D9, 0x55A06295CE870B07, 0x79BE667EF9DCBBAC}},
+    {{0x9C47D08FFB10D4B8, 0xFD17B448A6855419, 0x5DA4FBFC0E1108A8, 0x483ADA7726A3C465}},
+};
+
+// Group order n, little-endian limbs.
+constexpr uint64_t Order[4] = {0xBFD25E8CD0364141, 0xBAAEDCE6AF48A03B, 0xFFFFFFFFFFFFFFFE, 0xFFFFFFFFFFFFFFFF};
+
+// Row i holds d * 16^i * G for d = 1..15 in affine coordinates (61,440 bytes). A scalar's 64
+// nibbles pick one entry per row and k*G is their sum: 64 mixed additions and no doublings.
+constexpr int Rows = 64;
+constexpr int RowEntries = 15;
+
+struct GeneratorTable {
+    Affine points[Rows][RowEntries];
+
+    GeneratorTable() {
+        std::vector<Jacobian> multiples(Rows * RowEntries);
+        Affine base = G;
+        for (int row = 0; row < Rows; ++row) {
+            Jacobian* entries = &multiples[row * RowEntries];
+            entries[0] = {base.x, base.y, One};
+            entries[1] = Double(entries[0]);
+            for (int d = 2; d < RowEntries; ++d) entries[d] = AddMixed(entries[d - 1], base);
+            // The next row's base is 16 * base = 2 * (8 * base).
+            const Jacobian next = Double(entries[7]);
+            Fe scratch;
+            ToAffine(&next, &base, 1, &scratch);
+        }
+        std::vector<Fe> prefix(Rows * RowEntries);
+        ToAffine(multiples.data(), &points[0][0], Rows * RowEntries, prefix.data());
+    }
+};
+
+const GeneratorTable& Table() {
+    static const GeneratorTable table;
+    return table;
+}
+
+// The entry of a row for digit d, reading every entry so the memory access pattern does not depend
+// on d. Digit 0 has no entry; it reads digit 1's and the caller discards the sum.
+inline Affine Lookup(const Affine* row, unsigned digit) {
+    const unsigned index = digit - 1 + (digit == 0);
+    Affine r{};
+    for (unsigned j = 0; j < RowEntries; ++j) {
+        const uint64_t mask = 0 - static_cast<uint64_t>(j == index);
+        for (int l = 0; l < 4; ++l) {
+            r.x.n[l] |= row[j].x.n[l] & mask;
+            r.y.n[l] |= row[j].y.n[l] & mask;
+        }
+    }
+    return r;
+}
+
+// k*G for a scalar in [1, n-1] given as little-endian limbs.
+Jacobian MultiplyGenerator(const GeneratorTable& table, const uint64_t* k) {
+    Jacobian r{};
+    uint64_t infinity = ~uint64_t{0};
+    for (int row = 0; row < Rows; ++row) {
+        const unsigned digit = (k[row / 16] >> (4 * (row % 16))) & 15;
+        const Affine p = Lookup(table.points[row], digit);
+        Jacobian sum = AddMixed(r, p);
+        // While r is still the point at infinity the sum is p itself.
+        CMov(sum, Jacobian{p.x, p.y, One}, infinity);
+        const uint64_t nonzero = 0 - static_cast<uint64_t>(digit != 0);
+        CMov(r, sum, nonzero);
+        infinity &= ~nonzero;
+    }
+    return r;
+}
+
+// Read a 32-byte big-endian scalar into little-endian limbs; return whether it lies in [1, n-1].
+bool LoadScalar(const uint8_t* bytes, uint64_t* k) {
+    for (int i = 0; i < 4; ++i) {
+        uint64_t limb = 0;
+        for (int j = 0; j < 8; ++j) limb = limb << 8 | bytes[8 * i + j];
+        k[3 - i] = limb;
+    }
+    uint64_t borrow = 0;
+    uint64_t any = 0;
+    for (int i = 0; i < 4; ++i) {
+        const u128 d = u128{k[i]} - Order[i] - borrow;
+        borrow = static_cast<uint64_t>(d >> 64 & 1);
+        any |= k[i];
+    }
+    return borrow != 0 && any != 0;
+}
+
+}
+
+void DerivePublicKeys(const uint8_t* privateKeys, size_t count, bool compressed, uint8_t* out, bool* valid) {
+    if (count == 0) return;
+    const GeneratorTable& table = Table();
+    Jacobian points[DeriveTile];
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t k[4];
+        valid[i] = LoadScalar(privateKeys + 32 * i, k);
+        // An invalid key is replaced by 1 so its point is finite and the shared inversion still works.
+        if (!valid[i]) {
+            detail::Wipe(k, sizeof(k));
+            k[0] = 1;
+        }
+        points[i] = MultiplyGenerator(table, k);
+        detail::Wipe(k, sizeof(k));
+    }
+
+    Affine affine[DeriveTile];
+    Fe prefix[DeriveTile];
+    ToAffine(points, affine, count, prefix);
+
+    const size_t stride = compressed ? 33 : 65;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t* pub = out + i * stride;
+        if (!valid[i]) {
+            std::fill_n(pub, stride, 0);
+            continue;
+        }
+        const Fe x = Normalize(affine[i].x);
+        const Fe y = Normalize(affine[i].y);
+        if (compressed) {
+            pub[0] = static_cast<uint8_t>(0x02 | (y.n[0] & 1));
+            StoreBigEndian(x, pub + 1);
+        } else {
+            pub[0] = 0x04;
+            StoreBigEndian(x, pub + 1);
+            StoreBigEndian(y, pub + 33);
+        }
+    }
+}
+
+}
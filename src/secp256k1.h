@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-base scalar multiplication on secp256k1, used to derive public keys from private keys.
+namespace BitcoinKeyUtils::detail::secp256k1 {
+
+// Keys converted to affine coordinates with one shared field inversion.
+inline constexpr size_t DeriveTile = 64;
+
+// Derive the SEC1 public keys of count <= DeriveTile private keys (32 bytes each, big-endian, back
+// to back) into out (33 or 65 bytes each, by `compressed`). valid[i] is set to whether key i lies
+// in [1, n-1]; the output of an invalid key is zeroed. The work done for a key does not depend on
+// its value: table lookups scan a whole row and digits of zero are skipped with masks, not branches.
+void DerivePublicKeys(const uint8_t* privateKeys, size_t count, bool compressed, uint8_t* out, bool* valid);
+
+}
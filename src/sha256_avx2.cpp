@@ -0,0 +1,152 @@
+// Double-SHA256 of 8 independent 64-byte messages (the inner nodes of a
+// Merkle tree), one message per 32-bit SIMD lane.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/common.h>
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256d64_avx2 {
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline ShR(__m256i x, int n) { return _mm256_srli_epi32(x, n); }
+__m256i inline ShL(__m256i x, int n) { return _mm256_slli_epi32(x, n); }
+__m256i inline Ror(__m256i x, int n) { return Or(ShR(x, n), ShL(x, 32 - n)); }
+
+__m256i inline Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__m256i inline Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m256i inline Sigma0(__m256i x) { return Xor(Ror(x, 2), Ror(x, 13), Ror(x, 22)); }
+__m256i inline Sigma1(__m256i x) { return Xor(Ror(x, 6), Ror(x, 11), Ror(x, 25)); }
+__m256i inline sigma0(__m256i x) { return Xor(Ror(x, 7), Ror(x, 18), ShR(x, 3)); }
+__m256i inline sigma1(__m256i x) { return Xor(Ror(x, 17), Ror(x, 19), ShR(x, 10)); }
+
+/** Load 8 big-endian words from each of the 8 consecutive 64-byte messages and transpose them. */
+void inline Load8(__m256i* w, const unsigned char* in, int offset)
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i r[8];
+    for (int lane = 0; lane < 8; ++lane) {
+        r[lane] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + 64 * lane + offset)), bswap);
+    }
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    w[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    w[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    w[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    w[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    w[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    w[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    w[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    w[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+
+/** 64 rounds over message w (consumed as the schedule buffer), added into s. */
+void inline Compress(__m256i* s, __m256i* w)
+{
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            w[i & 15] = Add(Add(sigma1(w[(i - 2) & 15]), w[(i - 7) & 15]), sigma0(w[(i - 15) & 15]), w[i & 15]);
+        }
+        const __m256i t1 = Add(Add(h, Sigma1(e)), Add(Ch(e, f, g), _mm256_set1_epi32(K[i])), w[i & 15]);
+        const __m256i t2 = Add(Sigma0(a), Maj(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+    s[0] = Add(s[0], a);
+    s[1] = Add(s[1], b);
+    s[2] = Add(s[2], c);
+    s[3] = Add(s[3], d);
+    s[4] = Add(s[4], e);
+    s[5] = Add(s[5], f);
+    s[6] = Add(s[6], g);
+    s[7] = Add(s[7], h);
+}
+
+void inline Initialize(__m256i* s)
+{
+    s[0] = _mm256_set1_epi32(0x6a09e667ul);
+    s[1] = _mm256_set1_epi32(0xbb67ae85ul);
+    s[2] = _mm256_set1_epi32(0x3c6ef372ul);
+    s[3] = _mm256_set1_epi32(0xa54ff53aul);
+    s[4] = _mm256_set1_epi32(0x510e527ful);
+    s[5] = _mm256_set1_epi32(0x9b05688cul);
+    s[6] = _mm256_set1_epi32(0x1f83d9abul);
+    s[7] = _mm256_set1_epi32(0x5be0cd19ul);
+}
+
+} // namespace
+
+void Transform_8way(unsigned char* out, const unsigned char* in)
+{
+    __m256i s[8], w[16];
+
+    // First hash: the message, then the padding block of a 64-byte message.
+    Initialize(s);
+    Load8(w + 0, in, 0);
+    Load8(w + 8, in, 32);
+    Compress(s, w);
+    w[0] = _mm256_set1_epi32(0x80000000ul);
+    for (int i = 1; i < 15; ++i) w[i] = _mm256_setzero_si256();
+    w[15] = _mm256_set1_epi32(0x200);
+    Compress(s, w);
+
+    // Second hash: the 32-byte digest and its padding, in one block.
+    for (int i = 0; i < 8; ++i) w[i] = s[i];
+    w[8] = _mm256_set1_epi32(0x80000000ul);
+    for (int i = 9; i < 15; ++i) w[i] = _mm256_setzero_si256();
+    w[15] = _mm256_set1_epi32(0x100);
+    Initialize(s);
+    Compress(s, w);
+
+    alignas(32) uint32_t res[8][8];
+    for (int i = 0; i < 8; ++i) _mm256_store_si256((__m256i*)res[i], s[i]);
+    for (int lane = 0; lane < 8; ++lane) {
+        for (int i = 0; i < 8; ++i) WriteBE32(out + 32 * lane + 4 * i, res[i][lane]);
+    }
+}
+
+} // namespace sha256d64_avx2
+
+#endif
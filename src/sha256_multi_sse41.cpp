@@ -0,0 +1,106 @@
+// Multi-buffer SHA-256 compression: one 64-byte block for each of 4
+// independent messages, one message per 32-bit SIMD lane.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace sha256_multi_sse41 {
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z) { return Add(Add(x, y), z); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline ShR(__m128i x, int n) { return _mm_srli_epi32(x, n); }
+__m128i inline ShL(__m128i x, int n) { return _mm_slli_epi32(x, n); }
+__m128i inline Ror(__m128i x, int n) { return Or(ShR(x, n), ShL(x, 32 - n)); }
+
+__m128i inline Ch(__m128i x, __m128i y, __m128i z) { return Xor(z, And(x, Xor(y, z))); }
+__m128i inline Maj(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m128i inline Sigma0(__m128i x) { return Xor(Ror(x, 2), Ror(x, 13), Ror(x, 22)); }
+__m128i inline Sigma1(__m128i x) { return Xor(Ror(x, 6), Ror(x, 11), Ror(x, 25)); }
+__m128i inline sigma0(__m128i x) { return Xor(Ror(x, 7), Ror(x, 18), ShR(x, 3)); }
+__m128i inline sigma1(__m128i x) { return Xor(Ror(x, 17), Ror(x, 19), ShR(x, 10)); }
+
+/** Load 4 big-endian words from each lane's block and transpose them into 4 word vectors. */
+void inline Load4(__m128i* w, const unsigned char* const* blocks, int offset)
+{
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i l0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks[0] + offset)), bswap);
+    __m128i l1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks[1] + offset)), bswap);
+    __m128i l2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks[2] + offset)), bswap);
+    __m128i l3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks[3] + offset)), bswap);
+    __m128i t0 = _mm_unpacklo_epi32(l0, l1);
+    __m128i t1 = _mm_unpackhi_epi32(l0, l1);
+    __m128i t2 = _mm_unpacklo_epi32(l2, l3);
+    __m128i t3 = _mm_unpackhi_epi32(l2, l3);
+    w[0] = _mm_unpacklo_epi64(t0, t2);
+    w[1] = _mm_unpackhi_epi64(t0, t2);
+    w[2] = _mm_unpacklo_epi64(t1, t3);
+    w[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+} // namespace
+
+void Transform_4way(uint32_t* s, const unsigned char* const* blocks)
+{
+    __m128i w[16];
+    Load4(w + 0, blocks, 0);
+    Load4(w + 4, blocks, 16);
+    Load4(w + 8, blocks, 32);
+    Load4(w + 12, blocks, 48);
+
+    const __m128i s0 = _mm_loadu_si128((const __m128i*)(s + 0));
+    const __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    const __m128i s2 = _mm_loadu_si128((const __m128i*)(s + 8));
+    const __m128i s3 = _mm_loadu_si128((const __m128i*)(s + 12));
+    const __m128i s4 = _mm_loadu_si128((const __m128i*)(s + 16));
+    const __m128i s5 = _mm_loadu_si128((const __m128i*)(s + 20));
+    const __m128i s6 = _mm_loadu_si128((const __m128i*)(s + 24));
+    const __m128i s7 = _mm_loadu_si128((const __m128i*)(s + 28));
+    __m128i a = s0, b = s1, c = s2, d = s3, e = s4, f = s5, g = s6, h = s7;
+
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            w[i & 15] = Add(Add(sigma1(w[(i - 2) & 15]), w[(i - 7) & 15]), sigma0(w[(i - 15) & 15]), w[i & 15]);
+        }
+        const __m128i t1 = Add(Add(h, Sigma1(e)), Add(Ch(e, f, g), _mm_set1_epi32(K[i])), w[i & 15]);
+        const __m128i t2 = Add(Sigma0(a), Maj(a, b, c));
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+
+    _mm_storeu_si128((__m128i*)(s + 0), Add(a, s0));
+    _mm_storeu_si128((__m128i*)(s + 4), Add(b, s1));
+    _mm_storeu_si128((__m128i*)(s + 8), Add(c, s2));
+    _mm_storeu_si128((__m128i*)(s + 12), Add(d, s3));
+    _mm_storeu_si128((__m128i*)(s + 16), Add(e, s4));
+    _mm_storeu_si128((__m128i*)(s + 20), Add(f, s5));
+    _mm_storeu_si128((__m128i*)(s + 24), Add(g, s6));
+    _mm_storeu_si128((__m128i*)(s + 28), Add(h, s7));
+}
+
+} // namespace sha256_multi_sse41
+
+#endif
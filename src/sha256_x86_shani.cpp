@@ -0,0 +1,181 @@
+// SHA-256 compression with the x86 SHA extensions (SHA-NI). The state is kept
+// in the ABEF/CDGH register layout that sha256rnds2 expects.
+
+#ifdef ENABLE_X86_SHANI
+
+#include <crypto/common.h>
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace {
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+alignas(16) const uint32_t INIT[8] = {
+    0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul,
+};
+
+/** Message block of a 64-byte message's padding: 0x80, zeroes, then the 512-bit length. */
+alignas(16) const unsigned char PADDING_64[64] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,
+};
+
+/** Byte shuffle between big-endian message/digest words and host-order lanes. A constant
+ * array rather than an __m128i, so it is initialized before any dynamic initializer that
+ * runs SHA256AutoDetect. */
+alignas(16) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+/** Convert the state from word order ABCD/EFGH to ABEF/CDGH. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+/** Convert the state from ABEF/CDGH back to word order ABCD/EFGH. */
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+/** Four rounds with message words m (already in host order). */
+void inline __attribute__((always_inline)) QuadRound(__m128i& s0, __m128i& s1, __m128i m, int i)
+{
+    const __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + 4 * i)));
+    s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+    s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/** Message words 4i..4i+3 from the previous 16, held in m[(i - 4) % 4] .. m[(i - 1) % 4]. */
+void inline __attribute__((always_inline)) Schedule(__m128i* m, int i)
+{
+    __m128i& w = m[i & 3];
+    const __m128i w4 = m[(i + 1) & 3], w8 = m[(i + 2) & 3], w12 = m[(i + 3) & 3];
+    w = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w, w4), _mm_alignr_epi8(w12, w8, 4)), w12);
+}
+
+/**
+ * Compress one block into each of N independent states. The lanes are processed in
+ * lockstep so their sha256rnds2 dependency chains overlap.
+ */
+template <int N>
+void inline __attribute__((always_inline)) Compress(__m128i* s0, __m128i* s1, const unsigned char* const* blocks)
+{
+    __m128i m[N][4], so0[N], so1[N];
+    for (int l = 0; l < N; ++l) {
+        so0[l] = s0[l];
+        so1[l] = s1[l];
+        for (int j = 0; j < 4; ++j) m[l][j] = Load(blocks[l] + 16 * j);
+    }
+    for (int i = 0; i < 16; ++i) {
+        for (int l = 0; l < N; ++l) {
+            if (i >= 4) Schedule(m[l], i);
+            QuadRound(s0[l], s1[l], m[l][i & 3], i);
+        }
+    }
+    for (int l = 0; l < N; ++l) {
+        s0[l] = _mm_add_epi32(s0[l], so0[l]);
+        s1[l] = _mm_add_epi32(s1[l], so1[l]);
+    }
+}
+
+/** Store a state in ABEF/CDGH layout as a big-endian 32-byte hash. */
+void inline __attribute__((always_inline)) StoreHash(unsigned char* out, __m128i s0, __m128i s1)
+{
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s0, _mm_load_si128((const __m128i*)MASK)));
+    _mm_storeu_si128((__m128i*)(out + 16), _mm_shuffle_epi8(s1, _mm_load_si128((const __m128i*)MASK)));
+}
+
+} // namespace
+
+namespace sha256_x86_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+    for (; blocks; --blocks, chunk += 64) {
+        Compress<1>(&s0, &s1, &chunk);
+    }
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+} // namespace sha256_x86_shani
+
+namespace sha256d64_x86_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i init0 = _mm_load_si128((const __m128i*)INIT);
+    __m128i init1 = _mm_load_si128((const __m128i*)(INIT + 4));
+    Shuffle(init0, init1);
+
+    // First hash: the 64-byte message, then its padding block.
+    __m128i s0[2] = {init0, init0}, s1[2] = {init1, init1};
+    const unsigned char* data[2] = {in, in + 64};
+    Compress<2>(s0, s1, data);
+    const unsigned char* padding[2] = {PADDING_64, PADDING_64};
+    Compress<2>(s0, s1, padding);
+
+    // Second hash: the 32-byte digest with its padding, in a single block.
+    alignas(16) unsigned char block[2][64] = {};
+    for (int l = 0; l < 2; ++l) {
+        StoreHash(block[l], s0[l], s1[l]);
+        block[l][32] = 0x80;
+        block[l][62] = 0x01;
+        s0[l] = init0;
+        s1[l] = init1;
+    }
+    const unsigned char* digests[2] = {block[0], block[1]};
+    Compress<2>(s0, s1, digests);
+    StoreHash(out, s0[0], s1[0]);
+    StoreHash(out + 32, s0[1], s1[1]);
+}
+} // namespace sha256d64_x86_shani
+
+namespace sha256_multi_x86_shani {
+/** One compression per lane for 4 independent states, interleaved as s[word * 4 + lane]. */
+void Transform_4way(uint32_t* s, const unsigned char* const* blocks)
+{
+    __m128i s0[4], s1[4];
+    for (int l = 0; l < 4; ++l) {
+        s0[l] = _mm_setr_epi32(s[0 * 4 + l], s[1 * 4 + l], s[2 * 4 + l], s[3 * 4 + l]);
+        s1[l] = _mm_setr_epi32(s[4 * 4 + l], s[5 * 4 + l], s[6 * 4 + l], s[7 * 4 + l]);
+        Shuffle(s0[l], s1[l]);
+    }
+    Compress<4>(s0, s1, blocks);
+    for (int l = 0; l < 4; ++l) {
+        Unshuffle(s0[l], s1[l]);
+        alignas(16) uint32_t words[8];
+        _mm_store_si128((__m128i*)words, s0[l]);
+        _mm_store_si128((__m128i*)(words + 4), s1[l]);
+        for (int i = 0; i < 8; ++i) s[i * 4 + l] = words[i];
+    }
+}
+} // namespace sha256_multi_x86_shani
+
+#endif
@@ -0,0 +1,411 @@
+#include "bitcoin_key_utils.h"
+
+#include "batch_internal.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include "crypto/common.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WATCH_LIST_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace BitcoinKeyUtils::WatchList {
+
+namespace {
+
+// File layout; integers are little-endian and sections start on 64-byte boundaries.
+//   header   magic, version, fan-out bits, entry count, filter block count, the offsets of the
+//            three sections and the file size
+//   filter   blocked Bloom filter of filterBlocks 32-byte blocks
+//   fan-out  2^bits + 1 entry indices; bucket b, the hashes whose leading bits are b, is
+//            [fanout[b], fanout[b + 1])
+//   hashes   the sorted 20-byte hashes
+// Every size and offset follows from the entry count, so opening checks the header against
+// the layout computed for its count.
+constexpr char Magic[8] = {'B', 'K', 'U', 'W', 'L', 'I', 'D', 'X'};
+constexpr uint32_t Version = 1;
+constexpr size_t HeaderSize = 64;
+constexpr uint64_t SectionAlign = 64;
+
+// About 0.1% false positives; see BlockBits for the filter structure.
+constexpr uint64_t FilterBitsPerEntry = 16;
+// Fan-out buckets hold 4 to 8 hashes on average.
+constexpr uint64_t EntriesPerBucket = 8;
+constexpr uint32_t MaxFanoutBits = 32;
+
+// Split block Bloom filter: a hash sets one bit in each of the eight 32-bit words of one block, so a
+// lookup reads a single cache line. The salts are those of the Parquet format's filter.
+constexpr size_t BlockWords = 8;
+constexpr size_t BlockBytes = BlockWords * 4;
+constexpr uint64_t BlockBits = BlockBytes * 8;
+constexpr uint32_t Salt[BlockWords] = {0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31};
+
+// Lookups are issued in groups, and each stage prefetches what the next stage of the group reads.
+constexpr size_t LookupGroup = 16;
+
+// Steps a lookup walks from its interpolated position before falling back to a binary search.
+constexpr size_t MaxWalk = 8;
+
+constexpr size_t HashSize = Constants::Hash160Size;
+
+struct Layout {
+    uint64_t count = 0;
+    uint32_t fanoutBits = 0;
+    uint64_t filterBlocks = 0;
+    uint64_t filterOffset = 0;
+    uint64_t fanoutOffset = 0;
+    uint64_t hashesOffset = 0;
+    uint64_t fileSize = 0;
+};
+
+uint64_t AlignUp(uint64_t n) {
+    return (n + SectionAlign - 1) / SectionAlign * SectionAlign;
+}
+
+Layout MakeLayout(uint64_t count) {
+    Layout layout;
+    layout.count = count;
+    layout.fanoutBits = std::min<uint32_t>(std::bit_width(count / EntriesPerBucket), MaxFanoutBits);
+    layout.filterBlocks = std::max<uint64_t>(1, (count * FilterBitsPerEntry + BlockBits - 1) / BlockBits);
+    layout.filterOffset = HeaderSize;
+    layout.fanoutOffset = AlignUp(layout.filterOffset + layout.filterBlocks * BlockBytes);
+    layout.hashesOffset = AlignUp(layout.fanoutOffset + ((uint64_t{1} << layout.fanoutBits) + 1) * 8);
+    layout.fileSize = layout.hashesOffset + count * HashSize;
+    return layout;
+}
+
+// The filter, the fan-out and the search each use different bits of the hash.
+uint64_t FilterBlock(const uint8_t* hash, uint64_t blocks) {
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(ReadLE64(hash + 12)) * blocks) >> 64);
+}
+
+uint32_t FilterKey(const uint8_t* hash) {
+    return ReadLE32(hash + 8);
+}
+
+bool FilterHit(const uint8_t* block, uint32_t key) {
+    uint32_t hit = 1;
+    for (size_t i = 0; i < BlockWords; ++i) hit &= ReadLE32(block + 4 * i) >> ((key * Salt[i]) >> 27);
+    return hit != 0;
+}
+
+uint64_t Bucket(const uint8_t* hash, uint32_t fanoutBits) {
+    return fanoutBits ? ReadBE64(hash) >> (64 - fanoutBits) : 0;
+}
+
+// Position of the bits after the bucket's, in [0, 2^32), for interpolating within the bucket.
+uint64_t BucketFraction(const uint8_t* hash, uint32_t fanoutBits) {
+    return (ReadBE64(hash) << fanoutBits) >> 32;
+}
+
+inline void Prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+std::unexpected<Error> IOError(std::string_view what, const std::string& path) {
+    return std::unexpected(Error{ErrorCode::WatchListIOFailed, std::string(what) + " " + path + ": " + std::strerror(errno)});
+}
+
+std::unexpected<Error> FormatError(const std::string& path, std::string_view why) {
+    return std::unexpected(Error{ErrorCode::InvalidWatchListFormat, "Not a watch list index: " + path + ": " + std::string(why)});
+}
+
+std::expected<BuildStats, Error> WriteIndex(std::vector<Hash160Digest>& entries, BuildStats stats, const std::string& path) {
+    std::sort(entries.begin(), entries.end());
+    const auto last = std::unique(entries.begin(), entries.end());
+    stats.duplicates = static_cast<size_t>(entries.end() - last);
+    entries.erase(last, entries.end());
+    stats.entries = entries.size();
+
+    const Layout layout = MakeLayout(entries.size());
+    uint8_t header[HeaderSize] = {};
+    std::memcpy(header, Magic, sizeof(Magic));
+    WriteLE32(header + 8, Version);
+    WriteLE32(header + 12, layout.fanoutBits);
+    WriteLE64(header + 16, layout.count);
+    WriteLE64(header + 24, layout.filterBlocks);
+    WriteLE64(header + 32, layout.filterOffset);
+    WriteLE64(header + 40, layout.fanoutOffset);
+    WriteLE64(header + 48, layout.hashesOffset);
+    WriteLE64(header + 56, layout.fileSize);
+
+    std::vector<uint8_t> filter(layout.fanoutOffset - layout.filterOffset);
+    for (const Hash160Digest& entry : entries) {
+        uint8_t* block = filter.data() + FilterBlock(entry.data(), layout.filterBlocks) * BlockBytes;
+        const uint32_t key = FilterKey(entry.data());
+        for (size_t i = 0; i < BlockWords; ++i) WriteLE32(block + 4 * i, ReadLE32(block + 4 * i) | uint32_t{1} << ((key * Salt[i]) >> 27));
+    }
+
+    const uint64_t buckets = uint64_t{1} << layout.fanoutBits;
+    std::vector<uint8_t> fanout(layout.hashesOffset - layout.fanoutOffset);
+    for (uint64_t b = 0, e = 0; b <= buckets; ++b) {
+        while (e < entries.size() && Bucket(entries[e].data(), layout.fanoutBits) < b) ++e;
+        WriteLE64(fanout.data() + 8 * b, e);
+    }
+
+    // Written beside path and renamed over it: an Index that has the old file mapped keeps it.
+    const std::string tmpPath = path + ".tmp";
+    std::FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return IOError("Cannot create watch list index", tmpPath);
+    }
+    const bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+                         std::fwrite(filter.data(), 1, filter.size(), file) == filter.size() &&
+                         std::fwrite(fanout.data(), 1, fanout.size(), file) == fanout.size() &&
+                         (entries.empty() || std::fwrite(entries.data(), HashSize, entries.size(), file) == entries.size());
+    if (!detail::CommitFile(file, written, tmpPath, path)) {
+        return IOError("Cannot write watch list index", path);
+    }
+    return stats;
+}
+
+}
+
+struct Index::Mapping {
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+#ifdef WATCH_LIST_MMAP
+    ~Mapping() {
+        if (base) munmap(const_cast<uint8_t*>(base), size);
+    }
+#else
+    std::vector<uint8_t> storage;
+#endif
+
+    Layout layout;
+    const uint8_t* filter = nullptr;
+    const uint8_t* fanout = nullptr;
+    const uint8_t* hashes = nullptr;
+
+    const uint8_t* Block(const uint8_t* hash) const {
+        return filter + FilterBlock(hash, layout.filterBlocks) * BlockBytes;
+    }
+
+    const uint8_t* FanoutEntry(const uint8_t* hash) const {
+        return fanout + 8 * Bucket(hash, layout.fanoutBits);
+    }
+
+    // Bucket bounds, clamped so a damaged fan-out table cannot send a search outside the hashes.
+    std::pair<uint64_t, uint64_t> BucketRange(const uint8_t* entry) const {
+        const uint64_t hi = std::min(ReadLE64(entry + 8), layout.count);
+        return {std::min(ReadLE64(entry), hi), hi};
+    }
+
+    static uint64_t Guess(std::pair<uint64_t, uint64_t> range, const uint8_t* hash, uint32_t fanoutBits) {
+        return range.first + (((range.second - range.first) * BucketFraction(hash, fanoutBits)) >> 32);
+    }
+
+    bool Before(uint64_t i, const uint8_t* hash) const {
+        return std::memcmp(hashes + i * HashSize, hash, HashSize) < 0;
+    }
+
+    // Walk from the interpolated position to where hash belongs; with uniformly distributed hashes
+    // that is a step or two. Past MaxWalk steps the rest of the range is binary searched, so a
+    // bucket of clustered hashes costs O(log n) rather than O(n).
+    bool Find(std::pair<uint64_t, uint64_t> range, uint64_t guess, const uint8_t* hash) const {
+        // The first entry not before hash is at an index in [lo, hi].
+        uint64_t lo = range.first, hi = range.second;
+        if (guess < hi && Before(guess, hash)) {
+            lo = guess + 1;
+            for (size_t step = 0; step < MaxWalk && lo < hi; ++step) {
+                if (!Before(lo, hash)) hi = lo;
+                else ++lo;
+            }
+        } else {
+            hi = guess;
+            for (size_t step = 0; step < MaxWalk && lo < hi; ++step) {
+                if (Before(hi - 1, hash)) lo = hi;
+                else --hi;
+            }
+        }
+        while (lo < hi) {
+            const uint64_t mid = lo + (hi - lo) / 2;
+            if (Before(mid, hash)) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < range.second && std::memcmp(hashes + lo * HashSize, hash, HashSize) == 0;
+    }
+};
+
+Index::Index(std::unique_ptr<Mapping> mapping) : m_mapping(std::move(mapping)) {}
+Index::Index(Index&& other) noexcept = default;
+Index& Index::operator=(Index&& other) noexcept = default;
+Index::~Index() = default;
+
+std::expected<Index, Error> Index::Open(const std::string& path) {
+    auto mapping = std::make_unique<Mapping>();
+#ifdef WATCH_LIST_MMAP
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return IOError("Cannot open watch list index", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return IOError("Cannot stat watch list index", path);
+    }
+    mapping->size = static_cast<size_t>(st.st_size);
+    if (mapping->size >= HeaderSize) {
+        void* map = mmap(nullptr, mapping->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return IOError("Cannot map watch list index", path);
+        }
+        mapping->base = static_cast<const uint8_t*>(map);
+        // Lookups land anywhere in the file; reading ahead would only evict useful pages.
+        madvise(map, mapping->size, MADV_RANDOM);
+    }
+    close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return IOError("Cannot open watch list index", path);
+    }
+    mapping->storage.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    mapping->base = mapping->storage.data();
+    mapping->size = mapping->storage.size();
+#endif
+
+    const uint8_t* header = mapping->base;
+    if (mapping->size < HeaderSize || std::memcmp(header, Magic, sizeof(Magic)) != 0) {
+        return FormatError(path, "bad magic");
+    }
+    if (ReadLE32(header + 8) != Version) {
+        return FormatError(path, "unsupported version " + std::to_string(ReadLE32(header + 8)));
+    }
+    const uint64_t count = ReadLE64(header + 16);
+    if (count > mapping->size / HashSize) {
+        return FormatError(path, "entry count exceeds the file size");
+    }
+    const Layout layout = MakeLayout(count);
+    if (ReadLE32(header + 12) != layout.fanoutBits || ReadLE64(header + 24) != layout.filterBlocks ||
+        ReadLE64(header + 32) != layout.filterOffset || ReadLE64(header + 40) != layout.fanoutOffset ||
+        ReadLE64(header + 48) != layout.hashesOffset || ReadLE64(header + 56) != layout.fileSize) {
+        return FormatError(path, "header does not match the layout for its entry count");
+    }
+    if (mapping->size < layout.fileSize) {
+        return FormatError(path, "truncated");
+    }
+
+    mapping->layout = layout;
+    mapping->filter = mapping->base + layout.filterOffset;
+    mapping->fanout = mapping->base + layout.fanoutOffset;
+    mapping->hashes = mapping->base + layout.hashesOffset;
+    return Index(std::move(mapping));
+}
+
+size_t Index::Size() const noexcept {
+    return m_mapping->layout.count;
+}
+
+bool Index::Contains(std::span<const uint8_t, Constants::Hash160Size> pubKeyHash) const noexcept {
+    const Mapping& m = *m_mapping;
+    const uint8_t* hash = pubKeyHash.data();
+    if (!FilterHit(m.Block(hash), FilterKey(hash))) return false;
+    const auto range = m.BucketRange(m.FanoutEntry(hash));
+    return m.Find(range, Mapping::Guess(range, hash, m.layout.fanoutBits), hash);
+}
+
+std::expected<size_t, Error> Index::Contains(std::span<const uint8_t> pubKeyHashes, std::span<uint64_t> found) const {
+    if (pubKeyHashes.size() % HashSize != 0) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch input size " + std::to_string(pubKeyHashes.size()) + " is not a multiple of record size 20"});
+    }
+    const size_t count = pubKeyHashes.size() / HashSize;
+    const size_t words = (count + 63) / 64;
+    if (found.size() < words) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Found bitmap too small: " + std::to_string(found.size()) + " words, expected at least: " + std::to_string(words)});
+    }
+
+    const Mapping& m = *m_mapping;
+    const uint32_t fanoutBits = m.layout.fanoutBits;
+    size_t hits = 0;
+    for (size_t first = 0; first < count; first += 64) {
+        const size_t n = std::min<size_t>(64, count - first);
+        uint64_t word = 0;
+        for (size_t group = 0; group < n; group += LookupGroup) {
+            const size_t k = std::min(LookupGroup, n - group);
+            const uint8_t* keys = pubKeyHashes.data() + (first + group) * HashSize;
+
+            const uint8_t* blocks[LookupGroup];
+            for (size_t i = 0; i < k; ++i) {
+                blocks[i] = m.Block(keys + i * HashSize);
+                Prefetch(blocks[i]);
+            }
+
+            // Only filter hits go on; the rest are definite misses.
+            size_t candidates[LookupGroup];
+            const uint8_t* entries[LookupGroup];
+            size_t c = 0;
+            for (size_t i = 0; i < k; ++i) {
+                if (FilterHit(blocks[i], FilterKey(keys + i * HashSize))) {
+                    entries[c] = m.FanoutEntry(keys + i * HashSize);
+                    Prefetch(entries[c]);
+                    candidates[c++] = i;
+                }
+            }
+
+            std::pair<uint64_t, uint64_t> ranges[LookupGroup];
+            uint64_t guesses[LookupGroup];
+            for (size_t j = 0; j < c; ++j) {
+                ranges[j] = m.BucketRange(entries[j]);
+                guesses[j] = Mapping::Guess(ranges[j], keys + candidates[j] * HashSize, fanoutBits);
+                Prefetch(m.hashes + guesses[j] * HashSize);
+            }
+
+            for (size_t j = 0; j < c; ++j) {
+                if (m.Find(ranges[j], guesses[j], keys + candidates[j] * HashSize)) word |= uint64_t{1} << (group + candidates[j]);
+            }
+        }
+        found[first / 64] = word;
+        hits += std::popcount(word);
+    }
+    return hits;
+}
+
+std::expected<BuildStats, Error> Build(std::span<const uint8_t> hashes, const std::string& path) {
+    if (hashes.size() % HashSize != 0) {
+        return std::unexpected(Error{ErrorCode::BatchSizeMismatch, "Batch input size " + std::to_string(hashes.size()) + " is not a multiple of record size 20"});
+    }
+    std::vector<Hash160Digest> entries(hashes.size() / HashSize);
+    if (!entries.empty()) std::memcpy(entries.data(), hashes.data(), hashes.size());
+    return WriteIndex(entries, {}, path);
+}
+
+std::expected<BuildStats, Error> BuildFromAddresses(std::span<const std::string_view> addresses, const std::string& path, std::string_view hrp) {
+    // Addresses are validated a bounded slice at a time so the scratch stays small for huge lists.
+    constexpr size_t Slice = 1 << 16;
+    std::vector<uint64_t> valid(Slice / 64);
+    std::vector<DecodedAddress> decoded(Slice);
+    std::vector<Hash160Digest> entries;
+    entries.reserve(addresses.size());
+    BuildStats stats;
+    for (size_t first = 0; first < addresses.size(); first += Slice) {
+        const size_t n = std::min(Slice, addresses.size() - first);
+        auto checked = ValidateAddresses(addresses.subspan(first, n), valid, decoded, hrp);
+        if (!checked) {
+            return std::unexpected(checked.error());
+        }
+        stats.rejected += n - *checked;
+        for (size_t i = 0; i < n; ++i) {
+            if (valid[i / 64] >> (i % 64) & 1) entries.push_back(decoded[i].hash);
+        }
+    }
+    return WriteIndex(entries, stats, path);
+}
+
+}
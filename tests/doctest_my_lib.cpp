@@ -1,40 +1,78 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 #include "bitcoin_key_utils.h"
+#include "bitcoin_key_literals.h"
 #include "base58.h"
 #include "bech32.h"
+#include "crypto/ripemd160.h"
+#include "crypto/sha256.h"
+#include "hash.h"
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <thread>
 
-std::vector<uint8_t> HexToBytes(const std::string& hex) {
-    if (hex.size() % 2 != 0) {
-        throw std::invalid_argument("Hex string must have even length");
+// Heap allocations on this thread are counted while an AllocationCounter is running, so tests can
+// assert that a code path performs none regardless of what other threads do.
+static thread_local size_t* t_allocations = nullptr;
+
+class AllocationCounter {
+public:
+    AllocationCounter() { t_allocations = &m_count; }
+    ~AllocationCounter() { Stop(); }
+
+    // Stop counting and return the number of allocations seen.
+    size_t Stop() {
+        if (t_allocations == &m_count) t_allocations = nullptr;
+        return m_count;
     }
 
-    auto hexVal = [](char c) -> int {
-        if (c >= '0' && c <= '9') return c - '0';
-        if (c >= 'a' && c <= 'f') return 10 + (c - 'a');
-        if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
-        throw std::invalid_argument("Invalid hex character");
-    };
+private:
+    size_t m_count = 0;
+};
 
-    std::vector<uint8_t> bytes;
-    bytes.reserve(hex.size() / 2);
+static void* CountedAllocate(size_t size) {
+    if (t_allocations) ++*t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
 
-    for (size_t i = 0; i < hex.size(); i += 2) {
-        int hi = hexVal(hex[i]);
-        int lo = hexVal(hex[i + 1]);
-        bytes.push_back(static_cast<uint8_t>((hi << 4) | lo));
-    }
+// Kept out of line so the compiler does not pair this free() with the operator new at the call site
+// and warn about mismatched allocation functions.
+[[gnu::noinline]] static void Release(void* p) noexcept { std::free(p); }
 
+// Every non-aligned form is replaced so allocation and release always match; the over-aligned forms
+// keep their default definitions, which pair with each other.
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* p) noexcept { Release(p); }
+void operator delete[](void* p) noexcept { Release(p); }
+void operator delete(void* p, size_t) noexcept { Release(p); }
+void operator delete[](void* p, size_t) noexcept { Release(p); }
+
+std::vector<uint8_t> HexToBytes(const std::string& hex) {
+    std::vector<uint8_t> bytes(hex.size() / 2);
+    if (!BitcoinKeyUtils::Hex::Decode(hex, bytes)) {
+        throw std::invalid_argument("Invalid hex string: " + hex);
+    }
     return bytes;
 }
 
 std::string HexFromBytes(const std::vector<unsigned char>& bytes) {
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    for (unsigned char byte : bytes) {
-        oss << std::setw(2) << static_cast<int>(byte);
-    }
-    return oss.str();
+    std::string hex(2 * bytes.size(), '\0');
+    (void)BitcoinKeyUtils::Hex::Encode(bytes, hex);
+    return hex;
+}
+
+// Read one NUL-padded record out of a fixed-stride batch output buffer.
+std::string RecordAt(const std::vector<char>& buf, size_t i, size_t stride) {
+    const char* rec = buf.data() + i * stride;
+    return std::string(rec, strnlen(rec, stride));
 }
 
 TEST_CASE("EncodeWIF invalid size") {
@@ -106,6 +144,11 @@ TEST_CASE("DecodeWIF know vectors"){
     REQUIRE(!result6.has_value());
     CHECK_EQ(result6.error().code, BitcoinKeyUtils::ErrorCode::Base58CheckDecodingFailed);
 
+    // surrounding whitespace is still accepted, as with the generic decoder
+    auto result7 = BitcoinKeyUtils::DecodeWIF(std::string(" ") + wif1);
+    REQUIRE(result7.has_value());
+    CHECK(result7->first == result1->first);
+
 }
 
 
@@ -182,3 +225,1284 @@ TEST_CASE("BIP-173: uppercase valid, mixed-case invalid (decoder behavior)") {
         CHECK(dec.encoding == bech32::Encoding::INVALID);  
     }
 }
+
+TEST_CASE("Batch APIs match single-record calls") {
+    const std::vector<std::string> privHex = {
+        "9c58b927efdd901b4c592437acbf9d3129d6f00e80b3e91f76e5a8c8fbfd5fcb",
+        "0f12ecac4f2dbc65ab6b6572d54e2d74f79896d1d53bd9282577a4f63ffdfae6",
+        "0000000000000000000000000000000000000000000000000000000000000000"
+    };
+    const std::vector<std::string> pubHex = {
+        "0250813b74c125222305afc30d25a006062a6669dba9e798208dbf4ae816fdda14",
+        "02f09541e26ba48d52dee7010fe29f281de6588028cbc90d42a1a5d36a3a817d39",
+        "05f09541e26ba48d52dee7010fe29f281de6588028cbc90d42a1a5d36a3a817d39" // bad SEC1 prefix
+    };
+    const size_t n = privHex.size();
+
+    std::vector<uint8_t> privKeys, pubKeys;
+    for (auto& h : privHex) { auto b = HexToBytes(h); privKeys.insert(privKeys.end(), b.begin(), b.end()); }
+    for (auto& h : pubHex) { auto b = HexToBytes(h); pubKeys.insert(pubKeys.end(), b.begin(), b.end()); }
+
+    std::vector<BitcoinKeyUtils::BatchStatus> status(n);
+
+    std::vector<char> wifs(n * BitcoinKeyUtils::Constants::WIFStride);
+    for (bool compressed : {true, false}) {
+        auto count = BitcoinKeyUtils::EncodeWIFBatch(privKeys, compressed, wifs, status);
+        REQUIRE(count.has_value());
+        CHECK_EQ(*count, n);
+        for (size_t i = 0; i < n; ++i) {
+            auto single = BitcoinKeyUtils::EncodeWIF(HexToBytes(privHex[i]), compressed);
+            REQUIRE(single.has_value());
+            CHECK(status[i].ok);
+            CHECK_EQ(RecordAt(wifs, i, BitcoinKeyUtils::Constants::WIFStride), *single);
+        }
+    }
+
+    std::vector<uint8_t> hashes(n * BitcoinKeyUtils::Constants::Hash160Size);
+    auto hashed = BitcoinKeyUtils::HashRIPEMD160SHA256Batch(pubKeys, BitcoinKeyUtils::Constants::CompressedPubKeySize, hashes, status);
+    REQUIRE(hashed.has_value());
+    CHECK_EQ(*hashed, n - 1);
+    CHECK_FALSE(status[2].ok);
+    CHECK_EQ(status[2].code, BitcoinKeyUtils::ErrorCode::InvalidPubKeyPrefix);
+    CHECK_EQ(HexFromBytes({hashes.begin(), hashes.begin() + 20}), "b6e4c3f1f275383cb68476e7fae11496aed97c7a");
+    CHECK_EQ(HexFromBytes({hashes.begin() + 20, hashes.begin() + 40}), "a6bd6514b14a31373d1a85d6978ad6f349764d91");
+
+    std::vector<char> p2pkh(n * BitcoinKeyUtils::Constants::P2PKHStride);
+    std::vector<char> p2wpkh(n * BitcoinKeyUtils::Constants::P2WPKHStride);
+    REQUIRE(BitcoinKeyUtils::GenerateP2PKHAddressBatch(hashes, p2pkh, status).has_value());
+    REQUIRE(BitcoinKeyUtils::GenerateP2WPKHAddressBatch(hashes, p2wpkh, status).has_value());
+    for (size_t i = 0; i < n; ++i) {
+        std::vector<uint8_t> h160(hashes.begin() + i * 20, hashes.begin() + (i + 1) * 20);
+        CHECK_EQ(RecordAt(p2pkh, i, BitcoinKeyUtils::Constants::P2PKHStride), *BitcoinKeyUtils::GenerateP2PKHAddress(h160));
+        CHECK_EQ(RecordAt(p2wpkh, i, BitcoinKeyUtils::Constants::P2WPKHStride), *BitcoinKeyUtils::GenerateP2WPKHAddress(h160));
+    }
+}
+
+TEST_CASE("Batch APIs reject mismatched buffers") {
+    std::vector<uint8_t> keys(2 * 32 + 1);
+    std::vector<char> out(2 * BitcoinKeyUtils::Constants::WIFStride);
+    std::vector<BitcoinKeyUtils::BatchStatus> status(2);
+    auto r1 = BitcoinKeyUtils::EncodeWIFBatch(keys, true, out, status);
+    REQUIRE_FALSE(r1.has_value());
+    CHECK_EQ(r1.error().code, BitcoinKeyUtils::ErrorCode::BatchSizeMismatch);
+
+    std::vector<uint8_t> pubs(2 * 33);
+    std::vector<uint8_t> hashes(20);
+    auto r2 = BitcoinKeyUtils::HashRIPEMD160SHA256Batch(pubs, 33, hashes, status);
+    REQUIRE_FALSE(r2.has_value());
+    CHECK_EQ(r2.error().code, BitcoinKeyUtils::ErrorCode::BatchSizeMismatch);
+
+    auto r3 = BitcoinKeyUtils::HashRIPEMD160SHA256Batch(pubs, 32, hashes, status);
+    REQUIRE_FALSE(r3.has_value());
+    CHECK_EQ(r3.error().code, BitcoinKeyUtils::ErrorCode::InvalidPubKeySize);
+
+    std::vector<uint8_t> h160(40);
+    std::vector<char> addrs(2 * BitcoinKeyUtils::Constants::P2WPKHStride);
+    auto r4 = BitcoinKeyUtils::GenerateP2WPKHAddressBatch(h160, addrs, status, "xx");
+    REQUIRE_FALSE(r4.has_value());
+    CHECK_EQ(r4.error().code, BitcoinKeyUtils::ErrorCode::InvalidHRP);
+}
+
+TEST_CASE("SHA256Multi / SHA256DMulti match CSHA256 on every backend") {
+    using namespace sha256_implementation;
+    std::vector<uint8_t> data(13 * 130);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 7 + 3);
+
+    for (auto impl : {STANDARD, USE_SSE4, USE_SSE4_AND_AVX2, USE_ALL}) {
+        SHA256AutoDetect(impl);
+        for (size_t len : {size_t{0}, size_t{21}, size_t{33}, size_t{34}, size_t{55}, size_t{56}, size_t{65}, SHA256_MULTI_MAX_INPUT, SHA256_MULTI_MAX_INPUT + 1, size_t{130}}) {
+            const size_t count = 13; // exercises the 8-way, 4-way and single-lane paths
+            std::vector<uint8_t> single(count * 32), dbl(count * 32);
+            SHA256Multi(single.data(), data.data(), len, count);
+            SHA256DMulti(dbl.data(), data.data(), len, count);
+            for (size_t i = 0; i < count; ++i) {
+                unsigned char expected[CSHA256::OUTPUT_SIZE];
+                CSHA256().Write(data.data() + i * len, len).Finalize(expected);
+                CHECK(std::equal(expected, expected + 32, single.begin() + i * 32));
+                CSHA256().Write(expected, 32).Finalize(expected);
+                CHECK(std::equal(expected, expected + 32, dbl.begin() + i * 32));
+            }
+        }
+    }
+    SHA256AutoDetect();
+}
+
+TEST_CASE("SHA256MultiPrefixed and CSHA256 midstates resume a shared prefix on every backend") {
+    using namespace sha256_implementation;
+    std::vector<uint8_t> data(13 * SHA256_MULTI_MAX_INPUT + 200);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 5 + 1);
+    const uint8_t* prefixData = data.data() + 13 * SHA256_MULTI_MAX_INPUT;
+
+    for (auto impl : {STANDARD, USE_SSE4, USE_SSE4_AND_AVX2, USE_ALL}) {
+        SHA256AutoDetect(impl);
+        // Prefixes ending anywhere in a block, messages padding into one, two or three blocks, and
+        // messages too long for the lanes.
+        for (size_t prefixLen : {size_t{0}, size_t{1}, size_t{55}, size_t{63}, size_t{64}, size_t{65}, size_t{200}}) {
+            CSHA256 prefix;
+            prefix.Write(prefixData, prefixLen);
+            const CSHA256::Midstate saved = prefix.Save();
+            for (size_t len : {size_t{0}, size_t{8}, size_t{33}, size_t{56}, size_t{64}, SHA256_MULTI_MAX_INPUT, SHA256_MULTI_MAX_INPUT + 1, size_t{130}}) {
+                CAPTURE(prefixLen);
+                CAPTURE(len);
+                const size_t count = 13;
+                std::vector<uint8_t> hashes(count * 32);
+                SHA256MultiPrefixed(hashes.data(), prefix, data.data(), len, count);
+                for (size_t i = 0; i < count; ++i) {
+                    unsigned char expected[CSHA256::OUTPUT_SIZE];
+                    CSHA256().Write(prefixData, prefixLen).Write(data.data() + i * len, len).Finalize(expected);
+                    CHECK(std::equal(expected, expected + 32, hashes.begin() + i * 32));
+                    unsigned char resumed[CSHA256::OUTPUT_SIZE];
+                    CSHA256(saved).Write(data.data() + i * len, len).Finalize(resumed);
+                    CHECK(std::equal(expected, expected + 32, resumed));
+                }
+            }
+            // The prefix is left as it was.
+            unsigned char before[CSHA256::OUTPUT_SIZE], after[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(prefixData, prefixLen).Finalize(before);
+            prefix.Finalize(after);
+            CHECK(std::equal(before, before + 32, after));
+            // Restore replaces whatever was written since.
+            CSHA256 restored;
+            restored.Write(data.data(), 7).Restore(saved).Finalize(after);
+            CHECK(std::equal(before, before + 32, after));
+        }
+    }
+    SHA256AutoDetect();
+
+    // A tagged hash (BIP 340) is SHA256(SHA256(tag) || SHA256(tag) || msg), and its writer serves as the prefix.
+    const HashWriter tagged = TaggedHash("TapLeaf");
+    std::vector<uint8_t> hashes(5 * 32);
+    tagged.GetSHA256Multi(hashes.data(), data.data(), 34, 5);
+    unsigned char tag[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(reinterpret_cast<const unsigned char*>("TapLeaf"), 7).Finalize(tag);
+    for (size_t i = 0; i < 5; ++i) {
+        unsigned char expected[CSHA256::OUTPUT_SIZE];
+        CSHA256().Write(tag, 32).Write(tag, 32).Write(data.data() + i * 34, 34).Finalize(expected);
+        CHECK(std::equal(expected, expected + 32, hashes.begin() + i * 32));
+        HashWriter copy = tagged;
+        copy.write(MakeByteSpan(Span{data.data() + i * 34, 34}));
+        const uint256 single = copy.GetSHA256();
+        CHECK(std::equal(expected, expected + 32, single.begin()));
+    }
+}
+
+TEST_CASE("RIPEMD160D32 matches CRIPEMD160 on every backend") {
+    using namespace ripemd160_implementation;
+    std::vector<uint8_t> data(13 * 32);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 13 + 1);
+
+    for (auto impl : {STANDARD, USE_SSE41, USE_ALL}) {
+        RIPEMD160AutoDetect(impl);
+        std::vector<uint8_t> out(13 * 20);
+        RIPEMD160D32(out.data(), data.data(), 13); // exercises the 8-way, 4-way and single-lane paths
+        for (size_t i = 0; i < 13; ++i) {
+            unsigned char expected[CRIPEMD160::OUTPUT_SIZE];
+            CRIPEMD160().Write(data.data() + i * 32, 32).Finalize(expected);
+            CHECK(std::equal(expected, expected + 20, out.begin() + i * 20));
+        }
+    }
+    RIPEMD160AutoDetect();
+}
+
+TEST_CASE("Fixed-length Base58 codec agrees with the generic decoder") {
+    auto check = [](auto sizeTag) {
+        constexpr size_t N = decltype(sizeTag)::value;
+        std::vector<std::vector<uint8_t>> payloads = {std::vector<uint8_t>(N, 0x00), std::vector<uint8_t>(N, 0xff)};
+        for (size_t zeroes : {0, 1, 3}) {
+            std::vector<uint8_t> p(N);
+            for (size_t i = zeroes; i < N; ++i) p[i] = static_cast<uint8_t>(i * 31 + 7 + N);
+            payloads.push_back(p);
+        }
+        for (const auto& p : payloads) {
+            char buf[64];
+            const size_t len = EncodeBase58Fixed<N>(p.data(), buf);
+            REQUIRE(len > 0);
+            const std::string encoded(buf, len);
+
+            std::vector<unsigned char> generic;
+            REQUIRE(DecodeBase58(encoded, generic, 64));
+            CHECK(generic == p);
+
+            uint8_t decoded[N];
+            REQUIRE(DecodeBase58Fixed<N>(encoded, decoded));
+            CHECK(std::equal(decoded, decoded + N, p.begin()));
+
+            CHECK_EQ(EncodeBase58Fixed<N>(p.data(), Span{buf, len - 1}), 0u); // output too small
+            CHECK_FALSE(DecodeBase58Fixed<N>("1" + encoded, decoded));      // one byte too long
+            CHECK_FALSE(DecodeBase58Fixed<N>(encoded + " ", decoded));
+        }
+        uint8_t decoded[N];
+        CHECK_FALSE(DecodeBase58Fixed<N>(std::string(N * 138 / 100 + 1, 'z'), decoded)); // overflows N bytes
+        CHECK_FALSE(DecodeBase58Fixed<N>("0OIl", decoded));
+    };
+    check(std::integral_constant<size_t, 25>{});
+    check(std::integral_constant<size_t, 37>{});
+    check(std::integral_constant<size_t, 38>{});
+    check(std::integral_constant<size_t, 21>{}); // no buffer overload dispatches to this size
+}
+
+TEST_CASE("SHA256DChecksum matches CHash256 on every backend") {
+    using namespace sha256_implementation;
+    std::vector<uint8_t> data(2 * SHA256_SINGLE_BLOCK_MAX_INPUT);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 11 + 5);
+
+    for (auto impl : {STANDARD, USE_SSE4, USE_ALL}) {
+        SHA256AutoDetect(impl);
+        // Past SHA256_SINGLE_BLOCK_MAX_INPUT the streaming fallback is used.
+        for (size_t len = 0; len <= data.size(); ++len) {
+            unsigned char checksum[4];
+            SHA256DChecksum(checksum, data.data(), len);
+            uint256 expected = Hash(Span{data.data(), len});
+            CHECK(std::equal(checksum, checksum + 4, expected.begin()));
+        }
+    }
+    SHA256AutoDetect();
+
+    // The buffer decoder accepts exactly the payload the checksum covers.
+    const auto payload = HexToBytes("00751e76e8199196d454941c45d1b3a323f1433bd6");
+    const std::string address = EncodeBase58Check(payload);
+    std::array<unsigned char, 21> decoded;
+    REQUIRE(DecodeBase58Check(address, Span{decoded}));
+    CHECK(std::equal(decoded.begin(), decoded.end(), payload.begin()));
+    std::array<unsigned char, 20> shorter;
+    CHECK_FALSE(DecodeBase58Check(address, Span{shorter}));
+    std::string corrupted = address;
+    corrupted.back() = corrupted.back() == '2' ? '3' : '2';
+    CHECK_FALSE(DecodeBase58Check(corrupted, Span{decoded}));
+}
+
+TEST_CASE("bech32::Encoder matches bech32::Encode") {
+    for (auto encoding : {bech32::Encoding::BECH32, bech32::Encoding::BECH32M}) {
+        for (std::string hrp : {"bc", "tb", "bcrt"}) {
+            const bech32::Encoder encoder(encoding, hrp);
+            for (size_t len : {0, 1, 32, 33, 53}) { // odd and even lengths take both PolyModUpdate paths
+                std::vector<uint8_t> values(len);
+                for (size_t i = 0; i < len; ++i) values[i] = static_cast<uint8_t>((i * 7 + len) & 31);
+                const std::string expected = bech32::Encode(encoding, hrp, values);
+                char buf[bech32::CharLimit::BECH32];
+                const size_t written = encoder.Encode(values, buf);
+                CHECK_EQ(std::string(buf, written), expected);
+                auto decoded = bech32::Decode(expected);
+                CHECK(decoded.encoding == encoding);
+                CHECK(decoded.data == values);
+            }
+        }
+    }
+
+    // BIP-173 P2WSH and BIP-350 P2TR vectors, encoded straight from the program bytes.
+    char buf[bech32::CharLimit::BECH32];
+    const auto p2wsh = HexToBytes("1863143c14c5166804bd19203356da136c985678cd4d27a1b8c6329604903262");
+    const size_t n1 = bech32::Encoder(bech32::Encoding::BECH32, "bc").EncodeWitnessProgram(0, p2wsh, buf);
+    CHECK_EQ(std::string(buf, n1), "bc1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3qccfmv3");
+    const auto p2tr = HexToBytes("79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+    const size_t n2 = bech32::Encoder(bech32::Encoding::BECH32M, "bc").EncodeWitnessProgram(1, p2tr, buf);
+    CHECK_EQ(std::string(buf, n2), "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0");
+
+    const bech32::Encoder mainnet(bech32::Encoding::BECH32, "bc");
+    CHECK_EQ(mainnet.EncodeWitnessProgram(17, p2wsh, buf), 0u);
+    CHECK_EQ(mainnet.EncodeWitnessProgram(0, p2wsh, Span{buf, 61}), 0u);
+
+    // An uppercase HRP is folded by the encoder and refused by the buffer-writing Encode.
+    const size_t n3 = bech32::Encoder(bech32::Encoding::BECH32, "BC").EncodeWitnessProgram(0, p2wsh, buf);
+    CHECK_EQ(std::string(buf, n3), "bc1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3qccfmv3");
+    const std::vector<uint8_t> values(32);
+    CHECK_EQ(bech32::Encode(bech32::Encoding::BECH32, std::string_view{"BC"}, values, buf), 0u);
+}
+
+TEST_CASE("NoAlloc API matches the allocating API without touching the heap") {
+    using namespace BitcoinKeyUtils;
+    const auto keyBytes = HexToBytes("0f12ecac4f2dbc65ab6b6572d54e2d74f79896d1d53bd9282577a4f63ffdfae6");
+    const auto pubBytes = HexToBytes("02f09541e26ba48d52dee7010fe29f281de6588028cbc90d42a1a5d36a3a817d39");
+    PrivateKey key;
+    std::copy(keyBytes.begin(), keyBytes.end(), key.begin());
+    std::array<uint8_t, Constants::CompressedPubKeySize> pub;
+    std::copy(pubBytes.begin(), pubBytes.end(), pub.begin());
+
+    // Warm up function-local statics before counting.
+    REQUIRE(NoAlloc::GenerateP2WPKHAddress(Hash160Digest{}).has_value());
+
+    AllocationCounter allocations;
+    auto wifC = NoAlloc::EncodeWIF(key, true);
+    auto wifU = NoAlloc::EncodeWIF(key, false);
+    REQUIRE(wifC.has_value());
+    REQUIRE(wifU.has_value());
+    auto decodedC = NoAlloc::DecodeWIF(*wifC);
+    auto decodedU = NoAlloc::DecodeWIF(*wifU);
+    auto hash = NoAlloc::HashRIPEMD160SHA256(pub);
+    REQUIRE(hash.has_value());
+    auto p2pkh = NoAlloc::GenerateP2PKHAddress(*hash);
+    auto p2wpkh = NoAlloc::GenerateP2WPKHAddress(*hash);
+    auto p2wpkhTest = NoAlloc::GenerateP2WPKHAddress(*hash, "TB");
+    auto badHrp = NoAlloc::GenerateP2WPKHAddress(*hash, "Bc");
+    auto badLength = NoAlloc::DecodeWIF("KwDiBf89QgGbjEhKnhX");
+    CHECK_EQ(allocations.Stop(), 0u);
+
+    REQUIRE(decodedC.has_value());
+    REQUIRE(decodedU.has_value());
+    REQUIRE(p2pkh.has_value());
+    REQUIRE(p2wpkh.has_value());
+    REQUIRE(p2wpkhTest.has_value());
+    CHECK(decodedC->first == key);
+    CHECK(decodedC->second);
+    CHECK(decodedU->first == key);
+    CHECK_FALSE(decodedU->second);
+    CHECK_EQ(wifC->view(), *EncodeWIF(keyBytes, true));
+    CHECK_EQ(wifU->view(), *EncodeWIF(keyBytes, false));
+    const std::vector<uint8_t> hashBytes(hash->begin(), hash->end());
+    CHECK(hashBytes == *HashRIPEMD160SHA256(pubBytes));
+    CHECK_EQ(p2pkh->str(), *GenerateP2PKHAddress(hashBytes));
+    CHECK_EQ(p2wpkh->str(), *GenerateP2WPKHAddress(hashBytes));
+    CHECK_EQ(p2wpkhTest->str(), *GenerateP2WPKHAddress(hashBytes, "tb"));
+
+    REQUIRE_FALSE(badHrp.has_value());
+    CHECK_EQ(badHrp.error(), ErrorCode::InvalidHRP);
+    REQUIRE_FALSE(badLength.has_value());
+    CHECK_EQ(badLength.error(), ErrorCode::InvalidWIFLength);
+    auto testnet = NoAlloc::DecodeWIF("91dfcpRP4MS9jebKKaqLwVTM9xa3SK93stmvYPkSKej4DymAXXK");
+    REQUIRE_FALSE(testnet.has_value());
+    CHECK_EQ(testnet.error(), ErrorCode::InvalidNetworkPrefix);
+    auto corrupted = NoAlloc::DecodeWIF("5Hs335bqU9N1mb62hEwS4tuPWJDLH9brXwuyTmPvyuz1StBzsBD");
+    REQUIRE_FALSE(corrupted.has_value());
+    CHECK_EQ(corrupted.error(), ErrorCode::Base58CheckDecodingFailed);
+    CHECK_FALSE(ErrorMessage(ErrorCode::InvalidHRP).empty());
+    CHECK_EQ(NoAlloc::HashRIPEMD160SHA256({}).error(), ErrorCode::EmptyData);
+}
+
+TEST_CASE("Base58 and Bech32 alphabet scans agree with the character tables") {
+    const std::string_view base58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+    const std::string_view bech32Lower = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+    const std::string_view bech32Upper = "QPZRY9X8GF2TVDW0S3JN54KHCE6MUA7L";
+    // Every byte value at every position of a 40-character string, so both the vector blocks
+    // and the scalar tail are covered.
+    for (size_t pos = 0; pos < 40; ++pos) {
+        for (int b = 0; b < 256; ++b) {
+            const char c = static_cast<char>(b);
+            std::string s58(40, 'z'), s32(40, 'q');
+            s58[pos] = c;
+            s32[pos] = c;
+            const bool in58 = base58.find(c) != std::string_view::npos;
+            const bool in32 = bech32Lower.find(c) != std::string_view::npos || bech32Upper.find(c) != std::string_view::npos;
+            CHECK_EQ(FindInvalidBase58Character(s58), in58 ? 40 : pos);
+            CHECK_EQ(bech32::FindInvalidCharacter(s32), in32 ? 40 : pos);
+        }
+    }
+}
+
+TEST_CASE("DecodeAddress returns the type and hash, or why the address was rejected") {
+    using namespace BitcoinKeyUtils;
+    auto p2pkh = DecodeAddress("13pWyxxRxoZrKpRqQXXwrKfrzAWxGoS7mQ");
+    REQUIRE(p2pkh.has_value());
+    CHECK(p2pkh->type == AddressType::P2PKH);
+    CHECK_EQ(HexFromBytes({p2pkh->hash.begin(), p2pkh->hash.end()}), "1eecd461605c6e927ab131bb19e2500ade0b9513");
+
+    auto p2wpkh = DecodeAddress("bc1qnyrg5nr6vxtk5tjj8p82cg24uxlct8y2zkvhna");
+    REQUIRE(p2wpkh.has_value());
+    CHECK(p2wpkh->type == AddressType::P2WPKH);
+    CHECK_EQ(HexFromBytes({p2wpkh->hash.begin(), p2wpkh->hash.end()}), "99068a4c7a61976a2e52384eac2155e1bf859c8a");
+
+    // BIP-173: uppercase is valid, and the testnet HRP must be asked for.
+    auto upper = NoAlloc::DecodeAddress("BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4");
+    REQUIRE(upper.has_value());
+    CHECK_EQ(HexFromBytes({upper->hash.begin(), upper->hash.end()}), "751e76e8199196d454941c45d1b3a323f1433bd6");
+    CHECK(NoAlloc::DecodeAddress("tb1qw508d6qejxtdg4y5r3zarvary0c5xw7kxpjzsx", "tb").has_value());
+    using BitcoinKeyUtils::detail::HasSegwitPrefix;
+    static_assert(HasSegwitPrefix("BC1Q", "bc") && HasSegwitPrefix("bC1q", "bc") && HasSegwitPrefix("bcrt1q", "bcrt"));
+    static_assert(!HasSegwitPrefix("b1", "bc") && !HasSegwitPrefix("bcq", "bc") && !HasSegwitPrefix("Bb1q", "bc"));
+
+    struct Rejected { std::string address; ErrorCode code; };
+    const std::vector<Rejected> rejected = {
+        {"", ErrorCode::InvalidAddressLength},
+        {"tb1qw508d6qejxtdg4y5r3zarvary0c5xw7kxpjzsx", ErrorCode::InvalidAddressLength},  // not "bc", so read as Base58
+        {"13pWyxxRxoZrKpRqQXXwrKfrzAWxGoS7m0", ErrorCode::InvalidAddressCharacter},
+        {"13pWyxxRxoZrKpRqQXXwrKfrzAWxGoS7mR", ErrorCode::Base58CheckDecodingFailed},
+        {"3J98t1WpEZ73CNmQviecrnyiWrnqRhWNLy", ErrorCode::InvalidNetworkPrefix},          // P2SH
+        {"bc1qnyrg5nr6vxtk5tjj8p82cg24uxlct8y2zkvhnb", ErrorCode::InvalidAddressCharacter},
+        {"bc1qnyrg5nr6vxtk5tjj8p82cg24uxlct8y2zkvhnq", ErrorCode::Bech32DecodingFailed},
+        {"BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3t4", ErrorCode::Bech32DecodingFailed},  // mixed case
+        {"bc1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3qccfmv3", ErrorCode::InvalidWitnessProgram}, // P2WSH
+        {"bc1zw508d6qejxtdg4y5r3zarvaryvg6kdaj", ErrorCode::InvalidWitnessProgram},          // v2, 16 bytes
+    };
+    for (const auto& r : rejected) {
+        auto result = DecodeAddress(r.address);
+        REQUIRE_FALSE(result.has_value());
+        CHECK_EQ(result.error().code, r.code);
+        CHECK_EQ(NoAlloc::DecodeAddress(r.address).error(), r.code);
+    }
+    CHECK_EQ(DecodeAddress("13pWyxxRxoZrKpRqQXXwrKfrzAWxGoS7mQ", "xx").error().code, ErrorCode::InvalidHRP);
+}
+
+TEST_CASE("ValidateAddresses matches DecodeAddress") {
+    using namespace BitcoinKeyUtils;
+    // P2PKH and P2WPKH addresses of deterministic hashes; every 5th one corrupted.
+    const size_t n = 150;
+    std::vector<std::string> storage;
+    for (size_t i = 0; i < n; ++i) {
+        std::vector<uint8_t> hash(Constants::Hash160Size);
+        for (size_t j = 0; j < hash.size(); ++j) hash[j] = static_cast<uint8_t>(i * 13 + j * 7);
+        std::string address = i % 3 == 0 ? *GenerateP2WPKHAddress(hash) : *GenerateP2PKHAddress(hash);
+        if (i % 5 == 0) address[address.size() / 2] = address[address.size() / 2] == 'x' ? 'y' : 'x';
+        if (i == 7) address = "1" + address;
+        storage.push_back(address);
+    }
+    const std::vector<std::string_view> addresses(storage.begin(), storage.end());
+
+    std::vector<uint64_t> valid(3, ~uint64_t{0});
+    std::vector<DecodedAddress> decoded(n);
+    auto count = ValidateAddresses(addresses, valid, decoded);
+    REQUIRE(count.has_value());
+    size_t expected = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto single = DecodeAddress(addresses[i]);
+        const bool bit = (valid[i / 64] >> (i % 64)) & 1;
+        CHECK_EQ(bit, single.has_value());
+        if (single) {
+            ++expected;
+            CHECK(decoded[i].type == single->type);
+            CHECK(decoded[i].hash == single->hash);
+        } else {
+            CHECK(decoded[i].hash == Hash160Digest{});
+        }
+    }
+    CHECK_EQ(*count, expected);
+    CHECK_EQ(valid[2] >> (n % 64), 0);
+
+    // The bitmap alone is enough.
+    std::vector<uint64_t> bitmapOnly(3);
+    CHECK_EQ(*ValidateAddresses(addresses, bitmapOnly), expected);
+    CHECK(bitmapOnly == valid);
+
+    std::vector<uint64_t> shortBitmap(2);
+    CHECK_EQ(ValidateAddresses(addresses, shortBitmap).error().code, ErrorCode::BatchSizeMismatch);
+    CHECK_EQ(ValidateAddresses(addresses, valid, std::span(decoded).first(n - 1)).error().code, ErrorCode::BatchSizeMismatch);
+    CHECK_EQ(ValidateAddresses(addresses, valid, {}, "xx").error().code, ErrorCode::InvalidHRP);
+}
+
+TEST_CASE("Hash backends are selected at load") {
+    using namespace BitcoinKeyUtils;
+    CHECK_FALSE(SHA256Backend().empty());
+    CHECK_FALSE(RIPEMD160Backend().empty());
+    // Whichever kernels were picked, single and batch hashing agree.
+    std::vector<uint8_t> pubKeys(9 * Constants::CompressedPubKeySize);
+    for (size_t i = 0; i < pubKeys.size(); ++i) pubKeys[i] = static_cast<uint8_t>(i * 31 + 7);
+    for (size_t i = 0; i < 9; ++i) pubKeys[i * Constants::CompressedPubKeySize] = 0x02 | (i & 1);
+    std::vector<uint8_t> hashes(9 * Constants::Hash160Size);
+    std::vector<BatchStatus> status(9);
+    REQUIRE(HashRIPEMD160SHA256Batch(pubKeys, Constants::CompressedPubKeySize, hashes, status).has_value());
+    for (size_t i = 0; i < 9; ++i) {
+        auto single = HashRIPEMD160SHA256(std::vector<uint8_t>(pubKeys.begin() + i * Constants::CompressedPubKeySize,
+                                                               pubKeys.begin() + (i + 1) * Constants::CompressedPubKeySize));
+        REQUIRE(single.has_value());
+        CHECK(std::equal(single->begin(), single->end(), hashes.begin() + i * Constants::Hash160Size));
+    }
+}
+
+TEST_CASE("Parallel::Executor matches the serial batch API") {
+    using namespace BitcoinKeyUtils;
+    // Deterministic keys; every 97th has a bad SEC1 prefix.
+    const size_t n = 5000;
+    std::vector<uint8_t> pubKeys(n * Constants::CompressedPubKeySize);
+    std::vector<uint8_t> privKeys(n * Constants::PrivateKeySize);
+    uint32_t x = 12345;
+    for (auto& b : pubKeys) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 16);
+    for (auto& b : privKeys) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 16);
+    for (size_t i = 0; i < n; ++i) pubKeys[i * Constants::CompressedPubKeySize] = i % 97 == 5 ? 0x04 : 0x02 + (i & 1);
+
+    std::vector<uint8_t> hashes(n * Constants::Hash160Size);
+    std::vector<char> p2pkh(n * Constants::P2PKHStride), p2wpkh(n * Constants::P2WPKHStride), wifs(n * Constants::WIFStride);
+    std::vector<BatchStatus> status(n), wifStatus(n);
+    REQUIRE(HashRIPEMD160SHA256Batch(pubKeys, Constants::CompressedPubKeySize, hashes, status).has_value());
+    REQUIRE(GenerateP2PKHAddressBatch(hashes, p2pkh, wifStatus).has_value());
+    REQUIRE(GenerateP2WPKHAddressBatch(hashes, p2wpkh, wifStatus, "tb").has_value());
+    REQUIRE(EncodeWIFBatch(privKeys, true, wifs, wifStatus).has_value());
+    for (size_t i = 0; i < n; ++i) {
+        if (status[i].ok) continue;
+        std::fill_n(p2pkh.begin() + i * Constants::P2PKHStride, Constants::P2PKHStride, '\0');
+        std::fill_n(p2wpkh.begin() + i * Constants::P2WPKHStride, Constants::P2WPKHStride, '\0');
+    }
+    const size_t valid = std::count_if(status.begin(), status.end(), [](const BatchStatus& s) { return s.ok; });
+
+    for (size_t threads : {1, 3}) {
+        Parallel::Executor executor({.threads = threads, .cpuAffinity = {0}, .tileRecords = 100});
+        CHECK_EQ(executor.ThreadCount(), threads);
+
+        std::vector<uint8_t> parHashes(hashes.size());
+        std::vector<char> parP2pkh(p2pkh.size()), parP2wpkh(p2wpkh.size()), parWifs(wifs.size());
+        std::vector<BatchStatus> parStatus(n);
+        auto derived = executor.DeriveAddresses({.pubKeys = pubKeys, .hashes = parHashes, .p2pkh = parP2pkh, .p2wpkh = parP2wpkh, .status = parStatus, .hrp = "tb"});
+        REQUIRE(derived.has_value());
+        CHECK_EQ(*derived, valid);
+        CHECK(parHashes == hashes);
+        CHECK(parP2pkh == p2pkh);
+        CHECK(parP2wpkh == p2wpkh);
+        CHECK(std::equal(parStatus.begin(), parStatus.end(), status.begin(), [](const BatchStatus& a, const BatchStatus& b) { return a.ok == b.ok && (a.ok || a.code == b.code); }));
+
+        // Hashes are optional; without them they live in the workers' scratch arenas.
+        std::fill(parP2pkh.begin(), parP2pkh.end(), 'x');
+        REQUIRE(executor.DeriveAddresses({.pubKeys = pubKeys, .p2pkh = parP2pkh, .status = parStatus}).has_value());
+        CHECK(parP2pkh == p2pkh);
+
+        auto encoded = executor.EncodeWIFBatch(privKeys, true, parWifs, parStatus);
+        REQUIRE(encoded.has_value());
+        CHECK_EQ(*encoded, n);
+        CHECK(parWifs == wifs);
+
+        std::vector<std::atomic<int>> visits(n);
+        executor.ForEachTile(n, [&](size_t begin, size_t end, Parallel::ScratchArena& scratch) {
+            auto words = scratch.Take<uint64_t>(end - begin);
+            for (size_t i = begin; i < end; ++i) words[i - begin] = i;
+            for (size_t i = begin; i < end; ++i) visits[words[i - begin]]++;
+        });
+        CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& v) { return v == 1; }));
+        CHECK_THROWS_AS(executor.ForEachTile(n, [](size_t begin, size_t, Parallel::ScratchArena&) {
+            if (begin > 0) throw std::runtime_error("tile failed");
+        }), std::runtime_error);
+
+        auto badHrp = executor.DeriveAddresses({.pubKeys = pubKeys, .p2wpkh = parP2wpkh, .status = parStatus, .hrp = "xx"});
+        REQUIRE_FALSE(badHrp.has_value());
+        CHECK_EQ(badHrp.error().code, ErrorCode::InvalidHRP);
+        auto shortOut = executor.DeriveAddresses({.pubKeys = pubKeys, .p2pkh = std::span(parP2pkh).first(10), .status = parStatus});
+        REQUIRE_FALSE(shortOut.has_value());
+        CHECK_EQ(shortOut.error().code, ErrorCode::BatchSizeMismatch);
+        auto badSize = executor.DeriveAddresses({.pubKeys = pubKeys, .pubKeySize = 34, .status = parStatus});
+        REQUIRE_FALSE(badSize.has_value());
+        CHECK_EQ(badSize.error().code, ErrorCode::InvalidPubKeySize);
+    }
+}
+
+TEST_CASE("DerivePublicKey known vectors and batch agreement") {
+    using namespace BitcoinKeyUtils;
+    const std::string gx = "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798";
+    const std::string gy = "483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8";
+    struct Vec { std::string priv_hex; std::string compressed_hex; std::string uncompressed_hex; };
+    const std::vector<Vec> cases = {
+        {"0000000000000000000000000000000000000000000000000000000000000001", "02" + gx, "04" + gx + gy},
+        {"0000000000000000000000000000000000000000000000000000000000000002",
+         "02c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5",
+         "04c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee51ae168fea63dc339a3c58419466ceaeef7f632653266d0e1236431a950cfe52a"},
+        {"0000000000000000000000000000000000000000000000000000000000000003",
+         "02f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9", ""},
+        {"fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364140", "03" + gx, ""},
+        {"0c28fca386c7a227600b2fe50b7cae11ec86d3bf1fbe471be89827e19d72aa1d",
+         "02d0de0aaeaefad02b8bdc8a01a1b8b11c696bd3d66a2c5f10780d95b7df42645c", ""},
+    };
+    for (auto& v : cases) {
+        auto pub = DerivePublicKey(HexToBytes(v.priv_hex), true);
+        REQUIRE(pub.has_value());
+        CHECK_EQ(HexFromBytes(*pub), v.compressed_hex);
+        if (!v.uncompressed_hex.empty()) {
+            auto full = DerivePublicKey(HexToBytes(v.priv_hex), false);
+            REQUIRE(full.has_value());
+            CHECK_EQ(HexFromBytes(*full), v.uncompressed_hex);
+        }
+    }
+
+    // The derived key feeds straight into Hash160 and the address generators.
+    auto one = NoAlloc::DerivePublicKey(PrivateKey{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}, true);
+    REQUIRE(one.has_value());
+    auto hash = NoAlloc::HashRIPEMD160SHA256(*one);
+    REQUIRE(hash.has_value());
+    CHECK_EQ(HexFromBytes({hash->begin(), hash->end()}), "751e76e8199196d454941c45d1b3a323f1433bd6");
+    CHECK_EQ(NoAlloc::GenerateP2PKHAddress(*hash)->view(), "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH");
+
+    for (const char* bad : {"0000000000000000000000000000000000000000000000000000000000000000",
+                            "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+                            "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"}) {
+        auto pub = DerivePublicKey(HexToBytes(bad), true);
+        REQUIRE_FALSE(pub.has_value());
+        CHECK_EQ(pub.error().code, ErrorCode::InvalidPrivateKey);
+    }
+    auto shortKey = DerivePublicKey(std::vector<uint8_t>(31, 1), true);
+    REQUIRE_FALSE(shortKey.has_value());
+    CHECK_EQ(shortKey.error().code, ErrorCode::InvalidPrivateKeySize);
+
+    // Three tiles, the last one ragged, with invalid keys mixed in.
+    const size_t n = 150;
+    std::vector<uint8_t> privKeys(n * Constants::PrivateKeySize);
+    uint32_t x = 777;
+    for (auto& b : privKeys) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 16);
+    std::fill_n(privKeys.begin() + 7 * Constants::PrivateKeySize, Constants::PrivateKeySize, 0);
+    std::fill_n(privKeys.begin() + 100 * Constants::PrivateKeySize, Constants::PrivateKeySize, 0xff);
+    for (bool compressed : {true, false}) {
+        const size_t size = compressed ? Constants::CompressedPubKeySize : Constants::UncompressedPubKeySize;
+        std::vector<uint8_t> pubKeys(n * size, 0xaa);
+        std::vector<BatchStatus> status(n);
+        auto derived = DerivePublicKeyBatch(privKeys, compressed, pubKeys, status);
+        REQUIRE(derived.has_value());
+        CHECK_EQ(*derived, n - 2);
+        for (size_t i = 0; i < n; ++i) {
+            auto single = NoAlloc::DerivePublicKey(std::span(privKeys).subspan(i * Constants::PrivateKeySize).first<Constants::PrivateKeySize>(), compressed);
+            std::span<const uint8_t> record = std::span(pubKeys).subspan(i * size, size);
+            CHECK_EQ(status[i].ok, single.has_value());
+            if (single) {
+                CHECK(std::ranges::equal(record, single->span()));
+            } else {
+                CHECK_EQ(status[i].code, ErrorCode::InvalidPrivateKey);
+                CHECK(std::ranges::all_of(record, [](uint8_t b) { return b == 0; }));
+            }
+        }
+
+        Parallel::Executor executor({.threads = 2, .tileRecords = 64});
+        std::vector<uint8_t> parPubKeys(pubKeys.size());
+        std::vector<BatchStatus> parStatus(n);
+        auto parDerived = executor.DerivePublicKeyBatch(privKeys, compressed, parPubKeys, parStatus);
+        REQUIRE(parDerived.has_value());
+        CHECK_EQ(*parDerived, n - 2);
+        CHECK(parPubKeys == pubKeys);
+    }
+    std::vector<uint8_t> out(Constants::CompressedPubKeySize);
+    std::vector<BatchStatus> status(1);
+    auto mismatch = DerivePublicKeyBatch(std::span(privKeys).first(Constants::PrivateKeySize), false, out, status);
+    REQUIRE_FALSE(mismatch.has_value());
+    CHECK_EQ(mismatch.error().code, ErrorCode::BatchSizeMismatch);
+}
+
+TEST_CASE("Address prefix ranges agree with encoding the address") {
+    using namespace BitcoinKeyUtils;
+    // Random hashes; every 16th starts with one or two zero bytes, which add leading '1's.
+    const size_t n = 3000;
+    std::vector<uint8_t> hashes(n * Constants::Hash160Size);
+    uint32_t x = 99;
+    for (auto& b : hashes) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 16);
+    for (size_t i = 0; i < n; i += 16) {
+        hashes[i * Constants::Hash160Size] = 0;
+        if (i % 32 == 0) hashes[i * Constants::Hash160Size + 1] = 0;
+    }
+    std::vector<std::string> p2pkh(n), p2wpkh(n);
+    for (size_t i = 0; i < n; ++i) {
+        std::span<const uint8_t, 20> hash(hashes.data() + i * Constants::Hash160Size, 20);
+        p2pkh[i] = NoAlloc::GenerateP2PKHAddress(hash)->str();
+        p2wpkh[i] = NoAlloc::GenerateP2WPKHAddress(hash)->str();
+    }
+    auto upper = [](std::string s) { for (char& c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c))); return s; };
+
+    const std::vector<std::vector<std::string_view>> sets = {
+        {"1A"}, {"1Bz", "1C", "bc1qa"}, {"11"}, {"111"}, {"1z"}, {"12"}, {"1"}, {"bc1"}, {"BC1QX"}, {"bc1qqq", "1Love"},
+    };
+    for (const auto& prefixes : sets) {
+        auto ranges = CompileAddressPrefixes(prefixes);
+        REQUIRE(ranges.has_value());
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < n; ++i) {
+            const bool match = std::any_of(prefixes.begin(), prefixes.end(), [&](std::string_view p) {
+                return p2pkh[i].starts_with(p) || p2wpkh[i].starts_with(p) || upper(p2wpkh[i]).starts_with(p);
+            });
+            if (match) expected.push_back(i);
+            CHECK_EQ(MatchesAddressPrefix(*ranges, std::span<const uint8_t, 20>(hashes.data() + i * Constants::Hash160Size, 20)), match);
+        }
+        std::vector<size_t> matches(n);
+        auto found = FindAddressPrefixMatches(*ranges, hashes, matches);
+        REQUIRE(found.has_value());
+        matches.resize(*found);
+        CHECK(matches == expected);
+    }
+
+    // Every start of a hash's own addresses matches it.
+    for (size_t i = 0; i < n; i += 37) {
+        std::span<const uint8_t, 20> hash(hashes.data() + i * Constants::Hash160Size, 20);
+        for (size_t len = 1; len <= p2pkh[i].size(); ++len) {
+            const std::string_view prefix = std::string_view(p2pkh[i]).substr(0, len);
+            auto ranges = CompileAddressPrefixes(std::span(&prefix, 1));
+            REQUIRE(ranges.has_value());
+            CHECK(MatchesAddressPrefix(*ranges, hash));
+        }
+        for (size_t len = 1; len <= 4 + 32; ++len) {
+            const std::string_view prefix = std::string_view(p2wpkh[i]).substr(0, len);
+            auto ranges = CompileAddressPrefixes(std::span(&prefix, 1));
+            REQUIRE(ranges.has_value());
+            CHECK(MatchesAddressPrefix(*ranges, hash));
+        }
+    }
+
+    struct Bad { std::string_view prefix; ErrorCode code; };
+    for (const Bad& bad : {Bad{"", ErrorCode::InvalidAddressPrefix}, Bad{"10", ErrorCode::InvalidAddressCharacter},
+                           Bad{"1zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz", ErrorCode::InvalidAddressPrefix},
+                           Bad{"3J98t1", ErrorCode::InvalidAddressPrefix}, Bad{"tb1q", ErrorCode::InvalidAddressPrefix},
+                           Bad{"bc1qb", ErrorCode::InvalidAddressCharacter}, Bad{"Bc1q", ErrorCode::InvalidAddressPrefix},
+                           Bad{"bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4", ErrorCode::InvalidAddressPrefix}}) {
+        auto ranges = CompileAddressPrefixes(std::span(&bad.prefix, 1));
+        REQUIRE_FALSE(ranges.has_value());
+        CHECK_EQ(ranges.error().code, bad.code);
+    }
+    CHECK(CompileAddressPrefixes(std::vector<std::string_view>{"tb1q"}, "tb").has_value());
+    std::vector<size_t> tooFew(n - 1);
+    CHECK_FALSE(FindAddressPrefixMatches(*CompileAddressPrefixes(std::vector<std::string_view>{"1"}), hashes, tooFew).has_value());
+}
+
+TEST_CASE("WatchList index agrees with a set of the hashes") {
+    using namespace BitcoinKeyUtils;
+    const std::string path = (std::filesystem::temp_directory_path() / "bitcoin_key_utils_watch_list_test.idx").string();
+    // 5000 distinct hashes plus repeats of 100 of them; probes are every other hash, half of them listed.
+    const size_t n = 10000;
+    std::vector<uint8_t> hashes(n * Constants::Hash160Size);
+    uint32_t x = 7;
+    for (auto& b : hashes) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 16);
+    std::vector<uint8_t> listed(hashes.begin(), hashes.begin() + n / 2 * Constants::Hash160Size);
+    listed.insert(listed.end(), hashes.begin(), hashes.begin() + 100 * Constants::Hash160Size);
+
+    auto stats = WatchList::Build(listed, path);
+    REQUIRE(stats.has_value());
+    CHECK_EQ(stats->entries, n / 2);
+    CHECK_EQ(stats->duplicates, 100);
+    auto index = WatchList::Index::Open(path);
+    REQUIRE(index.has_value());
+    CHECK_EQ(index->Size(), n / 2);
+
+    std::vector<uint64_t> found((n + 63) / 64, ~uint64_t{0});
+    auto hits = index->Contains(hashes, found);
+    REQUIRE(hits.has_value());
+    CHECK_EQ(*hits, n / 2);
+    for (size_t i = 0; i < n; ++i) {
+        const bool expected = i < n / 2;
+        CHECK_EQ(index->Contains(std::span<const uint8_t, 20>(hashes.data() + i * Constants::Hash160Size, 20)), expected);
+        CHECK_EQ((found[i / 64] >> (i % 64) & 1) != 0, expected);
+    }
+    CHECK_EQ(found.back() >> (n % 64), 0);
+    std::vector<uint64_t> tooFew(found.size() - 1);
+    CHECK_EQ(index->Contains(hashes, tooFew).error().code, ErrorCode::BatchSizeMismatch);
+    CHECK_EQ(WatchList::Build(std::span(hashes).first(19), path).error().code, ErrorCode::BatchSizeMismatch);
+
+    // Addresses of both types; the invalid ones are counted and skipped.
+    std::vector<std::string> addresses;
+    for (size_t i = 0; i < 200; ++i) {
+        std::span<const uint8_t, 20> hash(hashes.data() + i * Constants::Hash160Size, 20);
+        addresses.push_back(i % 2 ? NoAlloc::GenerateP2PKHAddress(hash)->str() : NoAlloc::GenerateP2WPKHAddress(hash)->str());
+    }
+    addresses.push_back("1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN3");
+    addresses.push_back("not an address");
+    std::vector<std::string_view> views(addresses.begin(), addresses.end());
+    stats = WatchList::BuildFromAddresses(views, path);
+    REQUIRE(stats.has_value());
+    CHECK_EQ(stats->entries, 200);
+    CHECK_EQ(stats->rejected, 2);
+    index = WatchList::Index::Open(path);
+    REQUIRE(index.has_value());
+    for (size_t i = 0; i < 400; ++i) {
+        CHECK_EQ(index->Contains(std::span<const uint8_t, 20>(hashes.data() + i * Constants::Hash160Size, 20)), i < 200);
+    }
+
+    // An empty index holds nothing. Rebuilding replaces the file, so the index still open on the old
+    // one keeps reading it.
+    REQUIRE(WatchList::Build({}, path).has_value());
+    CHECK(index->Contains(std::span<const uint8_t, 20>(hashes.data(), 20)));
+    index = WatchList::Index::Open(path);
+    REQUIRE(index.has_value());
+    CHECK_EQ(index->Size(), 0);
+    CHECK_EQ(index->Contains(hashes, found), 0);
+
+    // Half the hashes share their leading 8 bytes, so they fall in one bucket at one interpolated
+    // position; every other hash is listed.
+    std::vector<uint8_t> skewed(hashes.begin(), hashes.begin() + 4000 * Constants::Hash160Size);
+    for (size_t i = 0; i < 2000; ++i) std::memset(skewed.data() + i * Constants::Hash160Size, 0x42, 8);
+    std::vector<uint8_t> skewedListed;
+    for (size_t i = 0; i < 4000; i += 2) {
+        skewedListed.insert(skewedListed.end(), skewed.begin() + i * Constants::Hash160Size, skewed.begin() + (i + 1) * Constants::Hash160Size);
+    }
+    REQUIRE(WatchList::Build(skewedListed, path).has_value());
+    index = WatchList::Index::Open(path);
+    REQUIRE(index.has_value());
+    for (size_t i = 0; i < 4000; ++i) {
+        CHECK_EQ(index->Contains(std::span<const uint8_t, 20>(skewed.data() + i * Constants::Hash160Size, 20)), i % 2 == 0);
+    }
+
+    // Damaged files are refused.
+    REQUIRE(WatchList::Build(listed, path).has_value());
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    CHECK_EQ(WatchList::Index::Open(path).error().code, ErrorCode::InvalidWatchListFormat);
+    {
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        std::fputc('X', file);
+        std::fclose(file);
+    }
+    CHECK_EQ(WatchList::Index::Open(path).error().code, ErrorCode::InvalidWatchListFormat);
+    std::filesystem::remove(path);
+    CHECK_EQ(WatchList::Index::Open(path).error().code, ErrorCode::WatchListIOFailed);
+}
+
+TEST_CASE("RecordFile round-trips columns that feed the batch API from the mapping") {
+    using namespace BitcoinKeyUtils;
+    const std::string path = (std::filesystem::temp_directory_path() / "bitcoin_key_utils_record_file_test.bkr").string();
+    const size_t n = 1000;
+    const size_t slotSize = 48;
+    std::vector<uint8_t> privateKeys(n * Constants::PrivateKeySize);
+    uint32_t x = 11;
+    for (auto& b : privateKeys) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 16);
+    std::vector<uint8_t> pubKeys(n * Constants::CompressedPubKeySize);
+    std::vector<uint8_t> hashes(n * Constants::Hash160Size);
+    std::vector<BatchStatus> status(n);
+    REQUIRE_EQ(DerivePublicKeyBatch(privateKeys, true, pubKeys, status).value(), n);
+    REQUIRE_EQ(HashRIPEMD160SHA256Batch(pubKeys, Constants::CompressedPubKeySize, hashes, status).value(), n);
+    std::vector<uint8_t> types(n);
+    for (size_t i = 0; i < n; ++i) types[i] = static_cast<uint8_t>(i % 2 ? AddressType::P2WPKH : AddressType::P2PKH);
+    std::vector<uint8_t> slots(n * slotSize);
+    for (size_t i = 0; i < slots.size(); ++i) slots[i] = static_cast<uint8_t>(i * 7);
+
+    // Uneven appends across blocks of 300 records, the last one short.
+    auto writer = RecordFile::Writer::Create(path, {.keySlotSize = slotSize, .blockRecords = 300});
+    REQUIRE(writer.has_value());
+    for (size_t first = 0, k = 1; first < n; first += k, k = std::min(n - first, k + 449)) {
+        CAPTURE(first);
+        REQUIRE(writer->Append({std::span(hashes).subspan(first * 20, k * 20), std::span(pubKeys).subspan(first * 33, k * 33),
+                                std::span(types).subspan(first, k), std::span(slots).subspan(first * slotSize, k * slotSize)}).has_value());
+    }
+    CHECK_EQ(writer->Append({{}, {}, std::span(types).first(1), {}}).error().code, ErrorCode::BatchSizeMismatch);
+    CHECK_EQ(writer->Finish().value(), n);
+    CHECK_EQ(writer->Finish().error().code, ErrorCode::RecordFileIOFailed);
+
+    auto reader = RecordFile::Reader::Open(path);
+    REQUIRE(reader.has_value());
+    CHECK_EQ(reader->Size(), n);
+    CHECK_EQ(reader->BlockCount(), 4);
+    CHECK_EQ(reader->FileOptions().keySlotSize, slotSize);
+    size_t first = 0;
+    for (size_t b = 0; b < reader->BlockCount(); ++b) {
+        const RecordFile::Columns block = reader->Block(b);
+        const size_t k = block.size();
+        CHECK_EQ(k, b < 3 ? 300 : 100);
+        CHECK(std::ranges::equal(block.hashes, std::span(hashes).subspan(first * 20, k * 20)));
+        CHECK(std::ranges::equal(block.pubKeys, std::span(pubKeys).subspan(first * 33, k * 33)));
+        CHECK(std::ranges::equal(block.addressTypes, std::span(types).subspan(first, k)));
+        CHECK(std::ranges::equal(block.keySlots, std::span(slots).subspan(first * slotSize, k * slotSize)));
+        CHECK_EQ(reinterpret_cast<uintptr_t>(block.pubKeys.data()) % 64, 0);
+        CHECK_EQ(reinterpret_cast<uintptr_t>(block.keySlots.data()) % 64, 0);
+
+        // The batch API reads the mapped columns as they are.
+        std::vector<uint8_t> rehashed(k * 20);
+        CHECK_EQ(HashRIPEMD160SHA256Batch(block.pubKeys, 33, rehashed, status).value(), k);
+        CHECK(std::ranges::equal(rehashed, block.hashes));
+        std::vector<char> addresses(k * Constants::P2PKHStride);
+        CHECK_EQ(GenerateP2PKHAddressBatch(block.hashes, addresses, status).value(), k);
+        CHECK_EQ(RecordAt(addresses, k - 1, Constants::P2PKHStride), NoAlloc::GenerateP2PKHAddress(std::span<const uint8_t, 20>(block.hashes.last(20)))->str());
+        first += k;
+    }
+
+    // A damaged block fails its checksum, and only that block.
+    {
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        std::fseek(file, static_cast<long>(reader->Block(1).pubKeys.data() - reader->Block(0).hashes.data()) + 64 + 5, SEEK_SET);
+        std::fputc(~reader->Block(1).pubKeys[5] & 0xff, file);
+        std::fclose(file);
+    }
+    reader = RecordFile::Reader::Open(path);
+    CHECK_EQ(reader.error().code, ErrorCode::RecordFileChecksumMismatch);
+    reader = RecordFile::Reader::Open(path, false);
+    REQUIRE(reader.has_value());
+    CHECK(reader->VerifyBlock(0).has_value());
+    CHECK_EQ(reader->VerifyBlock(1).error().code, ErrorCode::RecordFileChecksumMismatch);
+    CHECK(reader->VerifyBlock(3).has_value());
+    CHECK_EQ(reader->VerifyBlock(4).error().code, ErrorCode::BatchSizeMismatch);
+
+    // Files without key slots, empty files and unfinished files.
+    writer = RecordFile::Writer::Create(path);
+    REQUIRE(writer.has_value());
+    REQUIRE(writer->Append({std::span(hashes).first(20), std::span(pubKeys).first(33), std::span(types).first(1), {}}).has_value());
+    CHECK_EQ(writer->Append({std::span(hashes).first(20), std::span(pubKeys).first(33), std::span(types).first(1), std::span(slots).first(1)}).error().code,
+             ErrorCode::BatchSizeMismatch);
+    REQUIRE(writer->Finish().has_value());
+    reader = RecordFile::Reader::Open(path);
+    REQUIRE(reader.has_value());
+    CHECK_EQ(reader->Size(), 1);
+    CHECK(reader->Block(0).keySlots.empty());
+    writer = RecordFile::Writer::Create(path);
+    REQUIRE(writer.has_value());
+    CHECK_EQ(writer->Finish().value(), 0);
+    reader = RecordFile::Reader::Open(path);
+    REQUIRE(reader.has_value());
+    CHECK_EQ(reader->BlockCount(), 0);
+    // An unfinished writer leaves the finished file, and its open reader, as they were.
+    {
+        auto unfinished = RecordFile::Writer::Create(path);
+        REQUIRE(unfinished.has_value());
+        REQUIRE(unfinished->Append({std::span(hashes).first(20), std::span(pubKeys).first(33), std::span(types).first(1), {}}).has_value());
+        CHECK_EQ(reader->BlockCount(), 0);
+    }
+    CHECK_FALSE(std::filesystem::exists(path + ".tmp"));
+    reader = RecordFile::Reader::Open(path);
+    REQUIRE(reader.has_value());
+    CHECK_EQ(reader->Size(), 0);
+    {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        std::fputs("not a record file", file);
+        std::fclose(file);
+    }
+    CHECK_EQ(RecordFile::Reader::Open(path).error().code, ErrorCode::InvalidRecordFileFormat);
+    CHECK_EQ(RecordFile::Writer::Create(path, {.blockRecords = 0}).error().code, ErrorCode::BatchSizeMismatch);
+    std::filesystem::remove(path);
+    CHECK_EQ(RecordFile::Reader::Open(path).error().code, ErrorCode::RecordFileIOFailed);
+}
+
+TEST_CASE("KeyArena slots are wiped on release and feed the WIF batch API") {
+    using namespace BitcoinKeyUtils;
+    auto arena = KeyArena::Create(100);
+    REQUIRE(arena.has_value());
+    const size_t capacity = arena->Capacity();
+    REQUIRE(capacity >= 100);
+    CHECK_EQ(arena->Available(), capacity);
+
+    // Keys of every length class, plus records each batch error should reject.
+    std::vector<std::string> wifs;
+    for (uint8_t i = 1; i <= 40; ++i) {
+        PrivateKey key{};
+        key.fill(i);
+        wifs.push_back(NoAlloc::EncodeWIF(key, i % 3 != 0)->str());
+    }
+    wifs.push_back(wifs[0].substr(1));
+    wifs.push_back(wifs[1]);
+    wifs.back()[10] = wifs.back()[10] == 'A' ? 'B' : 'A';
+    std::vector<unsigned char> testnet(34, 0x01), badFlag(34, 0x11);
+    testnet[0] = 0xef;
+    badFlag[0] = Constants::MainNet;
+    wifs.push_back(EncodeBase58Check(testnet));
+    wifs.push_back(EncodeBase58Check(badFlag));
+    std::vector<std::string_view> views(wifs.begin(), wifs.end());
+    const size_t n = views.size();
+
+    {
+        auto slots = arena->Acquire(n);
+        REQUIRE(slots.has_value());
+        CHECK_EQ(arena->Available(), capacity - n);
+        CHECK(std::all_of(slots->bytes().begin(), slots->bytes().end(), [](uint8_t b) { return b == 0; }));
+        std::vector<uint64_t> compressed(1);
+        std::vector<BatchStatus> status(n);
+        auto decoded = DecodeWIFBatch(views, slots->bytes(), compressed, status);
+        REQUIRE(decoded.has_value());
+        CHECK_EQ(*decoded, 40);
+        for (size_t i = 0; i < n; ++i) {
+            auto single = NoAlloc::DecodeWIF(views[i]);
+            REQUIRE_EQ(status[i].ok, single.has_value());
+            if (single) {
+                CHECK(std::equal(single->first.begin(), single->first.end(), (*slots)[i].begin()));
+                CHECK_EQ((compressed[0] >> i & 1) != 0, single->second);
+            } else {
+                CHECK_EQ(status[i].code, single.error());
+                CHECK(std::all_of((*slots)[i].begin(), (*slots)[i].end(), [](uint8_t b) { return b == 0; }));
+            }
+        }
+        CHECK_EQ(compressed[0] >> n, 0);
+
+        // The slots read straight back into the encoder.
+        std::vector<char> out(n * Constants::WIFStride);
+        REQUIRE(EncodeWIFBatch(slots->bytes().first(3 * Constants::PrivateKeySize), true, out, status).has_value());
+        CHECK_EQ(RecordAt(out, 0, Constants::WIFStride), wifs[0]);
+
+        std::vector<uint64_t> tooFew;
+        CHECK_EQ(DecodeWIFBatch(views, slots->bytes(), tooFew, status).error().code, ErrorCode::BatchSizeMismatch);
+        CHECK_EQ(DecodeWIFBatch(views, slots->bytes().first(32), compressed, status).error().code, ErrorCode::BatchSizeMismatch);
+    }
+    CHECK_EQ(arena->Available(), capacity);
+
+    // Released slots are wiped and reused, and single slots are filled without touching the heap.
+    AllocationCounter allocations;
+    {
+        auto slot = arena->Acquire();
+        REQUIRE(slot.has_value());
+        CHECK(std::all_of(slot->bytes().begin(), slot->bytes().end(), [](uint8_t b) { return b == 0; }));
+        auto compressed = NoAlloc::DecodeWIF(views[1], (*slot)[0]);
+        REQUIRE(compressed.has_value());
+        CHECK(*compressed);
+        CHECK_EQ((*slot)[0][0], 2);
+        KeySlots moved = std::move(*slot);
+        CHECK_EQ(slot->size(), 0);
+        CHECK_EQ(moved.size(), 1);
+        CHECK_EQ(arena->Available(), capacity - 1);
+    }
+    CHECK_EQ(allocations.Stop(), 0u);
+    CHECK_EQ(arena->Available(), capacity);
+
+    // Runs are consecutive: with every other slot taken no run of two is left.
+    std::vector<KeySlots> singles;
+    for (size_t i = 0; i < capacity; ++i) singles.push_back(std::move(*arena->Acquire()));
+    CHECK_EQ(arena->Acquire().error(), ErrorCode::KeyArenaExhausted);
+    for (size_t i = 0; i < capacity; i += 2) singles[i].Release();
+    CHECK_EQ(arena->Acquire(2).error(), ErrorCode::KeyArenaExhausted);
+    CHECK(arena->Acquire(1).has_value());
+    singles.clear();
+    CHECK_EQ(arena->Acquire(capacity + 1).error(), ErrorCode::KeyArenaExhausted);
+    CHECK_EQ(arena->Acquire(capacity)->size(), capacity);
+}
+
+TEST_CASE("Metrics count calls, errors and hashed bytes across threads") {
+    using namespace BitcoinKeyUtils;
+    using Metrics::Function;
+
+    for (size_t b = 0; b < Metrics::LatencyBucketCount; ++b) {
+        REQUIRE_EQ(Metrics::LatencyBucket(Metrics::LatencyBucketLowerBound(b)), b);
+    }
+    CHECK_EQ(Metrics::LatencyBucket(1000), Metrics::LatencyBucket(1023));
+    CHECK_EQ(Metrics::LatencyBucket(~uint64_t{0}), Metrics::LatencyBucketCount - 1);
+    CHECK_EQ(Metrics::FunctionName(Function::DecodeWIFBatch), "DecodeWIFBatch");
+
+    const Metrics::Snapshot before = Metrics::Collect();
+    CHECK_EQ(before.sha256Backend, SHA256Backend());
+    CHECK_EQ(before.ripemd160Backend, RIPEMD160Backend());
+
+    PrivateKey key{};
+    key.fill(7);
+    const std::string wif = NoAlloc::EncodeWIF(key, true)->str();
+    CHECK_FALSE(NoAlloc::DecodeWIF("tooshort").has_value());
+    CHECK(NoAlloc::DecodeWIF(wif).has_value());
+    std::vector<std::string_view> views{wif, "tooshort", wif};
+    std::vector<uint8_t> keys(views.size() * Constants::PrivateKeySize);
+    std::vector<uint64_t> compressed(1);
+    std::vector<BatchStatus> status(views.size());
+    CHECK_EQ(DecodeWIFBatch(views, keys, compressed, status).value(), 2);
+    CHECK_FALSE(DerivePublicKey(std::vector<uint8_t>(31, 7), true).has_value());
+    std::thread([] {
+        CHECK_FALSE(HashRIPEMD160SHA256(std::vector<uint8_t>{}).has_value());
+        auto hash = HashRIPEMD160SHA256(std::vector<uint8_t>(Constants::CompressedPubKeySize, 2));
+        CHECK(GenerateP2PKHAddress(hash.value()).has_value());
+    }).join();
+
+    const Metrics::Snapshot after = Metrics::Collect();
+    auto calls = [&](Function f) { return after[f].calls - before[f].calls; };
+    if (!after.enabled) {
+        CHECK_EQ(after.bytesHashed, 0);
+        CHECK_EQ(after[Function::DecodeWIF].calls, 0);
+        CHECK_EQ(after.Errors(ErrorCode::InvalidWIFLength), 0);
+        return;
+    }
+    CHECK_EQ(calls(Function::EncodeWIF), 1);
+    CHECK_EQ(calls(Function::DecodeWIF), 2);
+    CHECK_EQ(calls(Function::DecodeWIFBatch), 1);
+    CHECK_EQ(after[Function::DecodeWIFBatch].records - before[Function::DecodeWIFBatch].records, 3);
+    CHECK_EQ(after.Errors(ErrorCode::InvalidWIFLength) - before.Errors(ErrorCode::InvalidWIFLength), 2);
+    // Errors the allocating functions return before any work are counted too.
+    CHECK_EQ(calls(Function::DerivePublicKey), 1);
+    CHECK_EQ(after.Errors(ErrorCode::InvalidPrivateKeySize) - before.Errors(ErrorCode::InvalidPrivateKeySize), 1);
+    CHECK_EQ(after.Errors(ErrorCode::EmptyData) - before.Errors(ErrorCode::EmptyData), 1);
+    // The generating thread has exited, so its counts come from the retired totals.
+    CHECK_EQ(calls(Function::HashRIPEMD160SHA256), 2);
+    CHECK_EQ(calls(Function::GenerateP2PKHAddress), 1);
+    // One WIF payload encoded and three decoded, then the thread's public key and address payload.
+    CHECK_EQ(after.bytesHashed - before.bytesHashed, 4 * 34 + 33 + 21);
+
+    const Metrics::FunctionStats& stats = after[Function::DecodeWIF];
+    uint64_t counted = 0;
+    for (uint64_t n : stats.latency) counted += n;
+    CHECK_EQ(counted, stats.calls);
+    CHECK(stats.Quantile(0.0) <= stats.Quantile(0.5));
+    CHECK(stats.Quantile(0.5) <= stats.Quantile(1.0));
+    CHECK(stats.Quantile(1.0) <= stats.totalNanoseconds);
+}
+
+TEST_CASE("Literals encode and check keys and addresses at compile time") {
+    using namespace BitcoinKeyUtils;
+    using namespace BitcoinKeyUtils::Literals;
+
+    // Private key 1, its compressed public key, and their encodings.
+    constexpr PrivateKey one = [] { PrivateKey key{}; key[31] = 1; return key; }();
+    constexpr std::array<uint8_t, 33> onePub = {
+        0x02, 0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b, 0x07,
+        0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98};
+    constexpr Hash160Digest hash = Require(Literals::HashRIPEMD160SHA256(onePub));
+    static_assert(hash[0] == 0x75 && hash[19] == 0xd6);
+    static_assert(Require(Literals::EncodeWIF(one, true)).view() == "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn");
+    static_assert(Require(Literals::EncodeWIF(one, false)).view() == "5HpHagT65TZzG1PH3CSu63k8DbpvD8s5ip4nEB3kEsreAnchuDf");
+    static_assert(Require(Literals::GenerateP2PKHAddress(hash)).view() == "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH");
+    static_assert(Require(Literals::GenerateP2WPKHAddress(hash)).view() == "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4");
+
+    constexpr auto wif = "KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn"_wif;
+    constexpr auto p2pkh = "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH"_p2pkh;
+    constexpr auto p2wpkh = "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4"_p2wpkh;
+    static_assert(Require(Literals::DecodeWIF(wif)).first == one);
+    static_assert(Require(Literals::DecodeAddress(p2pkh)).hash == hash);
+    static_assert(Require(Literals::DecodeAddress(p2wpkh)).hash == hash);
+
+    // Typos are errors in a constant expression too.
+    static_assert(Literals::DecodeWIF("KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWm").error() == ErrorCode::Base58CheckDecodingFailed);
+    static_assert(Literals::DecodeAddress("1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAM0").error() == ErrorCode::InvalidAddressCharacter);
+    static_assert(Literals::DecodeAddress("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5").error() == ErrorCode::Bech32DecodingFailed);
+
+    // At run time they agree with NoAlloc, errors included.
+    std::vector<std::string> inputs = {"", "1", "tb1qw508d6qejxtdg4y5r3zarvary0c5xw7kxpjzsx", "bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7k7grplx"};
+    for (uint8_t i = 1; i < 60; ++i) {
+        PrivateKey key{};
+        std::fill(key.begin(), key.end(), static_cast<uint8_t>(i * 37));
+        key[0] = i;
+        Hash160Digest h{};
+        std::copy_n(key.begin(), h.size(), h.begin());
+        const bool compressed = i % 2 == 0;
+
+        auto encoded = Literals::EncodeWIF(key, compressed);
+        REQUIRE(encoded.has_value());
+        CHECK_EQ(encoded->view(), NoAlloc::EncodeWIF(key, compressed)->view());
+        CHECK_EQ(Literals::HashRIPEMD160SHA256(std::span{key}.first(i % 32 + 1)).value(), NoAlloc::HashRIPEMD160SHA256(std::span{key}.first(i % 32 + 1)).value());
+        CHECK_EQ(Literals::GenerateP2PKHAddress(h)->view(), NoAlloc::GenerateP2PKHAddress(h)->view());
+        CHECK_EQ(Literals::GenerateP2WPKHAddress(h, "tb")->view(), NoAlloc::GenerateP2WPKHAddress(h, "tb")->view());
+
+        std::string typo = encoded->str();
+        typo[i % typo.size()] = typo[i % typo.size()] == 'z' ? 'y' : 'z';
+        inputs.push_back(encoded->str());
+        inputs.push_back(typo);
+        inputs.push_back(NoAlloc::GenerateP2PKHAddress(h)->str());
+        inputs.push_back(NoAlloc::GenerateP2WPKHAddress(h)->str().substr(0, 40 - i % 3));
+    }
+    for (const std::string& input : inputs) {
+        auto decoded = Literals::DecodeWIF(input);
+        auto expected = NoAlloc::DecodeWIF(input);
+        REQUIRE_EQ(decoded.has_value(), expected.has_value());
+        if (decoded) CHECK(*decoded == *expected);
+        else CHECK_EQ(decoded.error(), expected.error());
+
+        for (std::string_view hrp : {"bc", "tb", "xx"}) {
+            auto address = Literals::DecodeAddress(input, hrp);
+            auto reference = NoAlloc::DecodeAddress(input, hrp);
+            REQUIRE_EQ(address.has_value(), reference.has_value());
+            if (address) CHECK(address->hash == reference->hash);
+            else CHECK_EQ(address.error(), reference.error());
+        }
+    }
+}
+
+TEST_CASE("Network and script policies encode and decode every address type") {
+    using namespace BitcoinKeyUtils;
+
+    // Private key 1: its key hash and, for P2TR, the x coordinate of its public key (BIP-350).
+    PrivateKey one{};
+    one[31] = 1;
+    const std::vector<uint8_t> hashBytes = HexToBytes("751e76e8199196d454941c45d1b3a323f1433bd6");
+    const std::vector<uint8_t> xonlyBytes = HexToBytes("79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798");
+    std::array<uint8_t, 20> hash;
+    std::array<uint8_t, 32> xonly;
+    std::copy(hashBytes.begin(), hashBytes.end(), hash.begin());
+    std::copy(xonlyBytes.begin(), xonlyBytes.end(), xonly.begin());
+
+    struct Vector {
+        Network network;
+        ScriptType script;
+        const char* address;
+    };
+    const Vector vectors[] = {
+        {Network::Mainnet, ScriptType::P2PKH, "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH"},
+        {Network::Mainnet, ScriptType::P2SH_P2WPKH, "3JvL6Ymt8MVWiCNHC7oWU6nLeHNJKLZGLN"},
+        {Network::Mainnet, ScriptType::P2WPKH, "bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t4"},
+        {Network::Mainnet, ScriptType::P2TR, "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0"},
+        {Network::Testnet, ScriptType::P2PKH, "mrCDrCybB6J1vRfbwM5hemdJz73FwDBC8r"},
+        {Network::Testnet, ScriptType::P2SH_P2WPKH, "2NAUYAHhujozruyzpsFRP63mbrdaU5wnEpN"},
+        {Network::Testnet, ScriptType::P2WPKH, "tb1qw508d6qejxtdg4y5r3zarvary0c5xw7kxpjzsx"},
+        {Network::Testnet, ScriptType::P2TR, "tb1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vq47zagq"},
+        {Network::Regtest, ScriptType::P2PKH, "mrCDrCybB6J1vRfbwM5hemdJz73FwDBC8r"},
+        {Network::Regtest, ScriptType::P2WPKH, "bcrt1qw508d6qejxtdg4y5r3zarvary0c5xw7kygt080"},
+        {Network::Regtest, ScriptType::P2TR, "bcrt1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqc8gma6"},
+    };
+    for (const Vector& v : vectors) {
+        CAPTURE(v.address);
+        const std::span<const uint8_t> program = v.script == ScriptType::P2TR ? std::span<const uint8_t>(xonly) : std::span<const uint8_t>(hash);
+        auto address = NoAlloc::EncodeAddress(v.network, v.script, program);
+        REQUIRE(address.has_value());
+        CHECK_EQ(address->view(), v.address);
+
+        auto decoded = NoAlloc::DecodeAddress(v.network, v.address);
+        REQUIRE(decoded.has_value());
+        if (v.script == ScriptType::P2SH_P2WPKH) {
+            CHECK(decoded->type == AddressType::P2SH);
+        } else {
+            CHECK(std::ranges::equal(decoded->span(), program));
+        }
+        // Segwit addresses belong to one network only.
+        if (v.script == ScriptType::P2WPKH || v.script == ScriptType::P2TR) {
+            CHECK_FALSE(NoAlloc::DecodeAddress(v.network == Network::Mainnet ? Network::Testnet : Network::Mainnet, v.address).has_value());
+        }
+    }
+
+    // The mainnet API is the Mainnet policy, and the result types are sized for the network.
+    static_assert(std::is_same_v<Policy::EncodedAddress<Policy::Mainnet, Policy::P2WPKH>, P2WPKHString>);
+    static_assert(Policy::MaxAddressLength<Policy::Regtest, Policy::P2WPKH>() == 44);
+    CHECK_EQ((Policy::EncodeAddress<Policy::Mainnet, Policy::P2PKH>(hash)->view()), NoAlloc::GenerateP2PKHAddress(hash)->view());
+    CHECK_EQ((Policy::EncodeAddress<Policy::Testnet, Policy::P2WPKH>(hash)->view()), NoAlloc::GenerateP2WPKHAddress(hash, "TB")->view());
+    CHECK((Policy::DecodeAddress<Policy::Testnet, Policy::P2TR>("tb1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vq47zagq").value() == xonly));
+
+    // Testnet and regtest keys share a version byte.
+    auto wif = Policy::EncodeWIF<Policy::Testnet>(one, true);
+    CHECK_EQ(wif->view(), "cMahea7zqjxrtgAbB7LSGbcQUr1uX1ojuat9jZodMN87JcbXMTcA");
+    CHECK_EQ(NoAlloc::EncodeWIF(Network::Regtest, one, false)->view(), "91avARGdfge8E4tZfYLoxeJ5sGBdNJQH4kvjJoQFacbgwmaKkrx");
+    PrivateKey key{};
+    CHECK_EQ(NoAlloc::DecodeWIF(Network::Regtest, wif->view(), key).value(), true);
+    CHECK(key == one);
+    CHECK_EQ(NoAlloc::DecodeWIF(Network::Mainnet, wif->view(), key).error(), ErrorCode::InvalidNetworkPrefix);
+    CHECK_EQ(NoAlloc::DecodeWIF(wif->view(), key).error(), ErrorCode::InvalidNetworkPrefix);
+
+    // Rejections name the reason.
+    CHECK_EQ(NoAlloc::EncodeAddress(Network::Mainnet, ScriptType::P2TR, hash).error(), ErrorCode::InvalidPubKeySize);
+    CHECK_EQ(NoAlloc::EncodeAddress(Network::Mainnet, ScriptType::P2WPKH, xonly).error(), ErrorCode::InvalidPubKeyHashSize);
+    CHECK_EQ(NoAlloc::DecodeAddress(Network::Mainnet, "mrCDrCybB6J1vRfbwM5hemdJz73FwDBC8r").error(), ErrorCode::InvalidNetworkPrefix);
+    CHECK_EQ((Policy::DecodeAddress<Policy::Mainnet, Policy::P2WPKH>("bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0").error()), ErrorCode::InvalidWitnessProgram);
+    CHECK_EQ((Policy::DecodeAddress<Policy::Mainnet, Policy::P2PKH>("3JvL6Ymt8MVWiCNHC7oWU6nLeHNJKLZGLN").error()), ErrorCode::InvalidNetworkPrefix);
+    // A Bech32 checksum on a witness version 1 program is Bech32m's to reject (BIP-350).
+    CHECK_EQ(NoAlloc::DecodeAddress(Network::Mainnet, "bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7k7grplx").error(), ErrorCode::Bech32DecodingFailed);
+}
+
+TEST_CASE("Hex decode and encode agree with a digit-at-a-time reference") {
+    using namespace BitcoinKeyUtils;
+    const std::string_view backend = Hex::Backend();
+    CHECK((backend == "avx2" || backend == "sse41" || backend == "standard"));
+
+    // Up to 100 bytes covers every mix of 32-byte, 16-byte and scalar steps.
+    static constexpr char digits[] = "0123456789abcdef";
+    for (size_t size = 0; size <= 100; ++size) {
+        CAPTURE(size);
+        std::vector<uint8_t> bytes(size);
+        std::string expected;
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = static_cast<uint8_t>(i * 37 + size);
+            expected += digits[bytes[i] >> 4];
+            expected += digits[bytes[i] & 0x0f];
+        }
+        std::string hex(2 * size + 1, '#');
+        CHECK_EQ(Hex::Encode(bytes, hex).value(), 2 * size);
+        CHECK_EQ(hex, expected + "#");
+
+        std::string upper = expected;
+        for (char& c : upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        std::vector<uint8_t> decoded(size);
+        CHECK(Hex::Decode(upper, decoded).has_value());
+        CHECK(decoded == bytes);
+
+        // A bad character at any position is reported there, even inside a SIMD block; the
+        // characters probe each edge of the digit and letter ranges.
+        for (size_t pos = 0; pos < expected.size(); ++pos) {
+            std::string bad = expected;
+            bad[pos] = "/:@G`g\x80 "[pos % 8];
+            auto error = Hex::Decode(bad, decoded);
+            REQUIRE_FALSE(error.has_value());
+            CHECK_EQ(error.error().code, ErrorCode::InvalidHexCharacter);
+            CHECK_EQ(error.error().position, pos);
+        }
+    }
+
+    std::vector<uint8_t> out(4);
+    CHECK_EQ(Hex::Decode("0011223", out).error().code, ErrorCode::InvalidHexLength);
+    CHECK_EQ(Hex::Decode("0011223", out).error().position, 7u);
+    CHECK_EQ(Hex::Decode("0011223344", out).error().position, 8u);
+    char small[3];
+    CHECK_EQ(Hex::Encode(out, small).error(), ErrorCode::InvalidHexLength);
+
+    // Batches of 20-byte hashes: failed records are zeroed and name the reason.
+    const std::vector<std::string_view> records = {
+        "751e76e8199196d454941c45d1b3a323f1433bd6",
+        "751e76e8199196d454941c45d1b3a323f1433bd",
+        "751E76E8199196D454941C45D1B3A323F1433BD6",
+        "751e76e8199196d454941c45d1b3a323f1433bdx",
+    };
+    std::vector<uint8_t> hashes(records.size() * 20, 0xff);
+    std::vector<BatchStatus> status(records.size());
+    CHECK_EQ(Hex::DecodeBatch(records, 20, hashes, status).value(), 2u);
+    CHECK(status[0].ok);
+    CHECK_EQ(status[1].code, ErrorCode::InvalidHexLength);
+    CHECK(status[2].ok);
+    CHECK_EQ(status[3].code, ErrorCode::InvalidHexCharacter);
+    CHECK(std::equal(hashes.begin(), hashes.begin() + 20, hashes.begin() + 40));
+    CHECK(std::all_of(hashes.begin() + 60, hashes.end(), [](uint8_t b) { return b == 0; }));
+    CHECK_EQ(HexFromBytes({hashes.begin(), hashes.begin() + 20}), records[0]);
+    CHECK_EQ(Hex::DecodeBatch(records, 20, {hashes.data(), 79}, status).error().code, ErrorCode::BatchSizeMismatch);
+
+    std::vector<char> text(4 * 41, '#');
+    CHECK_EQ(Hex::EncodeBatch(hashes, 20, text, 41).value(), 4u);
+    CHECK_EQ(RecordAt(text, 0, 41), records[0]);
+    CHECK_EQ(RecordAt(text, 3, 41), std::string(40, '0'));
+    CHECK_EQ(text[40], '\0');
+    CHECK_EQ(Hex::EncodeBatch(hashes, 20, text, 39).error().code, ErrorCode::BatchSizeMismatch);
+    CHECK_EQ(Hex::EncodeBatch({hashes.data(), 30}, 20, text, 41).error().code, ErrorCode::BatchSizeMismatch);
+}
@@ -0,0 +1,29 @@
+# Install the build tree into a scratch prefix, compile the consumer with only the include flags the
+# README documents, then configure, build and run it as a project that finds the library through
+# its package config.
+#
+#   cmake -DBUILD_DIR=... -DWORK_DIR=... -DCONFIG=... -DCXX_COMPILER=... -DCXX_FLAGS=... -DLINKER_FLAGS=... -P check_install.cmake
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+set(prefix "${WORK_DIR}/prefix")
+
+function(run)
+  execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed (${result}): ${ARGN}")
+  endif()
+endfunction()
+
+run(${CMAKE_COMMAND} --install "${BUILD_DIR}" --prefix "${prefix}" --config "${CONFIG}")
+run("${CXX_COMPILER}" -std=c++23 -fsyntax-only
+    "-I${prefix}/include" "-I${prefix}/include/bitcoin_key_utils" "-I${prefix}/include/bitcoin_core"
+    "${CMAKE_CURRENT_LIST_DIR}/consumer.cpp")
+run(${CMAKE_COMMAND} -S "${CMAKE_CURRENT_LIST_DIR}" -B "${WORK_DIR}/build"
+    "-DCMAKE_PREFIX_PATH=${prefix}"
+    "-DCMAKE_BUILD_TYPE=${CONFIG}"
+    "-DCMAKE_CXX_COMPILER=${CXX_COMPILER}"
+    "-DCMAKE_CXX_FLAGS=${CXX_FLAGS}"
+    "-DCMAKE_EXE_LINKER_FLAGS=${LINKER_FLAGS}"
+    "-DCMAKE_RUNTIME_OUTPUT_DIRECTORY=${WORK_DIR}/bin")
+run(${CMAKE_COMMAND} --build "${WORK_DIR}/build" --config "${CONFIG}")
+run("${WORK_DIR}/bin/consumer")
@@ -0,0 +1,10 @@
+// Built by check_install.cmake against an installed copy of the library, with only the include
+// directories the exported targets carry.
+#include <bitcoin_key_utils.h>
+#include <bitcoin_key_utils/bitcoin_key_literals.h>
+
+int main() {
+    using namespace BitcoinKeyUtils::Literals;
+    constexpr auto address = "1BgGZ9tcN4rm9KBzDn7KprQz87SZ26SAMH"_p2pkh;
+    return BitcoinKeyUtils::NoAlloc::DecodeAddress(address.view()) ? 0 : 1;
+}
@@ -0,0 +1,693 @@
+// bitcoin-key-tool: bulk key / address conversion.
+//
+// Reads one key per record from a memory-mapped file or from stdin, splits the input
+// into chunks on record boundaries, converts the chunks on a pool of worker threads
+// with the batch APIs and writes the results in input order.
+
+#include "bitcoin_key_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace BitcoinKeyUtils;
+
+namespace {
+
+enum class InputKind { PubKey, PrivKey, WIF };
+enum class OutputField { Hash160, P2PKH, P2WPKH, WIF, PrivKey, PubKey };
+
+struct Options {
+    InputKind kind = InputKind::PubKey;
+    bool rawInput = false;
+    size_t rawPubKeySize = Constants::CompressedPubKeySize;
+    std::vector<OutputField> fields;
+    bool rawOutput = false;
+    bool compressed = true;
+    std::string hrp{Constants::Bech32MainnetHRP};
+    std::string inputPath = "-";
+    std::string outputPath = "-";
+    size_t threads = 0;
+    size_t chunkSize = 4 << 20;
+    bool quiet = false;
+};
+
+void PrintUsage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [options] [input|-]\n"
+        "\n"
+        "Converts one key per record, reading a memory-mapped file or stdin ('-').\n"
+        "\n"
+        "Input:\n"
+        "  --in pubkey|privkey|wif   Record kind (default: pubkey)\n"
+        "  --raw-in                  Fixed-size binary records instead of hex lines\n"
+        "                            (pubkey: --pubkey-size bytes, privkey: 32 bytes)\n"
+        "  --pubkey-size 33|65       Record size of raw public keys (default: 33)\n"
+        "\n"
+        "Output:\n"
+        "  --out FIELD[,FIELD...]    Fields per record, tab separated in text mode:\n"
+        "                            hash160, p2pkh, p2wpkh (pubkey or privkey input),\n"
+        "                            wif, pubkey (privkey input), privkey (wif input)\n"
+        "  --raw-out                 Fixed-stride binary records: hash160 20, p2pkh 34,\n"
+        "                            p2wpkh 42, wif 52, privkey 32, pubkey 33 or 65 bytes;\n"
+        "                            text fields are NUL-padded and invalid records are\n"
+        "                            all zero\n"
+        "  --uncompressed            Encode WIFs for, and derive, uncompressed public keys\n"
+        "  --hrp bc|tb               Bech32 prefix for p2wpkh (default: bc)\n"
+        "  -o, --output PATH         Output file (default: stdout)\n"
+        "\n"
+        "Execution:\n"
+        "  -j, --threads N           Worker threads (default: all cores)\n"
+        "  --chunk-size BYTES        Input bytes per work item (default: 4194304)\n"
+        "  -q, --quiet               Do not report throughput on stderr\n",
+        argv0);
+}
+
+std::optional<OutputField> ParseField(std::string_view name) {
+    if (name == "hash160") return OutputField::Hash160;
+    if (name == "p2pkh") return OutputField::P2PKH;
+    if (name == "p2wpkh") return OutputField::P2WPKH;
+    if (name == "wif") return OutputField::WIF;
+    if (name == "privkey") return OutputField::PrivKey;
+    if (name == "pubkey") return OutputField::PubKey;
+    return std::nullopt;
+}
+
+bool FieldAccepts(OutputField field, InputKind kind) {
+    switch (field) {
+    case OutputField::Hash160:
+    case OutputField::P2PKH:
+    case OutputField::P2WPKH: return kind == InputKind::PubKey || kind == InputKind::PrivKey;
+    case OutputField::WIF:
+    case OutputField::PubKey: return kind == InputKind::PrivKey;
+    case OutputField::PrivKey: return kind == InputKind::WIF;
+    }
+    return false;
+}
+
+size_t FieldStride(const Options& opt, OutputField field) {
+    switch (field) {
+    case OutputField::Hash160: return Constants::Hash160Size;
+    case OutputField::P2PKH: return Constants::P2PKHStride;
+    case OutputField::P2WPKH: return Constants::P2WPKHStride;
+    case OutputField::WIF: return Constants::WIFStride;
+    case OutputField::PrivKey: return Constants::PrivateKeySize;
+    case OutputField::PubKey: return opt.compressed ? Constants::CompressedPubKeySize : Constants::UncompressedPubKeySize;
+    }
+    return 0;
+}
+
+// Fields that hold binary bytes; they are printed as hex in text mode.
+bool FieldIsBinary(OutputField field) {
+    return field == OutputField::Hash160 || field == OutputField::PrivKey || field == OutputField::PubKey;
+}
+
+std::optional<Options> ParseOptions(int argc, char* argv[]) {
+    Options opt;
+    bool haveInput = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        auto value = [&]() -> std::optional<std::string_view> {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for %s\n", argv[i]);
+                return std::nullopt;
+            }
+            return std::string_view(argv[++i]);
+        };
+        if (arg == "-h" || arg == "--help") {
+            return std::nullopt;
+        } else if (arg == "--in") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            if (*v == "pubkey") opt.kind = InputKind::PubKey;
+            else if (*v == "privkey") opt.kind = InputKind::PrivKey;
+            else if (*v == "wif") opt.kind = InputKind::WIF;
+            else { std::fprintf(stderr, "Unknown input kind: %s\n", argv[i]); return std::nullopt; }
+        } else if (arg == "--raw-in") {
+            opt.rawInput = true;
+        } else if (arg == "--pubkey-size") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            if (*v == "33") opt.rawPubKeySize = Constants::CompressedPubKeySize;
+            else if (*v == "65") opt.rawPubKeySize = Constants::UncompressedPubKeySize;
+            else { std::fprintf(stderr, "Public key size must be 33 or 65\n"); return std::nullopt; }
+        } else if (arg == "--out") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            std::string_view list = *v;
+            while (!list.empty()) {
+                const size_t comma = list.find(',');
+                const std::string_view name = list.substr(0, comma);
+                auto field = ParseField(name);
+                if (!field) { std::fprintf(stderr, "Unknown output field: %.*s\n", (int)name.size(), name.data()); return std::nullopt; }
+                opt.fields.push_back(*field);
+                list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+            }
+        } else if (arg == "--raw-out") {
+            opt.rawOutput = true;
+        } else if (arg == "--uncompressed") {
+            opt.compressed = false;
+        } else if (arg == "--hrp") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            opt.hrp = *v;
+        } else if (arg == "-o" || arg == "--output") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            opt.outputPath = *v;
+        } else if (arg == "-j" || arg == "--threads") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            opt.threads = std::strtoul(argv[i], nullptr, 10);
+        } else if (arg == "--chunk-size") {
+            auto v = value();
+            if (!v) return std::nullopt;
+            opt.chunkSize = std::max<size_t>(std::strtoull(argv[i], nullptr, 10), 4096);
+        } else if (arg == "-q" || arg == "--quiet") {
+            opt.quiet = true;
+        } else if (!arg.empty() && (arg[0] != '-' || arg == "-") && !haveInput) {
+            opt.inputPath = arg;
+            haveInput = true;
+        } else {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return std::nullopt;
+        }
+    }
+
+    if (opt.fields.empty()) {
+        if (opt.kind == InputKind::PubKey) opt.fields = {OutputField::P2PKH, OutputField::P2WPKH};
+        if (opt.kind == InputKind::PrivKey) opt.fields = {OutputField::WIF};
+        if (opt.kind == InputKind::WIF) opt.fields = {OutputField::PrivKey};
+    }
+    for (OutputField field : opt.fields) {
+        if (!FieldAccepts(field, opt.kind)) {
+            std::fprintf(stderr, "Output field not available for this input kind\n");
+            return std::nullopt;
+        }
+    }
+    if (opt.rawInput && opt.kind == InputKind::WIF) {
+        std::fprintf(stderr, "WIF input is text only\n");
+        return std::nullopt;
+    }
+    if (opt.hrp != "bc" && opt.hrp != "tb") {
+        std::fprintf(stderr, "HRP must be 'bc' or 'tb'\n");
+        return std::nullopt;
+    }
+    if (opt.threads == 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    return opt;
+}
+
+// Size of one binary input record, or 0 for newline-separated text.
+size_t RawRecordSize(const Options& opt) {
+    if (!opt.rawInput) return 0;
+    return opt.kind == InputKind::PubKey ? opt.rawPubKeySize : Constants::PrivateKeySize;
+}
+
+void AppendHex(std::vector<char>& out, const uint8_t* data, size_t len) {
+    const size_t start = out.size();
+    out.resize(start + 2 * len);
+    (void)Hex::Encode({data, len}, {out.data() + start, 2 * len});
+}
+
+// Split text into lines without their terminators; blank lines are skipped.
+template <typename F>
+void ForEachLine(std::string_view text, F&& f) {
+    while (!text.empty()) {
+        const size_t nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (!line.empty()) f(line);
+        if (nl == std::string_view::npos) break;
+        text.remove_prefix(nl + 1);
+    }
+}
+
+// Per-record converted fields of one chunk, in fixed-stride buffers.
+struct ConvertedChunk {
+    size_t records = 0;
+    std::vector<uint8_t> valid;
+    std::vector<uint8_t> hashes;       // Hash160Size per record
+    std::vector<char> p2pkh;           // P2PKHStride per record
+    std::vector<char> p2wpkh;          // P2WPKHStride per record
+    std::vector<char> wifs;            // WIFStride per record
+    std::vector<uint8_t> privateKeys;  // PrivateKeySize per record
+    std::vector<uint8_t> pubKeys;      // 33 or 65 bytes per record, by --uncompressed
+};
+
+bool Wants(const Options& opt, OutputField field) {
+    return std::find(opt.fields.begin(), opt.fields.end(), field) != opt.fields.end();
+}
+
+void GenerateAddresses(const Options& opt, ConvertedChunk& c) {
+    std::vector<BatchStatus> status(c.records);
+    if (Wants(opt, OutputField::P2PKH)) {
+        c.p2pkh.resize(c.records * Constants::P2PKHStride);
+        (void)GenerateP2PKHAddressBatch(c.hashes, c.p2pkh, status);
+    }
+    if (Wants(opt, OutputField::P2WPKH)) {
+        c.p2wpkh.resize(c.records * Constants::P2WPKHStride);
+        (void)GenerateP2WPKHAddressBatch(c.hashes, c.p2wpkh, status, opt.hrp);
+    }
+}
+
+void ConvertPubKeys(const Options& opt, std::string_view data, ConvertedChunk& c) {
+    // Compressed and uncompressed keys are hashed as two batches and scattered back in order.
+    std::vector<uint8_t> keys[2];
+    std::vector<size_t> index[2];
+    auto add = [&](const uint8_t* key, size_t size) {
+        const int group = size == Constants::CompressedPubKeySize ? 0 : 1;
+        keys[group].insert(keys[group].end(), key, key + size);
+        index[group].push_back(c.records);
+    };
+    if (const size_t size = RawRecordSize(opt)) {
+        for (size_t pos = 0; pos + size <= data.size(); pos += size) {
+            c.valid.push_back(1);
+            add(reinterpret_cast<const uint8_t*>(data.data() + pos), size);
+            ++c.records;
+        }
+    } else {
+        uint8_t key[Constants::UncompressedPubKeySize];
+        ForEachLine(data, [&](std::string_view line) {
+            const bool sized = line.size() == 2 * Constants::CompressedPubKeySize || line.size() == 2 * Constants::UncompressedPubKeySize;
+            const bool ok = sized && Hex::Decode(line, {key, line.size() / 2}).has_value();
+            c.valid.push_back(ok);
+            if (ok) add(key, line.size() / 2);
+            ++c.records;
+        });
+    }
+
+    c.hashes.assign(c.records * Constants::Hash160Size, 0);
+    for (int group = 0; group < 2; ++group) {
+        const size_t n = index[group].size();
+        if (n == 0) continue;
+        const size_t keySize = group == 0 ? Constants::CompressedPubKeySize : Constants::UncompressedPubKeySize;
+        std::vector<uint8_t> hashes(n * Constants::Hash160Size);
+        std::vector<BatchStatus> status(n);
+        (void)HashRIPEMD160SHA256Batch(keys[group], keySize, hashes, status);
+        for (size_t i = 0; i < n; ++i) {
+            const size_t r = index[group][i];
+            std::copy_n(hashes.begin() + i * Constants::Hash160Size, Constants::Hash160Size, c.hashes.begin() + r * Constants::Hash160Size);
+            c.valid[r] = status[i].ok;
+        }
+    }
+
+    GenerateAddresses(opt, c);
+}
+
+void ConvertPrivKeys(const Options& opt, std::string_view data, ConvertedChunk& c) {
+    if (const size_t size = RawRecordSize(opt)) {
+        c.records = data.size() / size;
+        c.privateKeys.assign(data.begin(), data.begin() + c.records * size);
+        c.valid.assign(c.records, 1);
+    } else {
+        // Lines that are not 64 hex digits decode to a zeroed key marked invalid.
+        std::vector<std::string_view> lines;
+        ForEachLine(data, [&](std::string_view line) { lines.push_back(line); });
+        c.records = lines.size();
+        c.privateKeys.resize(c.records * Constants::PrivateKeySize);
+        std::vector<BatchStatus> status(c.records);
+        (void)Hex::DecodeBatch(lines, Constants::PrivateKeySize, c.privateKeys, status);
+        for (const BatchStatus& s : status) c.valid.push_back(s.ok);
+    }
+
+    std::vector<BatchStatus> status(c.records);
+    if (Wants(opt, OutputField::WIF)) {
+        c.wifs.resize(c.records * Constants::WIFStride);
+        (void)EncodeWIFBatch(c.privateKeys, opt.compressed, c.wifs, status);
+        for (size_t i = 0; i < c.records; ++i) c.valid[i] = c.valid[i] && status[i].ok;
+    }
+    if (Wants(opt, OutputField::PubKey) || Wants(opt, OutputField::Hash160) || Wants(opt, OutputField::P2PKH) || Wants(opt, OutputField::P2WPKH)) {
+        const size_t keySize = FieldStride(opt, OutputField::PubKey);
+        c.pubKeys.resize(c.records * keySize);
+        (void)DerivePublicKeyBatch(c.privateKeys, opt.compressed, c.pubKeys, status);
+        for (size_t i = 0; i < c.records; ++i) c.valid[i] = c.valid[i] && status[i].ok;
+        c.hashes.resize(c.records * Constants::Hash160Size);
+        (void)HashRIPEMD160SHA256Batch(c.pubKeys, keySize, c.hashes, status);
+        GenerateAddresses(opt, c);
+    }
+}
+
+void ConvertWIFs(std::string_view data, ConvertedChunk& c) {
+    std::vector<std::string_view> wifs;
+    ForEachLine(data, [&](std::string_view line) { wifs.push_back(line); });
+    c.records = wifs.size();
+    c.privateKeys.resize(c.records * Constants::PrivateKeySize);
+    std::vector<uint64_t> compressed((c.records + 63) / 64);
+    std::vector<BatchStatus> status(c.records);
+    (void)DecodeWIFBatch(wifs, c.privateKeys, compressed, status);
+    for (const BatchStatus& s : status) c.valid.push_back(s.ok);
+}
+
+void AppendField(const Options& opt, const ConvertedChunk& c, size_t r, OutputField field, std::vector<char>& out) {
+    const size_t stride = FieldStride(opt, field);
+    const char* text = nullptr;
+    const uint8_t* bytes = nullptr;
+    switch (field) {
+    case OutputField::Hash160: bytes = c.hashes.data() + r * stride; break;
+    case OutputField::PrivKey: bytes = c.privateKeys.data() + r * stride; break;
+    case OutputField::PubKey: bytes = c.pubKeys.data() + r * stride; break;
+    case OutputField::P2PKH: text = c.p2pkh.data() + r * stride; break;
+    case OutputField::P2WPKH: text = c.p2wpkh.data() + r * stride; break;
+    case OutputField::WIF: text = c.wifs.data() + r * stride; break;
+    }
+
+    if (opt.rawOutput) {
+        const size_t start = out.size();
+        out.resize(start + stride, '\0');
+        if (!c.valid[r]) return;
+        if (bytes) std::memcpy(out.data() + start, bytes, stride);
+        else std::memcpy(out.data() + start, text, stride);
+        return;
+    }
+    if (!c.valid[r]) {
+        static constexpr std::string_view invalid = "invalid";
+        out.insert(out.end(), invalid.begin(), invalid.end());
+    } else if (bytes) {
+        AppendHex(out, bytes, stride);
+    } else {
+        out.insert(out.end(), text, text + strnlen(text, stride));
+    }
+}
+
+struct ChunkResult {
+    std::vector<char> out;
+    size_t records = 0;
+    size_t invalid = 0;
+};
+
+ChunkResult ConvertChunk(const Options& opt, std::string_view data) {
+    ConvertedChunk c;
+    switch (opt.kind) {
+    case InputKind::PubKey: ConvertPubKeys(opt, data, c); break;
+    case InputKind::PrivKey: ConvertPrivKeys(opt, data, c); break;
+    case InputKind::WIF: ConvertWIFs(data, c); break;
+    }
+
+    ChunkResult result;
+    result.records = c.records;
+    size_t recordBytes = 0;
+    for (OutputField field : opt.fields) recordBytes += FieldIsBinary(field) && !opt.rawOutput ? 2 * FieldStride(opt, field) + 1 : FieldStride(opt, field) + 1;
+    result.out.reserve(c.records * recordBytes);
+    for (size_t r = 0; r < c.records; ++r) {
+        result.invalid += !c.valid[r];
+        for (size_t f = 0; f < opt.fields.size(); ++f) {
+            if (f && !opt.rawOutput) result.out.push_back('\t');
+            AppendField(opt, c, r, opt.fields[f], result.out);
+        }
+        if (!opt.rawOutput) result.out.push_back('\n');
+    }
+    std::fill(c.privateKeys.begin(), c.privateKeys.end(), 0);
+    std::fill(c.wifs.begin(), c.wifs.end(), 0);
+    return result;
+}
+
+/** Source of record-aligned chunks: a memory-mapped file, or stdin read block by block. */
+class ChunkSource {
+public:
+    ChunkSource(const Options& opt) : m_opt(opt), m_recordSize(RawRecordSize(opt)) {}
+
+    ~ChunkSource() {
+        if (m_map) munmap(m_map, m_mapSize);
+        if (m_fd > STDIN_FILENO) close(m_fd);
+    }
+
+    bool Open() {
+        if (m_opt.inputPath == "-") {
+            m_fd = STDIN_FILENO;
+            return true;
+        }
+        m_fd = open(m_opt.inputPath.c_str(), O_RDONLY);
+        if (m_fd < 0) return false;
+        struct stat st;
+        if (fstat(m_fd, &st) != 0) return false;
+        if (!S_ISREG(st.st_mode) || st.st_size == 0) return true; // pipes and empty files are read as streams
+        m_mapSize = st.st_size;
+        m_map = static_cast<char*>(mmap(nullptr, m_mapSize, PROT_READ, MAP_PRIVATE, m_fd, 0));
+        if (m_map == MAP_FAILED) {
+            m_map = nullptr;
+            return false;
+        }
+        madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    /** Next chunk, either a view into the mapping or a block owned by `storage`. */
+    std::optional<std::string_view> Next(std::vector<char>& storage) {
+        return m_map ? NextMapped() : NextStreamed(storage);
+    }
+
+    /** Bytes at the end of the input that do not form a whole binary record. */
+    size_t TrailingBytes() const { return m_trailing; }
+
+    /** errno of a failed read of a streamed input, or 0. The input ends at the failure. */
+    int ReadError() const { return m_readError; }
+
+private:
+    // Cut [begin, begin + size) back to the last record boundary inside it.
+    size_t AlignedLength(const char* begin, size_t size, bool atEnd) const {
+        if (m_recordSize) return size - size % m_recordSize;
+        if (atEnd) return size;
+        for (size_t i = size; i > 0; --i) {
+            if (begin[i - 1] == '\n') return i;
+        }
+        return 0;
+    }
+
+    std::optional<std::string_view> NextMapped() {
+        if (m_offset >= m_mapSize) return std::nullopt;
+        size_t size = std::min(m_opt.chunkSize, m_mapSize - m_offset);
+        const bool atEnd = m_offset + size == m_mapSize;
+        size_t len = AlignedLength(m_map + m_offset, size, atEnd);
+        if (len == 0 && !atEnd) {
+            // A single record longer than a chunk: extend to its end.
+            const void* nl = std::memchr(m_map + m_offset + size, '\n', m_mapSize - m_offset - size);
+            len = nl ? static_cast<const char*>(nl) - (m_map + m_offset) + 1 : m_mapSize - m_offset;
+        }
+        if (len == 0) {
+            m_trailing = m_mapSize - m_offset;
+            m_offset = m_mapSize;
+            return std::nullopt;
+        }
+        std::string_view chunk(m_map + m_offset, len);
+        m_offset += len;
+        if (m_offset < m_mapSize && m_recordSize && m_mapSize - m_offset < m_recordSize) m_trailing = m_mapSize - m_offset;
+        return chunk;
+    }
+
+    std::optional<std::string_view> NextStreamed(std::vector<char>& storage) {
+        storage.assign(m_carry.begin(), m_carry.end());
+        m_carry.clear();
+        bool atEnd = false;
+        // The carry never holds a whole record. As in NextMapped, a record longer than a chunk is
+        // read to its end.
+        bool haveRecord = false;
+        while (!atEnd && (storage.size() < m_opt.chunkSize || !haveRecord)) {
+            const size_t start = storage.size();
+            storage.resize(std::max(m_opt.chunkSize, start + 4096));
+            const ssize_t n = read(m_fd, storage.data() + start, storage.size() - start);
+            if (n < 0) {
+                storage.resize(start);
+                if (errno == EINTR) continue;
+                m_readError = errno;
+                return std::nullopt;
+            }
+            storage.resize(start + n);
+            atEnd = n == 0;
+            haveRecord = haveRecord || (m_recordSize ? storage.size() >= m_recordSize : std::memchr(storage.data() + start, '\n', n) != nullptr);
+        }
+        if (storage.empty()) return std::nullopt;
+        const size_t len = AlignedLength(storage.data(), storage.size(), atEnd);
+        m_carry.assign(storage.begin() + len, storage.end());
+        storage.resize(len);
+        if (atEnd) {
+            m_trailing = m_carry.size();
+            m_carry.clear();
+        }
+        if (len == 0) return std::nullopt;
+        return std::string_view(storage.data(), storage.size());
+    }
+
+    const Options& m_opt;
+    const size_t m_recordSize;
+    int m_fd = -1;
+    char* m_map = nullptr;
+    size_t m_mapSize = 0;
+    size_t m_offset = 0;
+    std::vector<char> m_carry;
+    size_t m_trailing = 0;
+    int m_readError = 0;
+};
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+/**
+ * Runs ConvertChunk on a fixed pool of workers. The main thread feeds chunks in,
+ * at most 2 per worker in flight, and writes results out in input order.
+ */
+class Pipeline {
+public:
+    Pipeline(const Options& opt) : m_opt(opt) {
+        for (size_t i = 0; i < opt.threads; ++i) m_workers.emplace_back([this] { Work(); });
+    }
+
+    ~Pipeline() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_workCv.notify_all();
+        for (auto& worker : m_workers) worker.join();
+    }
+
+    bool Run(ChunkSource& source, int outFd, size_t& records, size_t& invalid) {
+        const size_t maxInFlight = 2 * m_opt.threads;
+        uint64_t nextSubmit = 0, nextWrite = 0;
+        bool inputDone = false;
+        while (!inputDone || nextWrite < nextSubmit) {
+            if (!inputDone && nextSubmit - nextWrite < maxInFlight) {
+                Job job;
+                job.seq = nextSubmit;
+                auto chunk = source.Next(job.storage);
+                if (!chunk) {
+                    inputDone = true;
+                    continue;
+                }
+                job.data = *chunk;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_jobs.push_back(std::move(job));
+                }
+                m_workCv.notify_one();
+                ++nextSubmit;
+                continue;
+            }
+            ChunkResult result;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_doneCv.wait(lock, [&] { return m_done.count(nextWrite) != 0; });
+                result = std::move(m_done[nextWrite]);
+                m_done.erase(nextWrite);
+            }
+            ++nextWrite;
+            records += result.records;
+            invalid += result.invalid;
+            if (!WriteAll(outFd, result.out.data(), result.out.size())) return false;
+        }
+        return true;
+    }
+
+private:
+    struct Job {
+        uint64_t seq = 0;
+        std::string_view data;
+        std::vector<char> storage; // backs `data` when reading from a stream
+    };
+
+    void Work() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_workCv.wait(lock, [&] { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty()) return;
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            ChunkResult result = ConvertChunk(m_opt, job.data);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.emplace(job.seq, std::move(result));
+            }
+            m_doneCv.notify_one();
+        }
+    }
+
+    const Options& m_opt;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workCv, m_doneCv;
+    std::deque<Job> m_jobs;
+    std::map<uint64_t, ChunkResult> m_done;
+    bool m_stopping = false;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    auto opt = ParseOptions(argc, argv);
+    if (!opt) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    ChunkSource source(*opt);
+    if (!source.Open()) {
+        std::fprintf(stderr, "Cannot read %s: %s\n", opt->inputPath.c_str(), std::strerror(errno));
+        return 2;
+    }
+    int outFd = STDOUT_FILENO;
+    if (opt->outputPath != "-") {
+        outFd = open(opt->outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (outFd < 0) {
+            std::fprintf(stderr, "Cannot write %s: %s\n", opt->outputPath.c_str(), std::strerror(errno));
+            return 2;
+        }
+    }
+
+    size_t records = 0, invalid = 0;
+    const auto start = std::chrono::steady_clock::now();
+    bool ok;
+    {
+        Pipeline pipeline(*opt);
+        ok = pipeline.Run(source, outFd, records, invalid);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (outFd != STDOUT_FILENO && close(outFd) != 0) ok = false;
+    if (!ok) {
+        std::fprintf(stderr, "Write failed: %s\n", std::strerror(errno));
+        return 2;
+    }
+    if (source.ReadError()) {
+        std::fprintf(stderr, "Cannot read %s: %s\n", opt->inputPath.c_str(), std::strerror(source.ReadError()));
+        return 2;
+    }
+
+    if (source.TrailingBytes()) {
+        std::fprintf(stderr, "Ignored %zu trailing bytes that do not form a whole record\n", source.TrailingBytes());
+    }
+    if (!opt->quiet) {
+        const std::string_view sha256 = SHA256Backend(), ripemd160 = RIPEMD160Backend();
+        std::fprintf(stderr, "%zu records (%zu invalid) in %.3f s, %.0f records/s, %zu threads [sha256: %.*s; ripemd160: %.*s]\n",
+                     records, invalid, seconds, seconds > 0 ? records / seconds : 0.0, opt->threads,
+                     (int)sha256.size(), sha256.data(), (int)ripemd160.size(), ripemd160.data());
+    }
+    return 0;
+}